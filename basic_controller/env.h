@@ -32,12 +32,39 @@
 #define PTR_LIST_LOGGER_LEVEL WARN_LEVEL
 #define SCRIPT_EXECUTOR_LOGGER_LEVEL DEBUG_LEVEL
 #define SCRIPT_LOADER_LOGGER_LEVEL INFO_LEVEL
+#define SCRIPT_CACHE_LOGGER_LEVEL WARN_LEVEL
 #define SCRIPT_LOGGER_LEVEL INFO_LEVEL
 #define SCRIPT_STATE_LOGGER_LEVEL DEBUG_LEVEL
 #define SCRIPT_MEMORY_LOGGER_LEVEL WARN_LEVEL
 #define SCRIPT_CONTAINER_LOGGER_LEVEL DEBUG_LEVEL
 #define TEST_LOGGER_LEVEL DEBUG_LEVEL
 
+// HSLStrip frame buffer layout: HSL_LAYOUT_INTERLEAVED or HSL_LAYOUT_SOA
+#define HSL_STRIP_LAYOUT HSL_LAYOUT_INTERLEAVED
+
+// entries in the deferred log ring (LogRing).  0 writes each message to Serial when it is logged
+#define BINARY_LOG_SIZE 32
+// most time the app loop spends writing deferred log messages after a step
+#define BINARY_LOG_DRAIN_MSECS 4
+
+// bytes in each block of a script's arena (arena.h).  larger objects get their own block
+#define ARENA_BLOCK_SIZE 1024
+
+// bytes JsonGenerator collects before giving them to its sink (HTTP response, file or DRString)
+#define JSON_CHUNK_SIZE 256
+
+// bytes a DRString holds without a heap allocation, including the terminator
+#define DRSTRING_INLINE_SIZE 16
+
+// 1 keeps a compiled copy of each script next to its JSON (script_cache.h)
+#define SCRIPT_CACHE 1
+
+// pooled instances of a "create" command unless its "pool-size" is set.  more use the heap
+#define TEMPLATE_POOL_SIZE 16
+
+// SCRIPT_PROFILE 1 times each script step and command for /api/profile
+#define SCRIPT_PROFILE 1
+
 #if ENV==PROD
     #define ENV_PROD
     #define RUN_TESTS 0
@@ -48,10 +75,14 @@
     #define ENSURE 0
     // RUN_TESTS should be 1 to run tests on start.  otherwise they are not run
     #define RUN_TESTS 1
-    #define RUN_STRING_TESTS 0
+    #define RUN_STRING_TESTS 1
     #define RUN_JSON_TESTS 0
     #define RUN_ANIMATION_TESTS 0
     #define SCRIPT_LOADER_TESTS 1
+    #define RUN_COLOR_TESTS 1
+    #define RUN_LED_STRIP_TESTS 1
+    #define RUN_LOGGER_TESTS 1
+    #define RUN_LIST_TESTS 1
 #endif
 
 #endif
\ No newline at end of file
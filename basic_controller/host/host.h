@@ -0,0 +1,17 @@
+#ifndef HOST_H
+#define HOST_H
+
+// Common prelude for host programs.  On the device http_server.h declares
+// Request/Response before the rest of lib/ is included; the host build has
+// no http_server.h so it does the same here.
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include "../env.h"
+
+namespace DevRelief {
+    typedef ESP8266WebServer Request;
+    typedef ESP8266WebServer Response;
+};
+
+#endif
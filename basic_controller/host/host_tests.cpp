@@ -0,0 +1,22 @@
+/*
+ * Runs the on-device test suites (lib/test) on the host.  Exit status is
+ * non-zero if any suite fails or leaks memory.
+ */
+#include "./host.h"
+#include "../lib/logger.h"
+#include "../lib/test/tests.h"
+
+using namespace DevRelief;
+
+int main(int argc, char** argv) {
+    Host::useSimulatedClock(true);
+    Host::setFileSystemRoot(argc > 1 ? argv[1] : "./littlefs");
+    Serial.begin(115200);
+    LittleFS.begin();
+#if RUN_TESTS==1
+    Tests tests;
+    return tests.run() ? 0 : 1;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,462 @@
+/*
+ * Host benchmark for the script engine.
+ *
+ * Loads every script in a scripts.json array (or one named script), runs it
+ * against virtual strips for a fixed number of steps and reports the time,
+ * allocations and heap used per frame.  The clock is simulated so every
+ * step() runs a full frame regardless of the script frequency.  The pixel
+ * checksum covers every frame so engine changes can be checked for
+ * identical output.
+ *
+ * --convert times per-pixel HSLToRGB() against the batch converters for --leds pixels
+ * instead of running scripts.  --layout picks the HSLStrip frame buffer layout.
+ * --lists times PtrList against PtrSmallList for the ways scripts use them.
+ * --load reports the peak heap while loading each script through a JsonRoot
+ * (parse() then jsonToScript()), a JsonRoot read in place and from parser
+ * events (streamToScript()).
+ *
+ *   script_bench [--scripts path] [--script name] [--steps n]
+ *                [--leds n] [--strips n] [--layout interleaved|soa]
+ *                [--convert] [--lists] [--load] [--log]
+ */
+#include "./host.h"
+#include <chrono>
+#include "../lib/logger.h"
+#include "../lib/parse_gen.h"
+#include "../lib/led_strip.h"
+#include "../lib/config.h"
+#include "../lib/script_data_loader.h"
+
+using namespace DevRelief;
+
+struct BenchOptions {
+    const char * scriptsPath = "../../scripts.json";
+    const char * scriptName = NULL;
+    int steps = 1000;
+    int leds = 300;
+    int strips = 2;
+    bool log = false;
+    bool convert = false;
+    bool lists = false;
+    bool load = false;
+    HSLStripLayout layout = HSL_STRIP_LAYOUT;
+};
+
+struct BenchResult {
+    uint32_t checksum;
+    double usPerFrame;
+    double allocsPerFrame;
+    size_t peakHeap;
+    size_t loadHeap;
+    unsigned long loadAllocs;   // heap allocations made by jsonToScript()
+};
+
+// PhyisicalLedStrip that can read back the pixels it was sent
+class BenchStrip : public PhyisicalLedStrip {
+    public:
+        BenchStrip(int pin, uint16_t ledCount) : PhyisicalLedStrip(pin,ledCount,NEO_GRB,100) {}
+
+        uint32_t checksum(uint32_t hash) {
+            const uint8_t* pixels = m_controller->getPixels();
+            for(int i=0;i<getCount()*3;i++) {
+                hash = (hash ^ pixels[i]) * 16777619u;
+            }
+            return hash;
+        }
+};
+
+static char* readFile(const char * path) {
+    FILE* fp = fopen(path,"rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp,0,SEEK_END);
+    long len = ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    char* text = (char*)malloc(len+1);
+    size_t got = fread(text,1,len,fp);
+    text[got] = 0;
+    fclose(fp);
+    return text;
+}
+
+static bool runScript(JsonObject* json, const BenchOptions& options, BenchResult& result) {
+    Config config;
+    Config::setInstance(&config);
+    CompoundLedStrip* compound = new CompoundLedStrip();
+    BenchStrip* strips[options.strips];
+    for(int i=0;i<options.strips;i++) {
+        config.addPin(i,options.leds);
+        strips[i] = new BenchStrip(i,options.leds);
+        compound->add(strips[i]);
+    }
+    HSLStrip* strip = new HSLStrip(compound,options.layout);
+
+    Host::resetHeapPeak();
+    size_t startHeap = Host::heapUsed();
+
+    // each script is loaded from its own root the same way the app loads a file
+    DRString text = json->toJsonString();
+    ScriptDataLoader loader;
+    JsonRoot* root = loader.parse(text.text());
+    unsigned long loadStartAllocs = Host::allocationCount();
+    Script* script = loader.jsonToScript(root);
+    result.loadAllocs = Host::allocationCount()-loadStartAllocs;
+    if (script == NULL) {
+        delete root;
+        delete strip;
+        Config::setInstance(NULL);
+        return false;
+    }
+    script->begin(strip,NULL);
+    result.loadHeap = Host::heapUsed()-startHeap;
+
+    // one untimed frame so lazily created state is not charged to the loop
+    Host::advanceMillis(max(script->getFrequencyMSec(),1));
+    script->step();
+
+    unsigned long startAllocs = Host::allocationCount();
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0;i<options.steps;i++) {
+        Host::advanceMillis(max(script->getFrequencyMSec(),1));
+        script->step();
+    }
+    auto elapsed = std::chrono::steady_clock::now()-start;
+    unsigned long allocs = Host::allocationCount()-startAllocs;
+
+    // replay the same frames (same clock and random sequence) for the checksum
+    // so hashing does not count against the timing
+    script->destroy();
+    delete root;
+    srand(1);
+    Host::setMillis(1000000);
+    root = loader.parse(text.text());
+    script = loader.jsonToScript(root);
+    script->begin(strip,NULL);
+    result.checksum = 2166136261u;
+    for(int i=0;i<=options.steps;i++) {
+        Host::advanceMillis(max(script->getFrequencyMSec(),1));
+        script->step();
+        for(int s=0;s<options.strips;s++) {
+            result.checksum = strips[s]->checksum(result.checksum);
+        }
+    }
+
+    result.usPerFrame = std::chrono::duration<double,std::micro>(elapsed).count()/options.steps;
+    result.allocsPerFrame = (double)allocs/options.steps;
+    result.peakHeap = Host::heapPeak()-startHeap;
+
+    script->destroy();
+    delete root;
+    delete strip;
+    Config::setInstance(NULL);
+    return true;
+}
+
+// HSL->RGB conversion of one strip's pixels, the way HSLStrip::show() used to and does now
+static void runConversion(const BenchOptions& options) {
+    int count = options.leds;
+    int16_t* hue = (int16_t*)malloc(sizeof(int16_t)*count);
+    int8_t* saturation = (int8_t*)malloc(count);
+    int8_t* lightness = (int8_t*)malloc(count);
+    HSLPixel* pixels = (HSLPixel*)malloc(sizeof(HSLPixel)*count);
+    CRGB* rgb = (CRGB*)malloc(sizeof(CRGB)*count);
+    for(int i=0;i<count;i++) {
+        hue[i] = rand()%361;
+        saturation[i] = rand()%101;
+        lightness[i] = rand()%101;
+        pixels[i].hue = hue[i];
+        pixels[i].saturation = saturation[i];
+        pixels[i].lightness = lightness[i];
+    }
+    uint32_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int step=0;step<options.steps;step++) {
+        for(int i=0;i<count;i++) {
+            rgb[i] = HSLToRGB(CHSL(hue[i],saturation[i],lightness[i]));
+        }
+        checksum += rgb[step%count].red;
+    }
+    double floatUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/options.steps;
+
+    start = std::chrono::steady_clock::now();
+    for(int step=0;step<options.steps;step++) {
+        HSLToRGB(hue,saturation,lightness,rgb,count);
+        checksum += rgb[step%count].red;
+    }
+    double fixedUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/options.steps;
+
+    start = std::chrono::steady_clock::now();
+    for(int step=0;step<options.steps;step++) {
+        HSLToRGB(pixels,rgb,count);
+        checksum += rgb[step%count].red;
+    }
+    double packedUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/options.steps;
+
+    printf("%d pixels, %d passes (%x)\n",count,options.steps,checksum);
+    printf("%-28s %12.2f us\n","HSLToRGB",floatUs);
+    printf("%-28s %12.2f us %8.2fx\n","HSLToRGB batch (soa)",fixedUs,floatUs/fixedUs);
+    printf("%-28s %12.2f us %8.2fx\n","HSLToRGB batch (interleaved)",packedUs,floatUs/packedUs);
+    free(hue);
+    free(saturation);
+    free(lightness);
+    free(pixels);
+    free(rgb);
+}
+
+class BenchListItem {
+    public:
+        BenchListItem(int value) { m_value = value;}
+        void destroy() { delete this;}
+        int m_value;
+};
+
+struct ListBenchResult {
+    double buildUs;     // add the items and destroy the list
+    double getUs;       // get(i) for every item, the way PatternValue and FunctionArgs read
+    double eachUs;      // each() over every item, the way containers run commands
+    double churnUs;     // add one at the end and remove the first, the way templates replace instances
+    unsigned long allocs;
+    uint32_t checksum;
+};
+
+template<class LIST>
+static void timeList(int count, int passes, ListBenchResult& result) {
+    result.checksum = 0;
+    unsigned long startAllocs = Host::allocationCount();
+    auto start = std::chrono::steady_clock::now();
+    for(int pass=0;pass<passes;pass++) {
+        LIST list;
+        for(int i=0;i<count;i++) {
+            list.add(new BenchListItem(i));
+        }
+        result.checksum += list.size();
+    }
+    result.buildUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/passes;
+    result.allocs = (Host::allocationCount()-startAllocs)/passes;
+
+    LIST list;
+    for(int i=0;i<count;i++) {
+        list.add(new BenchListItem(i));
+    }
+    start = std::chrono::steady_clock::now();
+    for(int pass=0;pass<passes;pass++) {
+        for(int i=0;i<count;i++) {
+            result.checksum += list.get(i)->m_value;
+        }
+    }
+    result.getUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/passes;
+
+    start = std::chrono::steady_clock::now();
+    for(int pass=0;pass<passes;pass++) {
+        list.each([&](BenchListItem* item) { result.checksum += item->m_value;});
+    }
+    result.eachUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/passes;
+
+    start = std::chrono::steady_clock::now();
+    for(int pass=0;pass<passes;pass++) {
+        list.add(new BenchListItem(pass));
+        list.removeAt(0);
+    }
+    result.churnUs = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/passes;
+}
+
+static void runLists(const BenchOptions& options) {
+    int sizes[] = {4,16,64};
+    printf("%d passes.  times in us per pass\n",options.steps);
+    printf("%-28s %10s %10s %10s %10s %12s\n","list","build","get all","each","churn","build allocs");
+    for(int size : sizes) {
+        ListBenchResult linked;
+        ListBenchResult small;
+        timeList<PtrList<BenchListItem*>>(size,options.steps,linked);
+        timeList<PtrSmallList<BenchListItem*>>(size,options.steps,small);
+        if (linked.checksum != small.checksum) {
+            printf("checksums differ for %d items\n",size);
+        }
+        char name[40];
+        snprintf(name,sizeof(name),"PtrList %d",size);
+        printf("%-28s %10.2f %10.2f %10.2f %10.3f %12lu\n",name,linked.buildUs,linked.getUs,linked.eachUs,linked.churnUs,linked.allocs);
+        snprintf(name,sizeof(name),"PtrSmallList %d",size);
+        printf("%-28s %10.2f %10.2f %10.2f %10.3f %12lu\n",name,small.buildUs,small.getUs,small.eachUs,small.churnUs,small.allocs);
+    }
+}
+
+struct LoadBenchResult {
+    size_t peakHeap;        // above the heap used before loading, text not included
+    unsigned long allocs;
+    double us;
+};
+
+enum LoadPath {
+    LOAD_DOM,           // parse() copies strings, then jsonToScript()
+    LOAD_IN_PLACE,      // JsonParser::readInPlace(), then jsonToScript()
+    LOAD_STREAM,        // streamToScript()
+    LOAD_CACHE          // cacheToScript() from the compiled form loadScript() keeps
+};
+
+static bool timeLoad(const char * json, LoadPath path, LoadBenchResult& result) {
+    // readInPlace() changes the text so each load gets its own copy, like a file buffer
+    char * text = strdup(json);
+    ScriptDataLoader loader;
+    // the compiled form is made before timing, like a file written on an earlier load
+    size_t length = strlen(json);
+    ScriptCacheWriter cache(DRStringTable::hash(json,length),length);
+    if (path == LOAD_CACHE) {
+        Script* compiled = loader.streamToScript(text,&cache);
+        if (compiled == NULL || !cache.finish()) {
+            free(text);
+            return false;
+        }
+        compiled->destroy();
+    }
+    Host::resetHeapPeak();
+    size_t startHeap = Host::heapUsed();
+    unsigned long startAllocs = Host::allocationCount();
+    auto start = std::chrono::steady_clock::now();
+    Script* script = NULL;
+    if (path == LOAD_STREAM) {
+        script = loader.streamToScript(text);
+    } else if (path == LOAD_CACHE) {
+        ScriptCacheReader reader(cache.getData(),cache.getLength());
+        script = reader.isValid(DRStringTable::hash(json,length),length) ? loader.cacheToScript(reader) : NULL;
+    } else {
+        JsonParser parser;
+        JsonRoot* root = path == LOAD_IN_PLACE ? parser.readInPlace(text) : parser.read(text);
+        script = root ? loader.jsonToScript(root) : NULL;
+        delete root;
+    }
+    result.us = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+    result.allocs = Host::allocationCount()-startAllocs;
+    result.peakHeap = Host::heapPeak()-startHeap;
+    free(text);
+    if (script == NULL) {
+        return false;
+    }
+    script->destroy();
+    return true;
+}
+
+static bool runLoad(JsonObject* json, const char * name) {
+    DRString text = json->toJsonString();
+    LoadBenchResult dom;
+    LoadBenchResult inPlace;
+    LoadBenchResult stream;
+    LoadBenchResult cache;
+    if (!timeLoad(text.text(),LOAD_DOM,dom) || !timeLoad(text.text(),LOAD_IN_PLACE,inPlace) || !timeLoad(text.text(),LOAD_STREAM,stream)
+        || !timeLoad(text.text(),LOAD_CACHE,cache)) {
+        return false;
+    }
+    printf("%-28s %8zu %10zu %10zu %10zu %10zu %10lu %10lu %10lu %10lu %10.1f %10.1f %10.1f %10.1f\n",name,(size_t)text.getLength(),
+        dom.peakHeap,inPlace.peakHeap,stream.peakHeap,cache.peakHeap,dom.allocs,inPlace.allocs,stream.allocs,cache.allocs,
+        dom.us,inPlace.us,stream.us,cache.us);
+    return true;
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions& options) {
+    for(int i=1;i<argc;i++) {
+        const char * arg = argv[i];
+        const char * next = i+1<argc ? argv[i+1] : NULL;
+        if (strcmp(arg,"--log") == 0) {
+            options.log = true;
+        } else if (strcmp(arg,"--convert") == 0) {
+            options.convert = true;
+        } else if (strcmp(arg,"--lists") == 0) {
+            options.lists = true;
+        } else if (strcmp(arg,"--load") == 0) {
+            options.load = true;
+        } else if (next == NULL) {
+            fprintf(stderr,"missing value for %s\n",arg);
+            return false;
+        } else if (strcmp(arg,"--scripts") == 0) {
+            options.scriptsPath = next; i++;
+        } else if (strcmp(arg,"--script") == 0) {
+            options.scriptName = next; i++;
+        } else if (strcmp(arg,"--steps") == 0) {
+            options.steps = max(atoi(next),1); i++;
+        } else if (strcmp(arg,"--leds") == 0) {
+            options.leds = max(atoi(next),1); i++;
+        } else if (strcmp(arg,"--strips") == 0) {
+            options.strips = max(atoi(next),1); i++;
+        } else if (strcmp(arg,"--layout") == 0) {
+            options.layout = strcmp(next,"soa") == 0 ? HSL_LAYOUT_SOA : HSL_LAYOUT_INTERLEAVED; i++;
+        } else {
+            fprintf(stderr,"unknown option %s\n",arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseArgs(argc,argv,options)) {
+        return 2;
+    }
+    Host::muteSerial(!options.log);
+    Host::useSimulatedClock(true);
+    Serial.begin(115200);
+
+    if (options.convert) {
+        runConversion(options);
+        return 0;
+    }
+    if (options.lists) {
+        runLists(options);
+        return 0;
+    }
+
+    char* text = readFile(options.scriptsPath);
+    if (text == NULL) {
+        fprintf(stderr,"cannot read %s\n",options.scriptsPath);
+        return 2;
+    }
+    JsonParser parser;
+    JsonRoot* scripts = parser.read(text);
+    JsonArray* arr = scripts ? scripts->getTopArray() : NULL;
+    if (arr == NULL) {
+        fprintf(stderr,"%s is not a JSON array of scripts\n",options.scriptsPath);
+        return 2;
+    }
+
+    if (options.load) {
+        printf("%-28s %8s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n","script","text",
+            "dom peak","inplace","sax","cache","dom allocs","inplace","sax","cache","dom us","inplace","sax","cache");
+    } else {
+        printf("%d steps, %d strips x %d leds\n",options.steps,options.strips,options.leds);
+        printf("%-28s %12s %12s %12s %12s %12s %10s\n","script","us/frame","allocs/frame","load allocs","load bytes","peak bytes","checksum");
+    }
+    int failed = 0;
+    int run = 0;
+    arr->each([&](JsonElement* item) {
+        JsonObject* json = item->asObject();
+        if (json == NULL) {
+            return;
+        }
+        const char * name = json->get("name","unnamed");
+        if (options.scriptName != NULL && strcmp(options.scriptName,name) != 0) {
+            return;
+        }
+        run++;
+        if (options.load) {
+            if (!runLoad(json,name)) {
+                printf("%-28s failed to load\n",name);
+                failed++;
+            }
+            return;
+        }
+        BenchResult result;
+        if (runScript(json,options,result)) {
+            printf("%-28s %12.2f %12.2f %12lu %12zu %12zu %10x\n",name,result.usPerFrame,result.allocsPerFrame,result.loadAllocs,result.loadHeap,result.peakHeap,result.checksum);
+        } else {
+            printf("%-28s failed to load\n",name);
+            failed++;
+        }
+    });
+    delete scripts;
+    free(text);
+    if (run == 0) {
+        fprintf(stderr,"no scripts run\n");
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
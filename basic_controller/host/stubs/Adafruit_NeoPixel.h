@@ -0,0 +1,71 @@
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+
+// Host stand-in for Adafruit_NeoPixel.  Pixels are kept in memory so the
+// benchmark and tests can read back what a frame wrote.
+
+#include "./Arduino.h"
+
+typedef uint16_t neoPixelType;
+
+#define NEO_RGB  ((0<<6) | (0<<4) | (1<<2) | (2))
+#define NEO_RBG  ((0<<6) | (0<<4) | (2<<2) | (1))
+#define NEO_GRB  ((1<<6) | (1<<4) | (0<<2) | (2))
+#define NEO_GBR  ((2<<6) | (2<<4) | (0<<2) | (1))
+#define NEO_BRG  ((1<<6) | (1<<4) | (2<<2) | (0))
+#define NEO_BGR  ((2<<6) | (2<<4) | (1<<2) | (0))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+class Adafruit_NeoPixel {
+    public:
+        Adafruit_NeoPixel(uint16_t n, int16_t pin=6, neoPixelType type=NEO_GRB+NEO_KHZ800) {
+            m_count = n;
+            m_pin = pin;
+            m_brightness = 0;
+            m_showCount = 0;
+            m_pixels = (uint8_t*)calloc(n ? n*3 : 1,1);
+        }
+
+        ~Adafruit_NeoPixel() {
+            free(m_pixels);
+        }
+
+        void begin() {}
+        void show() { m_showCount++;}
+        void clear() { memset(m_pixels,0,m_count*3);}
+        void setBrightness(uint8_t b) { m_brightness = b;}
+        uint8_t getBrightness() const { return m_brightness;}
+
+        void setPixelColor(uint16_t n, uint32_t c) {
+            if (n >= m_count) { return;}
+            uint8_t* p = m_pixels+n*3;
+            p[0] = (uint8_t)(c>>16);
+            p[1] = (uint8_t)(c>>8);
+            p[2] = (uint8_t)c;
+        }
+
+        uint32_t getPixelColor(uint16_t n) const {
+            if (n >= m_count) { return 0;}
+            const uint8_t* p = m_pixels+n*3;
+            return ((uint32_t)p[0]<<16) | ((uint32_t)p[1]<<8) | p[2];
+        }
+
+        static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+            return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+        }
+
+        uint16_t numPixels() const { return m_count;}
+        int16_t getPin() const { return m_pin;}
+        uint8_t* getPixels() const { return m_pixels;}
+        unsigned long getShowCount() const { return m_showCount;}
+
+    private:
+        uint16_t m_count;
+        int16_t m_pin;
+        uint8_t m_brightness;
+        uint8_t* m_pixels;
+        unsigned long m_showCount;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host (Linux) stand-in for the parts of the ESP8266 Arduino core the
+// script engine uses.  Only what lib/* needs is here - this is not an
+// emulator.  The matching definitions are in host_arduino.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+using std::round;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+int analogRead(uint8_t pin);
+
+class String {
+    public:
+        String(const char * text=NULL) : m_text(text ? text : "") {}
+        String(const String& other) : m_text(other.m_text) {}
+
+        String& operator=(const char * text) { m_text = text ? text : ""; return *this;}
+        String& operator=(const String& other) { m_text = other.m_text; return *this;}
+
+        const char * c_str() const { return m_text.c_str();}
+        unsigned int length() const { return m_text.length();}
+    private:
+        std::string m_text;
+};
+
+class HardwareSerial {
+    public:
+        void begin(unsigned long baud);
+        void printf(const char * format,...);
+        void println(const char * text);
+        void print(const char * text);
+        operator bool() const { return m_begun;}
+    private:
+        bool m_begun;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+    public:
+        uint32_t getFreeHeap();
+        uint32_t getFreeContStack();
+        uint32_t getMaxFreeBlockSize();
+        void restart();
+};
+
+extern EspClass ESP;
+
+// host-only controls for the benchmark and test runners
+class Host {
+    public:
+        // simulated clock: millis() only moves when advanceMillis() or delay() is called
+        static void useSimulatedClock(bool simulated=true);
+        static void advanceMillis(unsigned long ms);
+        static void setMillis(unsigned long ms);
+
+        static void muteSerial(bool mute=true);
+
+        static size_t heapUsed();
+        static size_t heapPeak();
+        static void resetHeapPeak();
+        static unsigned long allocationCount();
+
+        // directory that stands in for the LittleFS root
+        static void setFileSystemRoot(const char * path);
+        static const char * getFileSystemRoot();
+};
+
+#endif
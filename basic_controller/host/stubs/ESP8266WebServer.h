@@ -0,0 +1,35 @@
+#ifndef HOST_ESP8266WEBSERVER_H
+#define HOST_ESP8266WEBSERVER_H
+
+// Host stand-in for the request/response side of ESP8266WebServer.  There
+// is no network; the last response is kept so tests can inspect it.
+
+#include "./Arduino.h"
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+class ESP8266WebServer {
+    public:
+        ESP8266WebServer(int port=80) { m_code = 0;}
+
+        void send(int code, const char * contentType=NULL, const char * content=NULL) {
+            m_code = code;
+            m_contentType = contentType;
+            m_content = content ? content : "";
+        }
+
+        void setContentLength(size_t length) {}
+        void sendContent(const char * content) { m_content += content;}
+        void sendContent(const char * content, size_t length) { m_content.append(content,length);}
+        void sendHeader(const char * name, const char * value, bool first=false) {}
+
+        int getCode() const { return m_code;}
+        const char * getContent() const { return m_content.c_str();}
+        const char * getContentType() const { return m_contentType.c_str();}
+    private:
+        int m_code;
+        String m_contentType;
+        std::string m_content;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+// Host stand-in for the ESP8266 FS classes.  Paths are mapped into the
+// directory given by Host::setFileSystemRoot().
+
+#include "./Arduino.h"
+#include <dirent.h>
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File {
+    public:
+        File(FILE* fp=NULL, bool isFile=false) : m_fp(fp), m_isFile(isFile) {}
+
+        bool isFile() const { return m_fp != NULL && m_isFile;}
+        operator bool() const { return m_fp != NULL;}
+
+        size_t size() {
+            if (m_fp == NULL) { return 0;}
+            long pos = ftell(m_fp);
+            fseek(m_fp,0,SEEK_END);
+            long len = ftell(m_fp);
+            fseek(m_fp,pos,SEEK_SET);
+            return len < 0 ? 0 : (size_t)len;
+        }
+
+        bool seek(uint32_t pos, SeekMode mode=SeekSet) {
+            if (m_fp == NULL) { return false;}
+            int whence = mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET;
+            return fseek(m_fp,pos,whence) == 0;
+        }
+
+        size_t read(uint8_t* buf, size_t size) {
+            return m_fp == NULL ? 0 : fread(buf,1,size,m_fp);
+        }
+
+        size_t write(const uint8_t* buf, size_t size) {
+            return m_fp == NULL ? 0 : fwrite(buf,1,size,m_fp);
+        }
+
+        size_t write(const char* buf, size_t size) {
+            return write((const uint8_t*)buf,size);
+        }
+
+        void close() {
+            if (m_fp) { fclose(m_fp);}
+            m_fp = NULL;
+        }
+
+    private:
+        FILE* m_fp;
+        bool m_isFile;
+};
+
+class Dir {
+    public:
+        Dir(DIR* dir=NULL) : m_dir(dir) {}
+        Dir(const Dir& other) : m_dir(other.m_dir) { ((Dir&)other).m_dir = NULL;}
+        ~Dir() { if (m_dir) { closedir(m_dir);} }
+
+        bool next() {
+            if (m_dir == NULL) { return false;}
+            struct dirent* entry;
+            while((entry = readdir(m_dir)) != NULL) {
+                if (entry->d_name[0] != '.') {
+                    m_fileName = entry->d_name;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        String fileName() const { return m_fileName;}
+    private:
+        DIR* m_dir;
+        String m_fileName;
+};
+
+namespace fs {
+    class FS {
+        public:
+            bool begin();
+            bool exists(const char* path);
+            bool remove(const char* path);
+            File open(const char* path, const char* mode);
+            Dir openDir(const char* path);
+    };
+}
+
+using fs::FS;
+
+#endif
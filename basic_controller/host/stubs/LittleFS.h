@@ -0,0 +1,8 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "./FS.h"
+
+extern fs::FS LittleFS;
+
+#endif
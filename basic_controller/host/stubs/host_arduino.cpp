@@ -0,0 +1,236 @@
+#include "./Arduino.h"
+#include "./FS.h"
+#include "./LittleFS.h"
+
+#include <chrono>
+#include <thread>
+#include <malloc.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*
+ * heap tracking.  malloc/free are replaced so ESP.getFreeHeap() moves the
+ * same way it does on the device and the benchmark can count allocations.
+ * operator new/delete end up here through libstdc++.
+ */
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void  __libc_free(void* ptr);
+}
+
+// Reported heap size.  Large enough that host-only allocations never make
+// getFreeHeap() wrap; only differences between two readings mean anything.
+static const size_t HOST_HEAP_SIZE = 256*1024*1024;
+
+static size_t hostHeapUsed = 0;
+static size_t hostHeapPeak = 0;
+static unsigned long hostAllocationCount = 0;
+
+static void trackAlloc(void* ptr) {
+    if (ptr == NULL) { return;}
+    hostHeapUsed += malloc_usable_size(ptr);
+    hostAllocationCount++;
+    if (hostHeapUsed > hostHeapPeak) {
+        hostHeapPeak = hostHeapUsed;
+    }
+}
+
+static void trackFree(void* ptr) {
+    if (ptr == NULL) { return;}
+    hostHeapUsed -= malloc_usable_size(ptr);
+}
+
+extern "C" {
+    void* malloc(size_t size) {
+        void* ptr = __libc_malloc(size);
+        trackAlloc(ptr);
+        return ptr;
+    }
+
+    void* calloc(size_t count, size_t size) {
+        void* ptr = __libc_calloc(count,size);
+        trackAlloc(ptr);
+        return ptr;
+    }
+
+    void* realloc(void* old, size_t size) {
+        trackFree(old);
+        void* ptr = __libc_realloc(old,size);
+        if (ptr == NULL && size != 0) {
+            // realloc failed and old is still allocated
+            trackAlloc(old);
+            return NULL;
+        }
+        trackAlloc(ptr);
+        return ptr;
+    }
+
+    void free(void* ptr) {
+        trackFree(ptr);
+        __libc_free(ptr);
+    }
+}
+
+size_t Host::heapUsed() { return hostHeapUsed;}
+size_t Host::heapPeak() { return hostHeapPeak;}
+void Host::resetHeapPeak() { hostHeapPeak = hostHeapUsed;}
+unsigned long Host::allocationCount() { return hostAllocationCount;}
+
+/* clock */
+static bool hostSimulatedClock = false;
+static unsigned long hostSimulatedMillis = 0;
+
+static unsigned long realMicros() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now()-start;
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void Host::useSimulatedClock(bool simulated) {
+    if (simulated && !hostSimulatedClock) {
+        hostSimulatedMillis = realMicros()/1000;
+    }
+    hostSimulatedClock = simulated;
+}
+
+void Host::advanceMillis(unsigned long ms) {
+    hostSimulatedMillis += ms;
+}
+
+void Host::setMillis(unsigned long ms) {
+    hostSimulatedMillis = ms;
+}
+
+unsigned long millis() {
+    return hostSimulatedClock ? hostSimulatedMillis : realMicros()/1000;
+}
+
+unsigned long micros() {
+    return hostSimulatedClock ? hostSimulatedMillis*1000 : realMicros();
+}
+
+void delay(unsigned long ms) {
+    if (hostSimulatedClock) {
+        hostSimulatedMillis += ms;
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+void yield() {}
+
+/* random */
+long random(long howBig) {
+    if (howBig <= 0) { return 0;}
+    return rand() % howBig;
+}
+
+long random(long howSmall, long howBig) {
+    if (howSmall >= howBig) { return howSmall;}
+    return howSmall + random(howBig-howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+    // keep runs repeatable.  the engine reseeds from analogRead()+millis()
+    // whenever it creates a function value.
+}
+
+int analogRead(uint8_t pin) { return 0;}
+
+/* Serial */
+HardwareSerial Serial;
+static bool hostSerialMuted = false;
+
+void Host::muteSerial(bool mute) { hostSerialMuted = mute;}
+
+void HardwareSerial::begin(unsigned long baud) { m_begun = true;}
+
+void HardwareSerial::printf(const char * format,...) {
+    char buf[1100];
+    va_list args;
+    va_start(args,format);
+    vsnprintf(buf,sizeof(buf),format,args);
+    va_end(args);
+    if (!hostSerialMuted) {
+        fputs(buf,stdout);
+    }
+}
+
+void HardwareSerial::print(const char * text) {
+    if (!hostSerialMuted) {
+        fputs(text,stdout);
+    }
+}
+
+void HardwareSerial::println(const char * text) {
+    if (!hostSerialMuted) {
+        fputs(text,stdout);
+        fputc('\n',stdout);
+    }
+}
+
+/* ESP */
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() { return (uint32_t)(HOST_HEAP_SIZE-hostHeapUsed);}
+uint32_t EspClass::getFreeContStack() { return 4096;}
+uint32_t EspClass::getMaxFreeBlockSize() { return getFreeHeap();}
+void EspClass::restart() { exit(0);}
+
+/* LittleFS */
+fs::FS LittleFS;
+static std::string hostFileSystemRoot = "./littlefs";
+
+void Host::setFileSystemRoot(const char * path) { hostFileSystemRoot = path;}
+const char * Host::getFileSystemRoot() { return hostFileSystemRoot.c_str();}
+
+static std::string hostPath(const char* path) {
+    std::string full = hostFileSystemRoot;
+    if (path == NULL || path[0] != '/') {
+        full += "/";
+    }
+    if (path != NULL) {
+        full += path;
+    }
+    return full;
+}
+
+static void makeParentDirs(const std::string& path) {
+    for(size_t pos=path.find('/',1);pos != std::string::npos;pos=path.find('/',pos+1)) {
+        mkdir(path.substr(0,pos).c_str(),0755);
+    }
+}
+
+bool fs::FS::begin() {
+    makeParentDirs(hostPath("/"));
+    return true;
+}
+
+bool fs::FS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(),&st) == 0;
+}
+
+bool fs::FS::remove(const char* path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+File fs::FS::open(const char* path, const char* mode) {
+    std::string full = hostPath(path);
+    struct stat st;
+    if (mode[0] == 'r') {
+        if (stat(full.c_str(),&st) != 0 || !S_ISREG(st.st_mode)) {
+            return File();
+        }
+    } else {
+        makeParentDirs(full);
+    }
+    FILE* fp = fopen(full.c_str(),mode[0] == 'r' ? "rb" : mode[0] == 'a' ? "ab" : "wb");
+    return File(fp,fp != NULL);
+}
+
+Dir fs::FS::openDir(const char* path) {
+    return Dir(opendir(hostPath(path).c_str()));
+}
@@ -1,11 +1,11 @@
 #ifndef APP_STATE_H
 #define APP_STATE_H
 
-#include "./parse_gen.h";
-#include "./logger.h";
-#include "./data.h";
-#include "./list.h";
-#include "./util.h";
+#include "./parse_gen.h"
+#include "./logger.h"
+#include "./data.h"
+#include "./list.h"
+#include "./util.h"
 
 namespace DevRelief {
     Logger AppStateLogger("AppState",APP_STATE_LOGGER_LEVEL);
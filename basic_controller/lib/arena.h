@@ -0,0 +1,222 @@
+#ifndef DR_ARENA_H
+#define DR_ARENA_H
+
+#include "./logger.h"
+
+namespace DevRelief {
+
+Logger ArenaLogger("Arena",WARN_LEVEL);
+
+#define ARENA_ALIGNMENT 8
+// before each ArenaObject allocation: the owning Arena* or NULL for the heap
+#define ARENA_HEADER_SIZE ARENA_ALIGNMENT
+
+class Arena;
+// the arena ArenaObjects are allocated from.  set with an ArenaScope
+Arena* CurrentArena = NULL;
+
+// totals for every Arena
+struct ArenaMemoryTotals {
+    uint32_t capacity;      // bytes in arena blocks
+    uint32_t allocated;     // bytes handed out, including alignment
+    uint32_t dead;          // bytes of objects deleted before their arena was released
+};
+ArenaMemoryTotals ArenaMemory = {0,0,0};
+
+// Logger::showMemory() lines for the arenas
+void showArenaMemory(Logger* logger, const char * label) {
+    if (ArenaMemory.capacity > 0) {
+        // wasted is dead objects plus the unused ends of blocks
+        logger->write(INFO_LEVEL,"%s: arena used=%d,  wasted=%d",label,(int)(ArenaMemory.allocated-ArenaMemory.dead),
+            (int)(ArenaMemory.capacity-ArenaMemory.allocated+ArenaMemory.dead));
+    }
+}
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;        // usable bytes after the header
+    size_t used;
+
+    char * data() { return ((char*)this)+HeaderSize();}
+
+    static size_t HeaderSize() { return (sizeof(ArenaBlock)+ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1);}
+};
+
+/* Arena is a bump allocator for objects that all go away together.  A
+ * Script owns one and ScriptDataLoader builds the script's values,
+ * commands, lists and strings in it, so loading a script takes a few
+ * ARENA_BLOCK_SIZE blocks from the heap instead of hundreds of small
+ * allocations, and deleting the script frees the blocks.
+ *
+ * Objects still have their destructors run.  Deleting one only counts its
+ * bytes as dead; the memory comes back when the arena is released.  Memory
+ * an object allocates itself (a string's characters) is still malloc'd.
+ */
+class Arena {
+    public:
+        Arena() {
+            m_logger = &ArenaLogger;
+            ShowMemoryHook = showArenaMemory;
+            m_blocks = NULL;
+            m_capacity = 0;
+            m_allocated = 0;
+            m_dead = 0;
+            m_blockCount = 0;
+        }
+
+        ~Arena() {
+            release();
+        }
+
+        // NULL if a block cannot be allocated.  ArenaObject then uses the heap
+        void* allocate(size_t size) {
+            size = (size+ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1);
+            ArenaBlock* block = m_blocks;
+            if (block == NULL || block->size - block->used < size) {
+                block = addBlock(size);
+                if (block == NULL) {
+                    return NULL;
+                }
+            }
+            void* ptr = block->data()+block->used;
+            block->used += size;
+            m_allocated += size;
+            ArenaMemory.allocated += size;
+            return ptr;
+        }
+
+        // an object in the arena was deleted
+        void freed(size_t size) {
+            if (m_blocks == NULL) {
+                m_logger->errorNoRepeat("object deleted after its arena was released");
+                return;
+            }
+            size = (size+ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1);
+            m_dead += size;
+            ArenaMemory.dead += size;
+        }
+
+        // free every block.  objects in the arena must already be destroyed
+        void release() {
+            ArenaBlock* block = m_blocks;
+            while(block != NULL) {
+                ArenaBlock* next = block->next;
+                free(block);
+                block = next;
+            }
+            ArenaMemory.capacity -= m_capacity;
+            ArenaMemory.allocated -= m_allocated;
+            ArenaMemory.dead -= m_dead;
+            m_blocks = NULL;
+            m_capacity = 0;
+            m_allocated = 0;
+            m_dead = 0;
+            m_blockCount = 0;
+        }
+
+        // bytes in live objects
+        size_t getUsed() { return m_allocated-m_dead;}
+        // dead objects and the unused ends of blocks
+        size_t getWasted() { return m_capacity-m_allocated+m_dead;}
+        size_t getCapacity() { return m_capacity;}
+        int getBlockCount() { return m_blockCount;}
+
+        // the arena an ArenaObject allocation came from.  NULL for the heap
+        static Arena* getOwner(const void* ptr) {
+            return *(Arena**)((const char*)ptr-ARENA_HEADER_SIZE);
+        }
+
+    private:
+        ArenaBlock* addBlock(size_t size) {
+            size_t blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+            ArenaBlock* block = (ArenaBlock*)malloc(ArenaBlock::HeaderSize()+blockSize);
+            if (block == NULL) {
+                m_logger->errorNoRepeat("out of memory for arena block");
+                return NULL;
+            }
+            block->size = blockSize;
+            block->used = 0;
+            if (m_blocks == NULL) {
+                block->next = NULL;
+                m_blocks = block;
+            } else if (size > ARENA_BLOCK_SIZE) {
+                // keep filling the current block
+                block->next = m_blocks->next;
+                m_blocks->next = block;
+            } else {
+                block->next = m_blocks;
+                m_blocks = block;
+            }
+            m_blockCount++;
+            m_capacity += blockSize;
+            ArenaMemory.capacity += blockSize;
+            return block;
+        }
+
+        Logger* m_logger;
+        ArenaBlock* m_blocks;   // the block being filled is first
+        size_t m_capacity;
+        size_t m_allocated;
+        size_t m_dead;
+        int m_blockCount;
+};
+
+// ArenaObjects created while an ArenaScope exists go in its arena.  a class
+// with its own current arena (JSON elements) passes that pointer
+class ArenaScope {
+    public:
+        ArenaScope(Arena* arena, Arena** current=&CurrentArena) {
+            m_current = current;
+            m_previous = *current;
+            *current = arena;
+        }
+        ~ArenaScope() {
+            *m_current = m_previous;
+        }
+    private:
+        Arena** m_current;
+        Arena* m_previous;
+};
+
+/* base for classes a script is built from.  new uses the current arena if
+ * there is one and the heap otherwise.  an arena object must be deleted
+ * before its arena is released.  each allocation starts with a header
+ * naming its arena so delete does not have to search for it.
+ */
+class ArenaObject {
+    public:
+        static void* operator new(size_t size) {
+            return allocate(CurrentArena,size);
+        }
+
+        static void operator delete(void* ptr, size_t size) {
+            release(ptr,size);
+        }
+
+        // for classes with their own operator new.  the heap if arena is NULL or full
+        static void* allocate(Arena* arena, size_t size) {
+            void* header = arena == NULL ? NULL : arena->allocate(ARENA_HEADER_SIZE+size);
+            if (header == NULL) {
+                arena = NULL;
+                header = ::operator new(ARENA_HEADER_SIZE+size);
+            }
+            *(Arena**)header = arena;
+            return ((char*)header)+ARENA_HEADER_SIZE;
+        }
+
+        static void release(void* ptr, size_t size) {
+            if (ptr == NULL) {
+                return;
+            }
+            void* header = ((char*)ptr)-ARENA_HEADER_SIZE;
+            Arena* arena = *(Arena**)header;
+            if (arena != NULL) {
+                arena->freed(ARENA_HEADER_SIZE+size);
+            } else {
+                ::operator delete(header);
+            }
+        }
+};
+
+}
+#endif
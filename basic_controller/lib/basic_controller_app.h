@@ -39,6 +39,8 @@ namespace DevRelief {
                 return;
             }
             m_logger->showMemory();
+            // tests log synchronously.  the app defers messages to the idle part of the loop
+            BinaryLog.start();
             initialize();
             resume();
         }
@@ -92,6 +94,8 @@ namespace DevRelief {
             }
             m_httpServer->handleClient();
             m_executor.step();
+            // step() returns right away between frames so this runs while the LEDs are idle
+            BinaryLog.drain(BINARY_LOG_SIZE,BINARY_LOG_DRAIN_MSECS);
         }
 
         void initialize() {
@@ -135,14 +139,8 @@ namespace DevRelief {
                 SharedPtr<JsonRoot> jsonRoot = configDataLoader.toJson(m_config);
                 JsonElement*json = jsonRoot->getTopElement();
                 ApiResult api(json);
-                DRString apiText;
-                
-                api.toText(apiText);
-                const char * text = apiText.text();
                 m_logger->debug("sending response");
-                m_logger->debug("%s",text);
-                
-                resp->send(200,"text/json",text);
+                api.write(resp);
             });
 
 
@@ -154,10 +152,8 @@ namespace DevRelief {
                 m_executor.configChange(m_config);
 
                 ApiResult result(true);
-                DRString apiText;
-                result.toText(apiText);
                 resume();
-                resp->send(200,"text/json",apiText.text());
+                result.write(resp);
             });
 
 
@@ -220,6 +216,40 @@ namespace DevRelief {
 
 
 
+            // recent log messages, including ones already written to Serial
+            m_httpServer->routeBracesGet( "/api/log",[this](Request* req, Response* resp){
+                JsonRoot root;
+                JsonObject* log = root.createObject();
+                log->set("written",(int)BinaryLog.getWritten());
+                log->set("pending",(int)BinaryLog.getPending());
+                log->set("dropped",(int)BinaryLog.getDropped());
+                JsonArray* entries = log->createArray("entries");
+                char message[160];
+                for(int i=0;i<BinaryLog.getRecentCount();i++) {
+                    if (BinaryLog.formatRecent(i,message,sizeof(message))) {
+                        entries->add(message);
+                    }
+                }
+                ApiResult api(log);
+                api.write(resp);
+            });
+
+            // step phase and command times and frame counters of the running script.  ?reset=1 starts over
+            m_httpServer->routeBracesGet( "/api/profile",[this](Request* req, Response* resp){
+                JsonRoot root;
+                JsonObject* profile = root.createObject();
+                ScriptProfile.toJson(profile);
+                Script* script = m_executor.getScript();
+                if (script) {
+                    script->getScheduler()->toJson(profile->createObject("frames"));
+                }
+                if (req->hasArg("reset")) {
+                    ScriptProfile.reset();
+                }
+                ApiResult api(profile);
+                api.write(resp);
+            });
+
             m_httpServer->routeBracesGet("/api/{}",[this](Request* req, Response* resp){
 
                 this->apiRequest(req->pathArg(0).c_str(),req,resp);
@@ -294,11 +324,10 @@ namespace DevRelief {
 
         bool runScript(const char * name, JsonObject* params, ApiResult& result) {
             ScriptDataLoader loader;
-            LoadResult load;
             m_logger->debug("load script %s",name);
-            if (loader.loadScriptJson(name ,load)){
-                m_logger->debug("\tloaded file");
-                Script* script = loader.jsonToScript(load);
+            if (loader.scriptExists(name)){
+                // the compiled script unless the JSON has changed
+                Script* script = loader.loadScript(name);
                 m_logger->debug("\tloaded script");
                 
                 if (script == NULL) {
@@ -50,6 +50,9 @@ public:
         return (const char *) m_data;
     }
 
+    // text() for a reader that changes it in place, like JsonParser::readInPlace()
+    char * writableText() { return (char*)text();}
+
     uint8_t* reserve(size_t length) {
         if (length > m_maxLength) {
             if (length < 128) {
@@ -59,9 +62,8 @@ public:
             uint8_t* newData = (uint8_t*)malloc(length+1);
             m_logger->info("allocated buffer");
             if (m_data != NULL) {
-                if (length > 0) {
-                    memcpy(newData,m_data,length);
-                }
+                // the old data has m_maxLength+1 bytes
+                memcpy(newData,m_data,m_maxLength+1);
                 free(m_data);
 
             } else {
@@ -181,6 +181,97 @@ namespace DevRelief {
         return rgb;
     }
 
+    /* Fixed-point version of HSLToRGB() for converting a whole strip each frame.
+     * Everything fits in 16 bits (the ESP8266 has no FPU) and there are no
+     * branches the compiler cannot turn into selects, so the host build
+     * vectorizes the batch loop.  Each channel is within 1 of the double
+     * precision result.
+     *   hue 0-360, saturation 0-100, lightness 0-100.  callers must clamp.
+     */
+
+    // high 16 bits of a 16x16 multiply
+    inline uint16_t MulHigh16(uint16_t a, uint16_t b) {
+        return ((uint32_t)a*b)>>16;
+    }
+
+    // HueToRGB() weight of v2 over v1 in 1/60ths for a channel hue in degrees
+    inline uint16_t HueWeight(uint16_t hue) {
+        uint16_t weight = hue < 60 ? hue : 60;
+        uint16_t fall = hue < 240 ? 240 - hue : 0;
+        return fall < weight ? fall : weight;
+    }
+
+    // base and slope are 8.8 fixed-point channel values.  slope is per degree of weight
+    inline uint8_t HueToRGBFixed(uint16_t base, uint16_t slope, uint16_t hue) {
+        return (uint16_t)(base + slope*HueWeight(hue)) >> 8;
+    }
+
+    inline CRGB HSLToRGBFixed(uint16_t hue, uint16_t saturation, uint16_t lightness) {
+        if (hue >= 360) {
+            hue -= 360;
+        }
+        // v1 and v2 from HSLToRGB() in 1/10000ths
+        uint16_t v2 = lightness < 50 ? lightness*(100+saturation) : 100*(lightness+saturation) - lightness*saturation;
+        uint16_t v1 = 200*lightness - v2;
+        // 255/10000 and 255/600000 scaled to 8.8
+        uint16_t base = MulHigh16(v1*2,53478)*4;
+        uint16_t slope = MulHigh16((v2-v1)*4,1783);
+        uint16_t red = hue + 120;
+        if (red >= 360) {
+            red -= 360;
+        }
+        uint16_t blue = hue + 240;
+        if (blue >= 360) {
+            blue -= 360;
+        }
+        return CRGB(HueToRGBFixed(base,slope,red),HueToRGBFixed(base,slope,hue),HueToRGBFixed(base,slope,blue));
+    }
+
+    inline CRGB HSLToRGBFixed(const CHSL& hsl) {
+        return HSLToRGBFixed(hsl.hue,hsl.saturation,hsl.lightness);
+    }
+
+    // the host build gets an AVX2 copy of the batch loop picked at run time.  the device has no SIMD
+    #if defined(__GNUC__) && defined(__x86_64__)
+        #define HSL_BATCH_TARGETS __attribute__((target_clones("avx2","default")))
+    #else
+        #define HSL_BATCH_TARGETS
+    #endif
+
+    // one pixel of a packed HSL frame buffer.  negative values are unset
+    struct HSLPixel {
+        int16_t hue;
+        int8_t  saturation;
+        int8_t  lightness;
+    };
+
+    /* unset values follow HSLStrip: a negative hue is black, saturation
+     * outside 0-100 is 100 and lightness outside 0-100 is 50.
+     */
+    inline CRGB UnsetHSLToRGB(int16_t hue, int16_t saturation, int16_t lightness) {
+        lightness = hue < 0 ? 0 : lightness;
+        hue = hue < 0 ? 0 : (hue > 360 ? 360 : hue);
+        saturation = (uint16_t)saturation > 100 ? 100 : saturation;
+        lightness = (uint16_t)lightness > 100 ? 50 : lightness;
+        return HSLToRGBFixed(hue,saturation,lightness);
+    }
+
+    // convert count pixels stored as separate hue/saturation/lightness arrays
+    HSL_BATCH_TARGETS
+    void HSLToRGB(const int16_t* hue, const int8_t* saturation, const int8_t* lightness, CRGB* rgb, int count) {
+        for(int idx=0;idx<count;idx++) {
+            rgb[idx] = UnsetHSLToRGB(hue[idx],saturation[idx],lightness[idx]);
+        }
+    }
+
+    // convert count packed pixels
+    HSL_BATCH_TARGETS
+    void HSLToRGB(const HSLPixel* pixels, CRGB* rgb, int count) {
+        for(int idx=0;idx<count;idx++) {
+            rgb[idx] = UnsetHSLToRGB(pixels[idx].hue,pixels[idx].saturation,pixels[idx].lightness);
+        }
+    }
+
 
     CHSL RGBToHSL_dbg(const CRGB&rgb)
     {
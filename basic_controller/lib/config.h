@@ -3,11 +3,11 @@
 
 #include <Adafruit_NeoPixel.h>
 
-#include "./parse_gen.h";
-#include "./logger.h";
-#include "./data.h";
-#include "./list.h";
-#include "./util.h";
+#include "./parse_gen.h"
+#include "./logger.h"
+#include "./data.h"
+#include "./list.h"
+#include "./util.h"
 
 namespace DevRelief {
     Logger ConfigLogger("Config",CONFIG_LOGGER_LEVEL);
@@ -206,7 +206,7 @@ public:
         JsonGenerator gen(buf);
         gen.generate(this);
         m_logger->debug("JSON:");
-        m_logger->debug(buf.text());
+        m_logger->debug("%s",buf.text());
     }
 protected:
 
@@ -216,6 +216,39 @@ private:
     JsonObject m_obj;
 };
 
+/* HttpResponseSink sends JsonGenerator's chunks as a chunked HTTP response
+ * so the JSON is never in memory at once.
+ */
+class HttpResponseSink : public IJsonSink {
+    public:
+        HttpResponseSink(Response* resp, int code, const char * contentType) {
+            m_resp = resp;
+            m_code = code;
+            m_contentType = contentType;
+        }
+
+        bool begin() override {
+            m_resp->setContentLength(CONTENT_LENGTH_UNKNOWN);
+            m_resp->send(m_code,m_contentType,"");
+            return true;
+        }
+
+        bool write(const char * text, size_t length) override {
+            m_resp->sendContent(text,length);
+            return true;
+        }
+
+        bool end() override {
+            // an empty chunk ends the response
+            m_resp->sendContent("");
+            return true;
+        }
+    private:
+        Response* m_resp;
+        int m_code;
+        const char * m_contentType;
+};
+
 class ApiResult : public Data {
     public:
         ApiResult(JsonElement *json) {
@@ -228,6 +261,7 @@ class ApiResult : public Data {
         }
 
         ApiResult(bool success=true) {
+            mimeType = "text/json";
             addProperty("code",success ? 200:500);
             addProperty("success",true);
             addProperty("message","success");
@@ -236,6 +270,7 @@ class ApiResult : public Data {
         ApiResult(bool success, const char * msg, ...) {
             va_list args;
             va_start(args,msg);
+            mimeType = "text/json";
             addProperty("success",success);
             addProperty("code",success ? 200:500);
             setMessage(msg,args);
@@ -296,8 +331,14 @@ class ApiResult : public Data {
                 mem->set("heapChange",(int)heap-m_lastHeapSize);
             }
             m_lastHeapSize = heap;
-            DRString result = toJsonString();
-            req->send(getInt("code",200),mimeType.text(),result.text());
+            write(req);
+        }
+
+        // the JSON is sent as it is generated
+        bool write(Response* resp) {
+            HttpResponseSink sink(resp,getInt("code",200),mimeType.text());
+            JsonGenerator gen(sink);
+            return gen.generate(this);
         }
     private:
         DRString mimeType;
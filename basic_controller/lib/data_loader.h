@@ -7,6 +7,7 @@
 #include "./data.h"
 #include "./file_system.h"
 #include "./config.h"
+#include "./script_cache.h"
 
 
 namespace DevRelief {
@@ -18,6 +19,19 @@ Logger DataLoaderLogger("DataLoader",DATA_LOADER_LOGGER_LEVEL);
 
 class DataLoader;
 
+// JSON written to a file a chunk at a time
+class JsonFileSink : public IJsonSink {
+    public:
+        JsonFileSink(File& file) : m_file(file) {
+        }
+
+        bool write(const char * text, size_t length) override {
+            return m_file.write((const uint8_t*)text,length) == length;
+        }
+    private:
+        File& m_file;
+};
+
 class LoadResult {
     public:
     LoadResult() {
@@ -57,6 +71,7 @@ class LoadResult {
 
 private:
     friend DataLoader;
+    // the JSON root's strings point into the buffer so it is deleted after the root
     DRFileBuffer m_buffer;    
     FileType m_type;
     JsonRoot* m_jsonRoot;
@@ -76,12 +91,27 @@ public:
 
     bool writeJsonFile(const char * path,JsonElement* json) {
         m_logger->debug("write JSON file %s",path);
-        DRString buffer;
-        m_logger->debug("\tgen JSON");
-        JsonGenerator gen(buffer);
-        gen.generate(json);
-        m_logger->debug("\twrite JSON: %s",buffer.text());
-        return m_fileSystem.write(path,buffer.text());
+        File file = m_fileSystem.openForWrite(path);
+        if (!file) {
+            m_logger->error("cannot write file %s",path);
+            return false;
+        }
+        JsonFileSink sink(file);
+        JsonGenerator gen(sink);
+        bool written = gen.generate(json);
+        file.close();
+        return written;
+    }
+
+    // read the file into the result's buffer without parsing it
+    bool readFile(const char * path,LoadResult & result) {
+        result.m_type = m_fileSystem.getFileType(path);
+        result.m_success = m_fileSystem.read(path,result.getBuffer());
+        result.m_error = result.m_success ? NULL : "file read() failed";
+        if (!result.m_success) {
+            m_logger->error("cannot read file %s",path);
+        }
+        return result.m_success;
     }
 
     bool loadFile(const char * path,LoadResult & result) {
@@ -98,7 +128,8 @@ public:
 
                 JsonParser parser;
                 m_logger->debug("\tparse file %s",result.getBuffer().text());
-                JsonRoot* root = parser.read(result.getBuffer().text());
+                // the root's strings are in the buffer, which the result keeps
+                JsonRoot* root = parser.readInPlace(result.getBuffer().writableText());
                 m_logger->debug("\tset root %s",(root == NULL ? "NULL" : "found"));
                 m_logger->debug("\ttop 0x%04X",(root == NULL ? 0 : root->getTopElement()));
                 m_logger->debug("\ttop obj 0x%04X",(root == NULL ? 0 : root->getTopElement()->asObject()));
@@ -135,8 +166,16 @@ class ConfigDataLoader : public DataLoader {
             LinkedList<DRString> files;
             m_logger->debug("adding scripts");
             if (m_fileSystem.listFiles("/script",files)){
+                // compiled scripts are kept with the JSON but are not scripts
+                LinkedList<DRString> scripts;
+                DRPath path;
+                files.each([&](DRString& name) {
+                    if (!path.endsWith(name.text(),SCRIPT_CACHE_EXTENSION)) {
+                        scripts.add(name);
+                    }
+                });
                 m_logger->debug("\tcall config.setScripts");
-                config.setScripts(files);
+                config.setScripts(scripts);
             }
             return true;
         }
@@ -9,237 +9,414 @@ namespace DevRelief {
 Logger StringLogger("DRString",DRSTRING_LOGGER_LEVEL);
 Logger* stringLogger = &StringLogger;
 
-class DRStringData {
-    public:
-        DRStringData(size_t length) : m_length(0), m_maxLength(0), m_data(NULL) {
-            stringLogger->debug("create DRStringData %d",m_data);
-            ensureLength(length);
-            m_length = length;
-        }
-
-        virtual ~DRStringData() {
-            delete m_data;
+/* the characters of a DRString too long for its inline buffer.  the count,
+ * capacity and characters are one allocation shared by copies of the
+ * string until one of them changes it.
+ */
+struct DRStringShared {
+    DRStringShared* next;   // chain in the intern table
+    uint32_t hash;
+    int refs;
+    size_t capacity;        // characters, not counting the terminator
+    bool interned;
+    char text[1];
+
+    static DRStringShared* create(size_t capacity) {
+        DRStringShared* shared = (DRStringShared*)malloc(sizeof(DRStringShared)+capacity);
+        if (shared == NULL) {
+            stringLogger->errorNoRepeat("out of memory for string of %d characters",capacity);
+            return NULL;
         }
+        shared->next = NULL;
+        shared->hash = 0;
+        shared->refs = 1;
+        shared->capacity = capacity;
+        shared->interned = false;
+        shared->text[0] = 0;
+        return shared;
+    }
+};
 
-        virtual void destroy() { delete this;}
-
-        const char * get() const {
-            ((DRStringData*)this)->ensureLength(1);
-            return m_data;
+/* DRStringTable holds the interned strings so names from scripts exist
+ * once.  an entry is removed when the last DRString using it goes away,
+ * and the buckets are freed when the table is empty.
+ */
+class DRStringTable {
+    public:
+        DRStringTable() {
+            m_buckets = NULL;
+            m_bucketCount = 0;
+            m_count = 0;
         }
 
-        size_t updateLength() {
-            if (m_data == NULL) {
-                m_length = 0;
-            } else {
-                m_length = strlen(m_data);
+        // FNV-1a
+        static uint32_t hash(const char * text, size_t length) {
+            uint32_t hash = 2166136261u;
+            for(size_t i=0;i<length;i++) {
+                hash = (hash ^ (uint8_t)text[i]) * 16777619u;
             }
-            return m_length;
+            return hash;
         }
-        char * ensureLength(size_t minLength){
-            stringLogger->debug("\tensureLength %d  (%d)",minLength,m_maxLength);
-            if (m_maxLength >= minLength) {
-                stringLogger->debug("\tensureLength %d",minLength);
-                return m_data;
-            }
-
-            size_t newLength = minLength+1;
-            stringLogger->info("\tnew string length %d",newLength);
 
-            char * newData = (char*) malloc(sizeof(char)*newLength);
-            stringLogger->debug("\tzero mem");
-
-            memset(newData,0,newLength);
-            if (m_data != NULL){
-                if (m_length > 0) {
-                    stringLogger->debug("\tcopy old data");
-                    memcpy(newData,m_data,m_length);
+        DRStringShared* find(const char * text, size_t length, uint32_t hash) {
+            if (m_buckets == NULL) {
+                return NULL;
+            }
+            DRStringShared* entry = m_buckets[hash & (m_bucketCount-1)];
+            while(entry != NULL) {
+                if (entry->hash == hash && strncmp(entry->text,text,length)==0 && entry->text[length] == 0) {
+                    return entry;
                 }
-                stringLogger->debug("\tfree old data");
-                free(m_data);
+                entry = entry->next;
             }
-            m_data = newData;
-            m_maxLength = newLength-1;
-            stringLogger->debug("\tdone");
-            return m_data;
+            return NULL;
         }
 
-        char * setLength(size_t newLength) {
-            ensureLength(newLength);
-            stringLogger->debug("ensureLength done %d",newLength);
-            m_length = newLength;
-            if (m_data != NULL) {
-                stringLogger->debug("add NULL terminate %d",m_data);
-                m_data[newLength] = 0;
+        bool add(DRStringShared* entry) {
+            if (m_count >= m_bucketCount && !grow()) {
+                return false;
             }
-            return m_data;
+            DRStringShared** bucket = m_buckets+(entry->hash & (m_bucketCount-1));
+            entry->next = *bucket;
+            *bucket = entry;
+            entry->interned = true;
+            m_count++;
+            return true;
         }
 
-        char * increaseLength(size_t additional) {
-            // return pointer to new data
-            stringLogger->debug("increase length %d + %d",m_length,additional);
-            size_t actualLength = (m_data == NULL) ? 0 : strlen(m_data);
-            size_t origLength = m_length;
-            if (actualLength+additional <= m_maxLength) {
-                // have enough space;
-                m_length=actualLength + additional;
-                stringLogger->debug("\tno increase %d %d %d %c",origLength, actualLength,additional,m_data[origLength]);
-                stringLogger->debug("\t\tcurrent: ~%s~",m_data);
-                return m_data+actualLength;
-
+        void remove(DRStringShared* entry) {
+            if (m_buckets == NULL) {
+                return;
             }
-            size_t addLength = additional;
-            if (addLength < 32) {
-                addLength = 32;
-            } 
-            if (addLength < m_length/2) {
-                addLength = m_length/2;
+            DRStringShared** link = m_buckets+(entry->hash & (m_bucketCount-1));
+            while(*link != NULL && *link != entry) {
+                link = &(*link)->next;
+            }
+            if (*link == entry) {
+                *link = entry->next;
+                m_count--;
+            }
+            if (m_count == 0) {
+                free(m_buckets);
+                m_buckets = NULL;
+                m_bucketCount = 0;
             }
-            
-            ensureLength(m_length+addLength);
-            m_length = actualLength+additional;
-            stringLogger->debug("\tadded %d %d %d %c",origLength, actualLength,additional,m_data[origLength]);
-            stringLogger->debug("\t\tcurrent: ~%s~",m_data);
-            return m_data+actualLength;
-
         }
 
-        char * data() { 
-            stringLogger->debug("\tget DRStringBuffer data %d %d %s",m_length,m_maxLength,(m_data ? m_data : "<no data>"));
-            return m_data;
-        }
-        const char * data() const { return m_data;}
-        size_t getLength() const { return m_length;}
-        size_t getMaxLength() const { return m_maxLength;}
+        int getCount() { return m_count;}
     private:
-        size_t m_length;
-        size_t m_maxLength;
-        char * m_data;
+        bool grow() {
+            int bucketCount = m_bucketCount == 0 ? 8 : m_bucketCount*2;
+            DRStringShared** buckets = (DRStringShared**)malloc(bucketCount*sizeof(DRStringShared*));
+            if (buckets == NULL) {
+                stringLogger->errorNoRepeat("out of memory for intern table");
+                return false;
+            }
+            memset(buckets,0,bucketCount*sizeof(DRStringShared*));
+            for(int i=0;i<m_bucketCount;i++) {
+                DRStringShared* entry = m_buckets[i];
+                while(entry != NULL) {
+                    DRStringShared* next = entry->next;
+                    DRStringShared** bucket = buckets+(entry->hash & (bucketCount-1));
+                    entry->next = *bucket;
+                    *bucket = entry;
+                    entry = next;
+                }
+            }
+            free(m_buckets);
+            m_buckets = buckets;
+            m_bucketCount = bucketCount;
+            return true;
+        }
+
+        DRStringShared** m_buckets;
+        int m_bucketCount;      // a power of 2
+        int m_count;
 };
 
+DRStringTable InternedStrings;
+
+/* DRString keeps up to DRSTRING_INLINE_SIZE-1 characters in the object
+ * itself.  longer text is in a DRStringShared that copies share; a change
+ * to a shared string copies the characters first.
+ */
 class DRString {
-    public: 
+    public:
         static DRString fromFloat(double val);
+        // the same text always gives a DRString with the same text() pointer
+        static DRString intern(const char * text);
+
         DRString(const char * = NULL);
         DRString(const char *, size_t len);
         DRString(char c, size_t repeatCount);
         DRString(const DRString& other);
+        DRString(DRString&& other);
         ~DRString();
 
-        const char* operator->() const { 
-            stringLogger->debug("operator->");
-            return m_data.get()->data();
-        }
-
-        operator const char*() const { 
-            stringLogger->debug("cast(const char *)operator");
-            return m_data.get()->data();
-        }
+        DRString& operator=(const DRString& other);
+        DRString& operator=(DRString&& other);
+        DRString& operator=(const char * text);
 
-        const char * get() const { 
-            stringLogger->never("get()");
-            if (m_data.get() == NULL){
-                stringLogger->never("string is NULL");
-                return "";
-            }
-            stringLogger->never("have  m_data 0x%04X",m_data.get());
-            return m_data.get()->get();
-        }
+        const char* operator->() const { return text();}
+        operator const char*() const { return text();}
+        const char * get() const { return text();}
+        const char * text() const { return m_shared ? m_shared->text : m_inline;}
 
         DRString& append(const char * other);
         const char * operator+=(const char * other){return append(other);}
         const char * operator+=(const DRString& other) {return append(other.text());}
 
-        void clear() {
-            stringLogger->debug("clear buffer");
-            if (m_data.get() == NULL) {
-                stringLogger->debug("no m_data");
-            }
-            stringLogger->debug("setLength(0)");
-            m_data.get()->setLength(0);
-            stringLogger->debug("\tdone setLength(0)");
-        }
-        char * increaseLength(size_t charsNeeded) { 
-            return m_data.get()->increaseLength(charsNeeded);
-        }
+        void clear();
+        // make room for charsNeeded more characters and return where they go
+        char * increaseLength(size_t charsNeeded);
+
+        size_t getLength() const { return m_length;}
 
-        const char * text() const { return get();}
-        size_t getLength() { return m_data.get()->getLength();}
+        // interned strings are equal only if they share text
+        bool equals(const DRString& other) const;
+        bool equals(const char * other) const { return strcmp(text(),other ? other : "")==0;}
+        bool isInterned() const { return m_shared != NULL && m_shared->interned;}
 
         // trime whitespace + optional chars
         DRString& trimStart(const char * chars=NULL);
         DRString& trimEnd(const char * chars=NULL);
     protected:
-        SharedPtr<DRStringData> m_data;
+        // writable text with room for length characters.  NULL if out of memory
+        char * reserve(size_t length);
+        void set(const char * text, size_t length);
+        void release();
 
+        size_t m_length;
+        DRStringShared* m_shared;
+        char m_inline[DRSTRING_INLINE_SIZE];
 };
 
 DRString DRString::fromFloat(double val){
-    DRString result;
-    char * buf = result.m_data->ensureLength(32);
-    sprintf(buf,"%f",val);
-    result.m_data->updateLength();
-    return result;
+    char buf[32];
+    snprintf(buf,sizeof(buf),"%f",val);
+    return DRString(buf);
 }
 
-DRString::DRString(const DRString& other) : m_data(other.m_data){
-    stringLogger->debug("Create DRString from other");
-    
+DRString DRString::intern(const char * text) {
+    if (text == NULL) {
+        text = "";
+    }
+    size_t length = strlen(text);
+    uint32_t hash = DRStringTable::hash(text,length);
+    DRString result;
+    DRStringShared* shared = InternedStrings.find(text,length,hash);
+    if (shared != NULL) {
+        shared->refs++;
+    } else {
+        shared = DRStringShared::create(length);
+        if (shared == NULL) {
+            return DRString(text,length);
+        }
+        memcpy(shared->text,text,length+1);
+        shared->hash = hash;
+        // not interned if the table cannot grow, but still a valid string
+        InternedStrings.add(shared);
+    }
+    result.m_shared = shared;
+    result.m_length = length;
+    return result;
 }
 
 DRString::DRString(const char * orig) {
-    stringLogger->debug("Create DRString from const char *");
-    size_t len = orig == NULL ? 0 : strlen(orig);
-    m_data = new DRStringData(len);
-    if (orig != NULL) { 
-        stringLogger->debug("copy orig %.15s",orig);
-        strncpy(m_data.get()->data(),orig,len);
-        stringLogger->debug("copy done");
+    m_length = 0;
+    m_shared = NULL;
+    m_inline[0] = 0;
+    if (orig != NULL) {
+        set(orig,strlen(orig));
     }
-
 }
 
 DRString::DRString(const char * orig, size_t length) {
-    stringLogger->debug("Create DRString from const char * and length");
-    size_t len = orig == NULL ? 0 : length;
-    m_data = new DRStringData(len);
-    if (orig != NULL) { 
-        strncpy(m_data.get()->data(),orig,len);
+    m_length = 0;
+    m_shared = NULL;
+    m_inline[0] = 0;
+    if (orig != NULL) {
+        set(orig,strnlen(orig,length));
     }
 }
 
-
 DRString::DRString(char c, size_t repeatCount) {
-    stringLogger->debug("Create DRString from char  and repeatCount");
-    stringLogger->debug("\tchar: %c  count: %d",c,repeatCount);
-    size_t len = repeatCount;
-    m_data = new DRStringData(len);
-    char * data = m_data.get()->data();
-    for(int i=0;i<len;i++) {
-        data[i] = c;
+    m_length = 0;
+    m_shared = NULL;
+    m_inline[0] = 0;
+    char * data = reserve(repeatCount);
+    if (data != NULL) {
+        memset(data,c,repeatCount);
+        data[repeatCount] = 0;
+        m_length = repeatCount;
     }
-    
+}
+
+DRString::DRString(const DRString& other) {
+    m_length = other.m_length;
+    m_shared = other.m_shared;
+    if (m_shared != NULL) {
+        m_shared->refs++;
+    } else {
+        memcpy(m_inline,other.m_inline,m_length+1);
+    }
+}
+
+DRString::DRString(DRString&& other) {
+    m_length = other.m_length;
+    m_shared = other.m_shared;
+    if (m_shared == NULL) {
+        memcpy(m_inline,other.m_inline,m_length+1);
+    }
+    other.m_shared = NULL;
+    other.m_length = 0;
+    other.m_inline[0] = 0;
 }
 
 DRString::~DRString() {
-    stringLogger->debug("~DRString()");
-    if (m_data.get() == NULL) {
-        stringLogger->error("\tmissing m_data");
+    release();
+}
+
+DRString& DRString::operator=(const DRString& other) {
+    if (this != &other) {
+        if (other.m_shared != NULL) {
+            other.m_shared->refs++;
+        }
+        release();
+        m_length = other.m_length;
+        m_shared = other.m_shared;
+        if (m_shared == NULL) {
+            memcpy(m_inline,other.m_inline,m_length+1);
+        }
+    }
+    return *this;
+}
+
+DRString& DRString::operator=(DRString&& other) {
+    if (this != &other) {
+        release();
+        m_length = other.m_length;
+        m_shared = other.m_shared;
+        if (m_shared == NULL) {
+            memcpy(m_inline,other.m_inline,m_length+1);
+        }
+        other.m_shared = NULL;
+        other.m_length = 0;
+        other.m_inline[0] = 0;
+    }
+    return *this;
+}
+
+DRString& DRString::operator=(const char * text) {
+    // text may be in this string's buffer
+    return *this = DRString(text);
+}
+
+void DRString::release() {
+    DRStringShared* shared = m_shared;
+    m_shared = NULL;
+    m_length = 0;
+    m_inline[0] = 0;
+    if (shared != NULL && --shared->refs == 0) {
+        if (shared->interned) {
+            InternedStrings.remove(shared);
+        }
+        free(shared);
+    }
+}
+
+char * DRString::reserve(size_t length) {
+    if (m_shared == NULL) {
+        if (length < DRSTRING_INLINE_SIZE) {
+            return m_inline;
+        }
+    } else if (m_shared->refs == 1 && !m_shared->interned && m_shared->capacity >= length) {
+        return m_shared->text;
+    }
+    // increaseLength() writers may leave m_length above the length asked for
+    // and all m_length bytes are copied below
+    size_t capacity = length < m_length ? m_length : length;
+    if (m_shared == NULL || m_shared->capacity < length) {
+        // growing.  leave room to append more
+        size_t current = m_shared == NULL ? DRSTRING_INLINE_SIZE : m_shared->capacity;
+        if (capacity < current+current/2) {
+            capacity = current+current/2;
+        }
+    }
+    DRStringShared* shared = DRStringShared::create(capacity);
+    if (shared == NULL) {
+        return NULL;
+    }
+    memcpy(shared->text,text(),m_length+1);
+    size_t currentLength = m_length;
+    release();
+    m_shared = shared;
+    m_length = currentLength;
+    return shared->text;
+}
+
+void DRString::set(const char * orig, size_t length) {
+    char * data = reserve(length);
+    if (data == NULL) {
+        return;
+    }
+    memcpy(data,orig,length);
+    data[length] = 0;
+    m_length = length;
+}
+
+void DRString::clear() {
+    if (m_shared != NULL && (m_shared->refs > 1 || m_shared->interned)) {
+        release();
+        return;
+    }
+    if (m_shared != NULL) {
+        m_shared->text[0] = 0;
     } else {
-        stringLogger->debug("\tlength=%d",m_data.get()->getLength());
-        stringLogger->debug("\ttext=%s",m_data.get()->ensureLength(1));
+        m_inline[0] = 0;
+    }
+    m_length = 0;
+}
+
+char * DRString::increaseLength(size_t additional) {
+    // writers may have used less than they asked for so start at the terminator
+    size_t actualLength = strlen(text());
+    char * data = reserve(actualLength+additional);
+    if (data == NULL) {
+        return NULL;
     }
+    memset(data+actualLength,0,additional+1);
+    m_length = actualLength+additional;
+    return data+actualLength;
+}
+
+bool DRString::equals(const DRString& other) const {
+    if (text() == other.text()) {
+        return true;
+    }
+    if (isInterned() && other.isInterned()) {
+        return false;
+    }
+    return m_length == other.m_length && strcmp(text(),other.text())==0;
 }
 
 DRString& DRString::append(const char * other){
-    if (other == NULL) { return *this;}
-    
+    if (other == NULL || other[0] == 0) { return *this;}
+    const char * current = text();
+    if (other >= current && other <= current+m_length) {
+        // appending part of this string
+        DRString copy(other);
+        return append(copy.text());
+    }
+    // increaseLength() callers may have written less than m_length
+    size_t length = strlen(current);
     size_t olen = strlen(other);
-    if (olen == 0) {
+    char * data = reserve(length+olen);
+    if (data == NULL) {
         return *this;
     }
-    char * extra = m_data.get()->increaseLength(olen);
-    memcpy(extra,other,olen);
+    memcpy(data+length,other,olen+1);
+    m_length = length+olen;
     return *this;
 }
 
@@ -250,18 +427,27 @@ class DRFormattedString : public DRString{
             va_list args;
             va_start (args,format);
             formatString(format,args);
+            va_end(args);
         }
 
     private:
         void formatString(const char * format, va_list args) {
-            char buf[2];
-            int len = vsnprintf(buf,1,format,args)+1;
-            m_data.get()->ensureLength(len+1);
-            vsnprintf(m_data.get()->data(),len,format,args);
+            va_list measure;
+            va_copy(measure,args);
+            int len = vsnprintf(NULL,0,format,measure);
+            va_end(measure);
+            if (len <= 0) {
+                return;
+            }
+            char * data = reserve(len);
+            if (data != NULL) {
+                vsnprintf(data,len+1,format,args);
+                m_length = len;
+            }
         }
 };
 
 
 
 }
-#endif
\ No newline at end of file
+#endif
@@ -12,7 +12,7 @@
 
 namespace DevRelief {
 
-typedef enum FileType {
+enum FileType {
     FILE_TEXT = 1,
     FILE_JSON = 2,
 
@@ -206,6 +206,30 @@ public:
         return true;
     }
 
+    // the whole file into the buffer when its length is not known
+    bool readBinary(const char * path, DRBuffer& buffer) {
+        m_logger->debug("read binary from %s",path);
+        auto fullPath = getFullPath(path);
+        File file = open(fullPath);
+        if (!file.isFile()) {
+            m_logger->warn("rb file not found %s",fullPath);
+            return false;
+        }
+        size_t size = file.size();
+        auto data = buffer.reserve(size);
+        size_t readBytes = file.read(data,size);
+        file.close();
+        buffer.setLength(readBytes);
+        m_logger->debug("read %d bytes.",readBytes);
+        return readBytes == size;
+    }
+
+    // the file is replaced.  the caller closes it
+    File openForWrite(const char * path) {
+        auto fullPath = getFullPath(path);
+        return LittleFS.open(fullPath,"w");
+    }
+
     bool write(const char *  path, const char * data) {
         auto fullPath = getFullPath(path);
         File file = LittleFS.open(fullPath,"w");
@@ -229,9 +253,9 @@ public:
     bool writeBinary(const char * path, const byte * data,size_t length) {
         auto fullPath = getFullPath(path);
         File file = LittleFS.open(fullPath,"w");
-        file.write(data,length);
+        size_t written = file.write(data,length);
         file.close();
-        return true;
+        return written == length;
     }
 
 private:
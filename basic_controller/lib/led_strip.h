@@ -23,7 +23,7 @@ namespace DevRelief {
 Logger ledLogger("LED",LED_LOGGER_LEVEL);
 
 
-typedef enum HSLOperation {  
+enum HSLOperation {  
     REPLACE=0,
     ADD=1,
     SUBTRACT=2,
@@ -88,6 +88,13 @@ class DRLedStrip {
             return setColor(index,HSLToRGB(color));
         }
 
+        // copy length pixels starting at index start.  strips override this to avoid a virtual setColor() per pixel
+        virtual void writePixels(uint16_t start, const CRGB* src, uint16_t length) {
+            for(uint16_t idx=0;idx<length;idx++) {
+                setColor(start+idx,src[idx]);
+            }
+        }
+
         long validCheck;
         // use getCompoundLedStrip to find a base virtual strip made of multiple other strips
         virtual CompoundLedStrip* getCompoundLedStrip()=0; 
@@ -114,7 +121,7 @@ class AdafruitLedStrip : public DRLedStrip {
         }
 
         virtual void clear() {
-            m_logger->debug("clear AdafruitLedStrip");
+            DRLOG_DEBUG(ADAFRUIT_LED_LOGGER_LEVEL,m_logger,"clear AdafruitLedStrip");
             if (m_controller == NULL) {
                 m_logger->error("NULL controller");
                 return;
@@ -127,14 +134,25 @@ class AdafruitLedStrip : public DRLedStrip {
 
         virtual void setColor(uint16_t index, const CRGB& color){
             if (index == 0) {
-                m_logger->debug("setColor  %02X,%02X,%02X",color.red,color.green,color.blue);
+                DRLOG_DEBUG(ADAFRUIT_LED_LOGGER_LEVEL,m_logger,"setColor  %02X,%02X,%02X",color.red,color.green,color.blue);
             }
             m_controller->setPixelColor(index,m_controller->Color(color.red,color.green,color.blue));
         }
 
+        virtual void writePixels(uint16_t start, const CRGB* src, uint16_t length) {
+            uint16_t end = start+length;
+            if (end > m_controller->numPixels()) {
+                m_logger->errorNoRepeat("writePixels %d-%d is past the end of the strip",start,end);
+                end = m_controller->numPixels();
+            }
+            for(uint16_t idx=start;idx<end;idx++,src++) {
+                m_controller->setPixelColor(idx,m_controller->Color(src->red,src->green,src->blue));
+            }
+        }
+
         virtual int getCount() { return m_controller->numPixels();}
         virtual void show() {
-            m_logger->debug("show strip %d, %d",m_controller->getPin(),m_controller->numPixels());
+            DRLOG_DEBUG(ADAFRUIT_LED_LOGGER_LEVEL,m_logger,"show strip %d, %d",m_controller->getPin(),m_controller->numPixels());
             //m_controller->setBrightness(40);
             //m_controller->setPixelColor(10,m_controller->Color(200,100,50));
             m_controller->show();
@@ -162,106 +180,154 @@ class PhyisicalLedStrip : public AdafruitLedStrip {
         uint8_t m_maxBrightness;
 };
 
+struct CompoundSegment {
+    DRLedStrip* strip;
+    uint16_t    start;  // index of the strip's first pixel in the compound strip
+    uint16_t    count;
+};
+
+/* CompoundLedStrip joins any number of strips end to end.  The segment table
+ * caches each strip's first index and count when a strip is added, so
+ * component strips must not change length after they are added (call
+ * updateSegments() if one does).
+ */
 class CompoundLedStrip : public DRLedStrip {
     public:
         CompoundLedStrip() {
-            strips[0] = NULL;
-            strips[1] = NULL;
-            strips[2] = NULL;
-            strips[3] = NULL;
-            count = 0;
+            m_segments = NULL;
+            m_segmentCount = 0;
+            m_capacity = 0;
+            m_ledCount = 0;
+            m_lastSegment = 0;
             m_logger = new Logger("CompoundStrip",COMPOUND_STRIP_LOGGER_LEVEL);
             m_logger->info("create CompoundLedStrip");
         }
 
         ~CompoundLedStrip() {
             m_logger->debug("delete CompoundLedStrip");
-            for(int i=0;i<count;i++) {
+            for(int i=0;i<m_segmentCount;i++) {
                 m_logger->debug("\tdelete component LedStrip %d",i);
-                delete strips[i];
+                delete m_segments[i].strip;
             }
+            if (m_segments) { free(m_segments);}
+            delete m_logger;
         }
+
         void add(DRLedStrip * strip) {
-            if (count < 4) {
-                strips[count++] = strip;
-            } else {
-                m_logger->error("too many strips added to CompoundLedStrip");
+            if (strip == NULL) {
+                m_logger->error("cannot add NULL strip to CompoundLedStrip");
+                return;
+            }
+            if (m_segmentCount == m_capacity) {
+                int capacity = m_capacity == 0 ? 4 : m_capacity*2;
+                CompoundSegment* segments = (CompoundSegment*)realloc(m_segments,capacity*sizeof(CompoundSegment));
+                if (segments == NULL) {
+                    m_logger->error("out of memory adding strip to CompoundLedStrip");
+                    return;
+                }
+                m_segments = segments;
+                m_capacity = capacity;
+            }
+            m_segments[m_segmentCount++].strip = strip;
+            updateSegments();
+        }
+
+        // rebuild the cached offsets.  add() calls this
+        void updateSegments() {
+            uint16_t start = 0;
+            for(int i=0;i<m_segmentCount;i++) {
+                CompoundSegment& segment = m_segments[i];
+                segment.start = start;
+                segment.count = segment.strip->getCount();
+                start += segment.count;
             }
+            m_ledCount = start;
+            m_lastSegment = 0;
         }
 
-        
+        int getSegmentCount() { return m_segmentCount;}
+
         void clear() {
-            m_logger->debug("clear() %d components",count);
-            for(int i=0;i<count;i++) {
-                if (strips[i] == NULL) {
-                    m_logger->error("NULL component script %d",i);
-                } else {
-                    //m_logger->debug("clear strip %d",i);
-                    strips[i]->clear();
-                }
+            DRLOG_DEBUG(COMPOUND_STRIP_LOGGER_LEVEL,m_logger,"clear() %d components",m_segmentCount);
+            for(int i=0;i<m_segmentCount;i++) {
+                m_segments[i].strip->clear();
             }
         };
         virtual void setBrightness(uint16_t brightness) {
-            for(int i=0;i<count;i++) {
-                strips[i]->setBrightness(brightness);
+            for(int i=0;i<m_segmentCount;i++) {
+                m_segments[i].strip->setBrightness(brightness);
             }
         };
 
         virtual void setColor(uint16_t index,const CRGB& color)  {
-            int strip = 0;
-            uint16_t oindex = index;
-            while(strip < count && strip < 4 && strips[strip] != NULL && index >= strips[strip]->getCount()) {
-                index -= strips[strip]->getCount();
-                strip++;
-            }
-            if (strip >= count || strip >= 4) {
-                m_logger->error("strip too big %d %d",strip,oindex);
+            CompoundSegment* segment = findSegment(index);
+            if (segment == NULL) {
+                m_logger->errorNoRepeat("index %d is past the end of the strips (%d)",index,m_ledCount);
                 return;
             }
+            segment->strip->setColor(index-segment->start,color);
+        };
 
-            if (strips[strip] == NULL) {
-                m_logger->error("missing strip %d %d",oindex,strip);
-                return;
+        // split the pixels into one run per component strip
+        virtual void writePixels(uint16_t start, const CRGB* src, uint16_t length) {
+            uint16_t end = start+length;
+            if (end > m_ledCount) {
+                m_logger->errorNoRepeat("writePixels %d-%d is past the end of the strips",start,end);
+                end = m_ledCount;
             }
-            if (strips[strip]->validCheck != 0x123fe) {
-                m_logger->error(" strip not valid  %d %d",oindex,strip);
-                return;
+            CompoundSegment* segment = findSegment(start);
+            while(start < end) {
+                uint16_t last = segment->start+segment->count;
+                uint16_t to = end < last ? end : last;
+                segment->strip->writePixels(start-segment->start,src,to-start);
+                src += to-start;
+                start = to;
+                segment++;
             }
-            // if (index == 0) {
-            //     m_logger->error("set color %d %d %d %d: %d,%d,%d",index,count,strips[strip]->getCount(),strip,color.red,color.green,color.blue);
-            // }
-            if (index<strips[strip]->getCount()){
-                strips[strip]->setColor(index,color);
-            } else {
-                m_logger->error("bad index %d %d %d",index,strip,(strips[strip] == NULL ? -1 : strips[strip]->getCount()));
-            }
-        };
+        }
+
         virtual int getCount() {
-            size_t ledcount = 0;
-            for(int i=0;i<count;i++) {
-                if (strips[i] == NULL) {
-                    m_logger->error("strip %d is NULL",i);
-                } else {
-                   // m_logger->debug("get count strip %d",i);
-                    ledcount += strips[i]->getCount();
-                }
-            }
-            m_logger->never("getcount()=%d",ledcount);
-            return ledcount;
+            return m_ledCount;
         }
 
         virtual void show() {
-            m_logger->debug("show() %d",count);
-            for(int i=0;i<count;i++) {
-                strips[i]->show();
+            DRLOG_DEBUG(COMPOUND_STRIP_LOGGER_LEVEL,m_logger,"show() %d",m_segmentCount);
+            for(int i=0;i<m_segmentCount;i++) {
+                m_segments[i].strip->show();
             }
         }
 
         virtual CompoundLedStrip* getCompoundLedStrip() { return this;}
 
     private:
-        DRLedStrip* strips[4]; // max of 4 strips;
-        size_t      count;
+        // binary search.  the segment found last time is checked first since scripts set LEDs in order
+        CompoundSegment* findSegment(uint16_t index) {
+            if (index >= m_ledCount) {
+                return NULL;
+            }
+            CompoundSegment* segment = m_segments+m_lastSegment;
+            if (index >= segment->start && index < segment->start+segment->count) {
+                return segment;
+            }
+            int low = 0;
+            int high = m_segmentCount-1;
+            while(low < high) {
+                int mid = (low+high+1)/2;
+                if (m_segments[mid].start <= index) {
+                    low = mid;
+                } else {
+                    high = mid-1;
+                }
+            }
+            m_lastSegment = low;
+            return m_segments+low;
+        }
+
+        CompoundSegment* m_segments;
+        int              m_segmentCount;
+        int              m_capacity;
+        uint16_t         m_ledCount;
+        int              m_lastSegment;
 };
 
 class AlteredStrip : public DRLedStrip {
@@ -298,6 +364,8 @@ class AlteredStrip : public DRLedStrip {
         DRLedStrip * m_base;
 };
 
+#define REVERSE_STRIP_BLOCK_SIZE 32
+
 class ReverseStrip: public AlteredStrip {
     public:
         ReverseStrip(DRLedStrip* base): AlteredStrip(base) {
@@ -308,6 +376,26 @@ class ReverseStrip: public AlteredStrip {
             m_logger->debug("delete ReverseStrip");
         }
 
+        // reverse blocks of pixels on the stack and write each block to the base as one run
+        virtual void writePixels(uint16_t start, const CRGB* src, uint16_t length) {
+            CRGB block[REVERSE_STRIP_BLOCK_SIZE];
+            int baseCount = m_base->getCount();
+            if (start+length > baseCount) {
+                m_logger->errorNoRepeat("writePixels %d-%d is past the end of the strip",start,start+length);
+                length = start < baseCount ? baseCount-start : 0;
+            }
+            uint16_t done = 0;
+            while(done < length) {
+                uint16_t size = length-done < REVERSE_STRIP_BLOCK_SIZE ? length-done : REVERSE_STRIP_BLOCK_SIZE;
+                const CRGB* from = src+done+size;
+                for(uint16_t idx=0;idx<size;idx++) {
+                    block[idx] = *(--from);
+                }
+                m_base->writePixels(baseCount-start-done-size,block,size);
+                done += size;
+            }
+        }
+
     protected:
         uint16_t translateIndex(uint16_t index) { 
             return getCount()-index-1;
@@ -331,44 +419,66 @@ class RotatedStrip: public AlteredStrip {
 
 
 
+enum HSLStripLayout {
+    HSL_LAYOUT_INTERLEAVED=0,   // HSLPixel per LED
+    HSL_LAYOUT_SOA=1            // separate hue, saturation and lightness arrays
+};
+
+/* HSLStrip keeps the frame in one allocation: the HSL values in the selected
+ * layout, a bitmap of pixels set since clear() and the RGB buffer show()
+ * converts into.  clear() only zeroes the bitmap.  A pixel's values are reset
+ * to unset (-1) the first time it is set in a frame.
+ */
+#define HSL_UNSET_KEY 0xFFFFFFFF
+
 class HSLStrip: public AlteredStrip, public IHSLStrip{
     public:
-        HSLStrip(DRLedStrip* base): AlteredStrip(base) { 
+        HSLStrip(DRLedStrip* base, HSLStripLayout layout=HSL_STRIP_LAYOUT): AlteredStrip(base) { 
+            m_layout = layout;
             m_count = 0;
+            m_capacity = 0;
+            m_data = NULL;
+            m_pixels = NULL;
             m_hue = NULL;
             m_saturation = NULL;
             m_lightness = NULL;
+            m_hueStride = 1;
+            m_stride = 1;
+            m_valid = NULL;
+            m_previous = NULL;
+            m_rgb = NULL;
+            m_changed = true;
+            m_shownFrames = 0;
+            m_unchangedFrames = 0;
+            m_convertedPixels = 0;
             m_logger = new Logger("HSLStrip",HSL_STRIP_LOGGER_LEVEL);
             m_logger->debug("created HSLStrip with base 0x%04X",base);
         }
 
         ~HSLStrip() {
             reallocHSLData(0);
+            delete m_logger;
         }
 
         virtual int getStart() override { return 0;}
 
         void setRGB(int index, const CRGB& rgb,HSLOperation op) {
             CHSL hsl = RGBToHSL(rgb);
-            m_logger->periodicNever(NEVER,5000,"setRGB %d (%d,%d,%d)->(%d,%d,%d)",index,rgb.red,rgb.green,rgb.blue,hsl.hue,hsl.saturation,hsl.lightness);
+            DRLOG_NEVER("setRGB %d (%d,%d,%d)->(%d,%d,%d)",index,rgb.red,rgb.green,rgb.blue,hsl.hue,hsl.saturation,hsl.lightness);
             setHue(index,hsl.hue,op);
             setSaturation(index,hsl.saturation,op);
             setLightness(index,hsl.lightness,op);
         }
 
         void setHue(int index, int16_t hue, HSLOperation op=REPLACE) {
-            m_logger->never("HSL Hue %d %d",index,hue);
+            DRLOG_NEVER("HSL Hue %d %d",index,hue);
             if (index<0 || index>=m_count) {
                 m_logger->periodic(ERROR_LEVEL,5000,"HSL Hue index out of range %d (0-%d)",index,m_count);
                 return;
             } 
-            if (index == 0) {
-                m_logger->never("hue %d %d",index,hue);
-            }
-            m_hue[index] = clamp(0,359,performOperation(op,m_hue[index],hue));
-            if (index == 0) {
-                //m_logger->periodic(ERROR_LEVEL,5000,"setHue %d %d %d",index,hue,op);
-            }
+            validate(index);
+            int16_t& value = hueAt(index);
+            value = clamp(0,359,performOperation(op,value,hue));
         }
  
         void setSaturation(int index, int16_t saturation, HSLOperation op=REPLACE) {
@@ -377,22 +487,23 @@ class HSLStrip: public AlteredStrip, public IHSLStrip{
                 return;
             } 
             if (saturation<0 || saturation>100) { return;}
-            m_saturation[index] = clamp(0,100,performOperation(op,m_saturation[index],saturation));
+            validate(index);
+            int8_t& value = saturationAt(index);
+            value = clamp(0,100,performOperation(op,value,saturation));
         }
 
         void setLightness(int index, int16_t lightness, HSLOperation op=REPLACE) {
-            if (index<=5) {
-                m_logger->never("HSL Lightness op %d %d %d",op,index,lightness);
-            }
             if (index<0 || index>=m_count) {
                 m_logger->periodic(ERROR_LEVEL,5000,"HSL lightness index out of range %d (0-%d)",index,m_count);
                 return;
             } 
             
             if (lightness<0 || lightness>100) { return;}
-            int16_t l = performOperation(op,m_lightness[index],lightness);
-            m_logger->never("op %d %d  %d->%d",op,m_lightness[index],lightness,l);
-            m_lightness[index] = clamp(0,100,l);
+            validate(index);
+            int8_t& value = lightnessAt(index);
+            int16_t l = performOperation(op,value,lightness);
+            DRLOG_NEVER("op %d %d  %d->%d",op,value,lightness,l);
+            value = clamp(0,100,l);
         }
 
         void clear() {
@@ -400,66 +511,168 @@ class HSLStrip: public AlteredStrip, public IHSLStrip{
                 m_logger->warn("HSLStrip does not have a base");
                 return;
             }
-            m_logger->debug("Clear HSLStrip");
+            DRLOG_DEBUG(HSL_STRIP_LOGGER_LEVEL,m_logger,"Clear HSLStrip");
             int count = m_base->getCount();
-            m_logger->debug("HSLStrip realloc for %d leds",count);
-            reallocHSLData(count);
-            m_logger->debug("clear HSL values");
-            for(int i=0;i<count;i++) {
-                m_hue[i] = -1;
-            }
-            //memset(m_hue,-1,sizeof(int16_t)*count);
-            memset(m_saturation,-1,sizeof(int8_t)*count);
-            memset(m_lightness,-1,sizeof(int8_t)*count);
-            m_base->clear();
+            if (count > m_capacity) {
+                m_logger->debug("HSLStrip realloc for %d leds",count);
+                reallocHSLData(count);
+            }
+            m_count = m_data ? count : 0;
+            if (m_count == 0) {
+                m_base->clear();
+                return;
+            }
+            // show() writes every pixel so the base is not cleared
+            memset(m_valid,0,validWords(m_count)*sizeof(uint32_t));
+        }
+
+        void setBrightness(uint16_t brightness) override {
+            AlteredStrip::setBrightness(brightness);
+            m_changed = true;
         }
 
+        /* only pixels that differ from the last frame are converted.  runs of
+         * changed pixels go through the batch converter.  if nothing changed
+         * (and the brightness did not) the base strip is not written or shown
+         */
         void show() {
-            m_logger->debug("show() %d",m_count);
+            DRLOG_DEBUG(HSL_STRIP_LOGGER_LEVEL,m_logger,"show() %d",m_count);
+            if (m_count == 0) {
+                m_base->show();
+                return;
+            }
+            bool changed = m_changed;
+            int runStart = -1;
             for(int idx=0;idx<m_count;idx++) {
-                int hue = m_hue[idx];
-                int sat = m_saturation[idx];
-                int light = m_lightness[idx];
-                if (hue < 0) {
-                    light = 0;
+                uint32_t key = isValid(idx) ? pixelKey(idx) : HSL_UNSET_KEY;
+                if (key == m_previous[idx]) {
+                    if (runStart >= 0) {
+                        convertRun(runStart,idx);
+                        runStart = -1;
+                    }
+                    continue;
                 }
-                if (false && idx < 20) {
-                    m_logger->never("light: %d",light);
+                m_previous[idx] = key;
+                changed = true;
+                if (key == HSL_UNSET_KEY) {
+                    // pixels not set since clear() are black.  their stored values are stale
+                    if (runStart >= 0) {
+                        convertRun(runStart,idx);
+                        runStart = -1;
+                    }
+                    m_rgb[idx] = CRGB(0,0,0);
+                } else if (runStart < 0) {
+                    runStart = idx;
                 }
-                CHSL hsl(clamp(0,360,hue),defaultValue(0,100,sat,100),defaultValue(0,100,light,50));
-                if (idx == 0) {
-                    const CRGB rgb = HSLToRGB(hsl);
-                    m_logger->debug("hsl(%d,%d,%d)->RGB(%d,%d,%d)",hsl.hue,hsl.saturation,hsl.lightness,rgb.red,rgb.green,rgb.blue);
-                }
-                m_base->setColor(idx,hsl);
             }
+            if (runStart >= 0) {
+                convertRun(runStart,m_count);
+            }
+            if (!changed) {
+                m_unchangedFrames++;
+                return;
+            }
+            const CRGB& rgb = m_rgb[0];
+            DRLOG_DEBUG(HSL_STRIP_LOGGER_LEVEL,m_logger,"hsl(%d,%d,%d)->RGB(%d,%d,%d)",hueAt(0),saturationAt(0),lightnessAt(0),rgb.red,rgb.green,rgb.blue);
+            m_base->writePixels(0,m_rgb,m_count);
             m_base->show();
+            m_changed = false;
+            m_shownFrames++;
         }
 
+        // frames sent to the base strip and frames skipped because they matched the last one
+        uint32_t getShownFrames() { return m_shownFrames;}
+        uint32_t getUnchangedFrames() { return m_unchangedFrames;}
+        uint32_t getConvertedPixels() { return m_convertedPixels;}
+
         int getCount() { return AlteredStrip::getCount();}
+        HSLStripLayout getLayout() { return m_layout;}
         virtual IHSLStrip* getFirstHSLStrip() { return this;}
         virtual CompoundLedStrip* getCompoundLedStrip() { return m_base?m_base->getCompoundLedStrip() : NULL;}
 
     protected:
+        int16_t& hueAt(int index) { return m_hue[index*m_hueStride];}
+        int8_t& saturationAt(int index) { return m_saturation[index*m_stride];}
+        int8_t& lightnessAt(int index) { return m_lightness[index*m_stride];}
+
+        static int validWords(int count) { return (count+31)/32;}
+
+        bool isValid(int index) { return (m_valid[index>>5] & (1u << (index&31))) != 0;}
+
+        // the pixel's HSL values as one word.  all -1 (HSL_UNSET_KEY) is black like an unset pixel
+        uint32_t pixelKey(int index) {
+            return (uint16_t)hueAt(index) | ((uint32_t)(uint8_t)saturationAt(index) << 16) | ((uint32_t)(uint8_t)lightnessAt(index) << 24);
+        }
+
+        void convertRun(int start, int end) {
+            if (m_layout == HSL_LAYOUT_INTERLEAVED) {
+                HSLToRGB(m_pixels+start,m_rgb+start,end-start);
+            } else {
+                HSLToRGB(m_hue+start,m_saturation+start,m_lightness+start,m_rgb+start,end-start);
+            }
+            m_convertedPixels += end-start;
+        }
+
+        // the first value set in a frame starts from unset
+        void validate(int index) {
+            uint32_t& word = m_valid[index>>5];
+            uint32_t bit = 1u << (index&31);
+            if ((word & bit) == 0) {
+                word |= bit;
+                hueAt(index) = -1;
+                saturationAt(index) = -1;
+                lightnessAt(index) = -1;
+            }
+        }
+
+        // one block: HSL values (4 bytes per LED in either layout), the valid bitmap,
+        // the last frame's pixel keys, then the RGB buffer
         void reallocHSLData(int count) {
-            if ((count == 0 || count > m_count) && m_hue != NULL) {
-                m_logger->debug("HSLStrip free %d %d",count,m_count);
-                free(m_hue);
-                free(m_saturation);
-                free(m_lightness);
+            if (m_data != NULL) {
+                m_logger->debug("HSLStrip free %d %d",count,m_capacity);
+                free(m_data);
+                m_data = NULL;
+                m_pixels = NULL;
                 m_hue = NULL;
                 m_saturation = NULL;
                 m_lightness = NULL;
+                m_valid = NULL;
+                m_previous = NULL;
+                m_rgb = NULL;
+                m_capacity = 0;
+            }
+            if (count <= 0) {
+                return;
+            }
+            m_logger->debug("HSLStrip malloc %d ",count);
+            size_t validBytes = validWords(count)*sizeof(uint32_t);
+            m_data = (uint8_t*)malloc(sizeof(HSLPixel)*count + validBytes + sizeof(uint32_t)*count + sizeof(CRGB)*count);
+            if (m_data == NULL) {
+                m_logger->error("out of memory for %d HSL pixels",count);
+                return;
             }
-            if (count > 0 && m_hue == NULL) {
-                m_logger->debug("HSLStrip malloc %d ",count);
-                m_hue = (int16_t*) malloc(sizeof(int16_t)*count);
-                m_saturation = (int8_t*) malloc(sizeof(int8_t)*count);
-                m_lightness = (int8_t*) malloc(sizeof(int8_t)*count);
-                m_count = count;
+            m_capacity = count;
+            if (m_layout == HSL_LAYOUT_INTERLEAVED) {
+                m_pixels = (HSLPixel*)m_data;
+                m_hue = &m_pixels->hue;
+                m_saturation = &m_pixels->saturation;
+                m_lightness = &m_pixels->lightness;
+                m_hueStride = sizeof(HSLPixel)/sizeof(int16_t);
+                m_stride = sizeof(HSLPixel);
             } else {
-                m_logger->debug("no need to malloc members %d",count);
+                m_hue = (int16_t*)m_data;
+                m_saturation = (int8_t*)(m_hue+count);
+                m_lightness = m_saturation+count;
+                m_hueStride = 1;
+                m_stride = 1;
             }
+            m_valid = (uint32_t*)(m_data + sizeof(HSLPixel)*count);
+            m_previous = (uint32_t*)(m_data + sizeof(HSLPixel)*count + validBytes);
+            m_rgb = (CRGB*)(m_previous + count);
+            // the last frame is all unset (black) and must be sent
+            memset(m_previous,0xFF,sizeof(uint32_t)*count);
+            memset((void*)m_rgb,0,sizeof(CRGB)*count);
+            m_changed = true;
         }
 
         int16_t defaultValue(int min, int max, int val, int def) {
@@ -490,7 +703,7 @@ class HSLStrip: public AlteredStrip, public IHSLStrip{
             case ADD:
                 return currentValue + operand;
             case SUBTRACT:
-                m_logger->never("SUBTRACT %d-%d=%d",currentValue,operand,currentValue-operand);
+                DRLOG_NEVER("SUBTRACT %d-%d=%d",currentValue,operand,currentValue-operand);
                 return currentValue - operand;
             case AVERAGE:
                 return (currentValue + operand)/2;
@@ -505,10 +718,23 @@ class HSLStrip: public AlteredStrip, public IHSLStrip{
         }
 
     private:
+        HSLStripLayout m_layout;
         uint16_t m_count;
+        uint16_t m_capacity;
+        uint8_t * m_data;           // the only allocation.  everything below points into it
+        HSLPixel * m_pixels;        // HSL_LAYOUT_INTERLEAVED only
         int16_t * m_hue;
         int8_t  * m_saturation;
         int8_t  * m_lightness;
+        uint8_t m_hueStride;        // in int16_t
+        uint8_t m_stride;           // saturation and lightness stride in bytes
+        uint32_t * m_valid;
+        uint32_t * m_previous;      // pixelKey() of each pixel in the last frame
+        CRGB * m_rgb;               // show() output.  kept between frames
+        bool m_changed;             // the next show() is sent even if no pixel changed
+        uint32_t m_shownFrames;
+        uint32_t m_unchangedFrames;
+        uint32_t m_convertedPixels;
         HSLOperation m_op;
 };
 
@@ -2,6 +2,7 @@
 #define DR_LIST_H
 
 #include "./logger.h"
+#include "./arena.h"
 
 namespace DevRelief {
 
@@ -9,7 +10,7 @@ Logger LinkedListLogger("LinkedList",LINKED_LIST_LOGGER_LEVEL);
 Logger PtrListLogger("PtrList",PTR_LIST_LOGGER_LEVEL);
 
 template<class T>
-struct ListNode
+struct ListNode : ArenaObject
 {
 	T data;
 	ListNode<T> *next;
@@ -348,5 +349,183 @@ void PtrList<T>::deleteNode(ListNode<T>*node) {
     }
 }
 
+/* SmallList is a growable array with the LinkedList interface.  The first
+ * INLINE items are stored in the list object itself and more are kept in one
+ * malloc'd array, so small lists do no allocation and get(index) is a
+ * single read.  Items can be removed from inside each().
+ */
+template<typename T, int INLINE=4>
+class SmallList {
+public:
+    SmallList() {
+        m_items = m_inline;
+        m_size = 0;
+        m_capacity = INLINE;
+        m_eachIndex = -1;
+    }
+
+    virtual ~SmallList() {
+        if (m_items != m_inline) {
+            free(m_items);
+        }
+    }
+
+    // m_items may point at m_inline, so a copy would share or double free it
+    SmallList(const SmallList&) = delete;
+    SmallList& operator=(const SmallList&) = delete;
+
+    int size() const { return m_size;}
+
+    bool add(T item) {
+        if (!reserve(m_size+1)) {
+            return false;
+        }
+        m_items[m_size++] = item;
+        return true;
+    }
+
+    // an index past the end adds the item
+    bool insertAt(int index, T item) {
+        if (!reserve(m_size+1)) {
+            return false;
+        }
+        if (index < 0) {
+            index = 0;
+        } else if (index > m_size) {
+            index = m_size;
+        }
+        for(int i=m_size;i>index;i--) {
+            m_items[i] = m_items[i-1];
+        }
+        m_items[index] = item;
+        m_size++;
+        if (index <= m_eachIndex) {
+            m_eachIndex++;
+        }
+        return true;
+    }
+
+    T get(int index) const {
+        return index >= 0 && index < m_size ? m_items[index] : T();
+    }
+    T operator[](int index) const { return get(index);}
+    T last() const { return m_size > 0 ? m_items[m_size-1] : T();}
+
+    void removeAt(int index) {
+        if (index < 0 || index >= m_size) {
+            return;
+        }
+        T item = m_items[index];
+        for(int i=index;i<m_size-1;i++) {
+            m_items[i] = m_items[i+1];
+        }
+        m_size--;
+        if (index <= m_eachIndex) {
+            m_eachIndex--;
+        }
+        releaseItem(item);
+    }
+
+    void removeFirst(T t) { removeAt(firstIndexOf(t));}
+
+    void removeAll(T t) {
+        int idx = firstIndexOf(t);
+        while(idx >= 0) {
+            removeAt(idx);
+            idx = firstIndexOf(t,idx);
+        }
+    }
+
+    int firstIndexOf(T t,int start=0) const {
+        for(int i=start<0?0:start;i<m_size;i++) {
+            if (m_items[i] == t) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void clear() {
+        int count = m_size;
+        m_size = 0;
+        m_eachIndex = -1;
+        for(int i=0;i<count;i++) {
+            releaseItem(m_items[i]);
+        }
+    }
+
+    void each(auto&& lambda) {
+        int outer = m_eachIndex;
+        for(m_eachIndex=0;m_eachIndex<m_size;m_eachIndex++) {
+            lambda(m_items[m_eachIndex]);
+        }
+        m_eachIndex = outer;
+    }
+
+    void each(auto&& lambda) const {
+        for(int i=0;i<m_size;i++) {
+            lambda(m_items[i]);
+        }
+    }
+
+    T* first(auto&& lambda) const {
+        for(int i=0;i<m_size;i++) {
+            if (lambda(m_items[i])) {
+                return &m_items[i];
+            }
+        }
+        return NULL;
+    }
+
+    // the items in order.  valid until the list changes
+    T* data() const { return m_items;}
+
+protected:
+    virtual void releaseItem(T item) {}
+
+    bool reserve(int count) {
+        if (count <= m_capacity) {
+            return true;
+        }
+        int capacity = m_capacity < 4 ? 8 : m_capacity*2;
+        T* items = (T*)malloc(capacity*sizeof(T));
+        if (items == NULL) {
+            PtrListLogger.error("out of memory for SmallList");
+            return false;
+        }
+        for(int i=0;i<m_size;i++) {
+            items[i] = m_items[i];
+        }
+        if (m_items != m_inline) {
+            free(m_items);
+        }
+        m_items = items;
+        m_capacity = capacity;
+        return true;
+    }
+
+    T* m_items;
+    int m_size;
+    int m_capacity;
+    int m_eachIndex;    // item each() is on or -1
+    T m_inline[INLINE];
+};
+
+// SmallList that destroy()s items when they are removed, like PtrList
+template<typename T, int INLINE=4>
+class PtrSmallList : public SmallList<T,INLINE> {
+public:
+    virtual ~PtrSmallList() {
+        SmallList<T,INLINE>::clear();
+    }
+
+protected:
+    void releaseItem(T item) override {
+        if (item != NULL) {
+            item->destroy();
+        }
+    }
+};
+
 };
 #endif
\ No newline at end of file
@@ -19,6 +19,24 @@ enum LogLevel {
     NEVER=-2
 };
 
+/* Compile-time level checks for code that runs per LED or per frame.  The
+ * module level is one of the *_LOGGER_LEVEL values from env.h.  When the
+ * message's level is above it (or LOGGING_ON is 0) the call and its
+ * arguments compile away, so they cost nothing even if an argument calls a
+ * function.  Use these instead of m_logger->debug()/never() in hot paths.
+ *   DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"LED %d",index);
+ */
+#define DRLOG_ENABLED(moduleLevel,level) (LOGGING_ON==1 && (moduleLevel) >= (level))
+#define DRLOG_DEBUG(moduleLevel,logger,...) do { if (DRLOG_ENABLED(moduleLevel,DEBUG_LEVEL)) { (logger)->debug(__VA_ARGS__);} } while(0)
+#define DRLOG_INFO(moduleLevel,logger,...) do { if (DRLOG_ENABLED(moduleLevel,INFO_LEVEL)) { (logger)->info(__VA_ARGS__);} } while(0)
+#define DRLOG_WARN(moduleLevel,logger,...) do { if (DRLOG_ENABLED(moduleLevel,WARN_LEVEL)) { (logger)->warn(__VA_ARGS__);} } while(0)
+// never() messages are never written.  keeping them as DRLOG_NEVER documents the code without evaluating anything
+#define DRLOG_NEVER(...) do {} while(0)
+
+class Logger;
+// more lines for Logger::showMemory().  arena.h sets it when the first Arena is made
+void (*ShowMemoryHook)(Logger* logger, const char * label) = NULL;
+
 #if LOGGING_ON==1
 bool serialInitilized = false;
 void initializeWriter() {
@@ -46,6 +64,401 @@ long lastErrorTime=0;
 int loggerIndent=0;
 bool logTestingMessage = false;
 
+// level names are shared by Logger and the deferred log ring
+const char * logLevelName(int level) {
+    if (level > 80) {
+        return "DEBUG";
+    }
+    if (level > 60) {
+        return "INFO ";
+    }if (level > 40) {
+        return "WARN ";
+    }
+    if (level ==  ALWAYS) {
+        return "ALWAYS";
+    } else if (level == TEST_LEVEL) {
+        return "TEST";
+    }
+    return "ERROR";
+}
+
+void writeLogLine(int level, int loggerLevel, unsigned long timeMs, const char * name, int indent, const char * message) {
+    unsigned long now = timeMs/1000;
+    int hours = now/3600;
+    now = now % 3600;
+    int minutes = now/60;
+    int seconds = now % 60;
+    const char * tabs = indent<=0 ? "" : (TABS + MAX_TAB_COUNT-indent);
+    Serial.printf("%6s/%3d - %02d:%02d:%02d - %20s: %s ",
+        logLevelName(level),loggerLevel,hours,minutes,seconds,name,tabs);
+    Serial.println(message);
+}
+
+#define LOG_ENTRY_ARGS 4
+#define LOG_ENTRY_TEXT_SIZE 32
+#define LOG_SPEC_SIZE 15
+
+enum LogArgType {
+    LOG_ARG_NONE=0,     // %%
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LONG_LONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING      // copied into the entry's text
+};
+
+union LogArg {
+    long long integer;
+    double number;
+    const void * pointer;
+};
+
+struct LogEntry {
+    uint32_t time;
+    int16_t level;
+    int16_t loggerLevel;
+    uint8_t indent;
+    uint8_t textUsed;
+    uint8_t argCount;           // args stored by capture()
+    const char * module;
+    const char * format;        // NULL if text holds the formatted message
+    LogArg args[LOG_ENTRY_ARGS];
+    char text[LOG_ENTRY_TEXT_SIZE];
+};
+
+/* LogRing is the binary log sink.  Once started, Logger::write() stores the
+ * format pointer and raw arguments in a fixed ring instead of formatting and
+ * writing to Serial, so a burst of messages costs the frame a few copies.
+ * drain() formats and writes entries later when the app is idle.
+ *
+ * There is one producer (Logger::write) and one consumer (drain) so the ring
+ * needs no lock: the producer publishes an entry by moving m_head after it is
+ * written and only the consumer moves m_tail.  When the ring is full of
+ * entries that have not been drained the new message is dropped and counted.
+ * Drained entries stay in the ring until they are overwritten so the most
+ * recent messages can be read with formatRecent().
+ *
+ * Formats and Logger names must be string literals.  A message built at run
+ * time is passed as the argument of a "%s" format.  %s arguments
+ * are copied into the entry and truncated to LOG_ENTRY_TEXT_SIZE in total.
+ * Messages with more than LOG_ENTRY_ARGS arguments or a '*' width are
+ * formatted when they are written and truncated the same way.
+ */
+class LogRing {
+    public:
+        LogRing(int capacity) {
+            m_capacity = capacity;
+            m_entries = NULL;
+            m_head = 0;
+            m_tail = 0;
+            m_dropped = 0;
+        }
+
+        ~LogRing() {
+            free(m_entries);
+        }
+
+        // allocate the ring and send Logger messages to it
+        bool start() {
+            if (m_entries == NULL && m_capacity > 0) {
+                m_entries = (LogEntry*)malloc(m_capacity*sizeof(LogEntry));
+            }
+            return m_entries != NULL;
+        }
+
+        // write anything left and go back to writing messages immediately
+        void stop() {
+            drain(m_capacity,0);
+            free(m_entries);
+            m_entries = NULL;
+            m_head = 0;
+            m_tail = 0;
+        }
+
+        bool isStarted() { return m_entries != NULL;}
+
+        void add(int level, int loggerLevel, const char * module, int indent, const char * format, va_list args) {
+            if (m_head - m_tail >= (uint32_t)m_capacity) {
+                m_dropped++;
+                return;
+            }
+            LogEntry* entry = m_entries + (m_head % m_capacity);
+            entry->time = millis();
+            entry->level = level;
+            entry->loggerLevel = loggerLevel;
+            entry->indent = indent;
+            entry->module = module;
+            entry->textUsed = 0;
+            va_list copy;
+            va_copy(copy,args);
+            if (!capture(entry,format,args)) {
+                entry->format = NULL;
+                vsnprintf(entry->text,LOG_ENTRY_TEXT_SIZE,format,copy);
+            }
+            va_end(copy);
+            m_head++;
+        }
+
+        /* format and write up to maxEntries.  stops early once maxMsecs have
+         * passed (0 for no limit).  returns the number written
+         */
+        int drain(int maxEntries, unsigned long maxMsecs) {
+            unsigned long start = millis();
+            int count = 0;
+            while(m_tail != m_head && count < maxEntries) {
+                if (maxMsecs > 0 && millis()-start >= maxMsecs) {
+                    break;
+                }
+                const LogEntry* entry = m_entries + (m_tail % m_capacity);
+                formatMessage(entry,messageBuffer,MAX_MESSAGE_SIZE);
+                writeLogLine(entry->level,entry->loggerLevel,entry->time,entry->module,entry->indent,messageBuffer);
+                m_tail++;
+                count++;
+            }
+            return count;
+        }
+
+        // number of entries formatRecent() can return, drained or not
+        int getRecentCount() {
+            return m_head < (uint32_t)m_capacity ? m_head : m_capacity;
+        }
+
+        // index 0 is the oldest entry still in the ring
+        const LogEntry* getRecent(int index) {
+            if (index < 0 || index >= getRecentCount()) {
+                return NULL;
+            }
+            return m_entries + ((m_head - getRecentCount() + index) % m_capacity);
+        }
+
+        // "<msecs> <level> <logger>: <message>"
+        bool formatRecent(int index, char * buffer, size_t size) {
+            const LogEntry* entry = getRecent(index);
+            if (entry == NULL) {
+                return false;
+            }
+            int prefix = snprintf(buffer,size,"%lu %s %s: ",(unsigned long)entry->time,logLevelName(entry->level),entry->module);
+            if (prefix < 0 || (size_t)prefix >= size) {
+                return true;
+            }
+            formatMessage(entry,buffer+prefix,size-prefix);
+            return true;
+        }
+
+        uint32_t getWritten() { return m_head;}
+        uint32_t getPending() { return m_head - m_tail;}
+        uint32_t getDropped() { return m_dropped;}
+        int getCapacity() { return m_capacity;}
+
+        // the message without the level/time/name prefix
+        static void formatMessage(const LogEntry* entry, char * buffer, size_t size) {
+            if (entry->format == NULL) {
+                strncpy(buffer,entry->text,size);
+                buffer[size-1] = 0;
+                return;
+            }
+            const char * pos = entry->format;
+            size_t len = 0;
+            int argIndex = 0;
+            while(*pos != 0 && len+1 < size) {
+                if (*pos != '%') {
+                    buffer[len++] = *pos++;
+                    continue;
+                }
+                const char * spec = pos;
+                LogArgType type;
+                if (!parseSpec(pos,type)) {
+                    break;
+                }
+                if (type == LOG_ARG_NONE) {
+                    buffer[len++] = '%';
+                    continue;
+                }
+                if (argIndex >= entry->argCount) {
+                    break;
+                }
+                char specText[LOG_SPEC_SIZE+1];
+                memcpy(specText,spec,pos-spec);
+                specText[pos-spec] = 0;
+                const LogArg& arg = entry->args[argIndex++];
+                char * out = buffer+len;
+                size_t left = size-len;
+                int written = 0;
+                switch(type) {
+                    case LOG_ARG_INT:
+                        written = snprintf(out,left,specText,(int)arg.integer);
+                        break;
+                    case LOG_ARG_LONG:
+                        written = snprintf(out,left,specText,(long)arg.integer);
+                        break;
+                    case LOG_ARG_LONG_LONG:
+                        written = snprintf(out,left,specText,arg.integer);
+                        break;
+                    case LOG_ARG_SIZE:
+                        written = snprintf(out,left,specText,(size_t)arg.integer);
+                        break;
+                    case LOG_ARG_DOUBLE:
+                        written = snprintf(out,left,specText,arg.number);
+                        break;
+                    case LOG_ARG_POINTER:
+                        written = snprintf(out,left,specText,arg.pointer);
+                        break;
+                    case LOG_ARG_STRING:
+                        written = snprintf(out,left,specText,arg.integer < 0 ? "(null)" : entry->text + (int)arg.integer);
+                        break;
+                    default:
+                        break;
+                }
+                if (written < 0) {
+                    break;
+                }
+                len += (size_t)written < left ? written : left-1;
+            }
+            buffer[len] = 0;
+        }
+
+        /* parse the conversion at pos ('%') and move past it.  returns false for
+         * conversions the ring does not store (*, %n, long double, wide strings)
+         */
+        static bool parseSpec(const char *& pos, LogArgType& type) {
+            const char * start = pos;
+            pos++;
+            if (*pos == '%') {
+                pos++;
+                type = LOG_ARG_NONE;
+                return true;
+            }
+            while(*pos != 0 && strchr("-+ #0",*pos) != NULL) { pos++;}
+            while(*pos >= '0' && *pos <= '9') { pos++;}
+            if (*pos == '.') {
+                pos++;
+                while(*pos >= '0' && *pos <= '9') { pos++;}
+            }
+            int longs = 0;
+            bool sized = false;
+            bool other = false;
+            while(*pos != 0 && strchr("hlzjtL",*pos) != NULL) {
+                if (*pos == 'l') { longs++;}
+                else if (*pos == 'z' || *pos == 't') { sized = true;}
+                else if (*pos == 'j') { longs = 2;}
+                else if (*pos == 'L') { other = true;}
+                pos++;
+            }
+            char conversion = *pos;
+            if (conversion == 0) {
+                return false;
+            }
+            pos++;
+            if (pos - start > LOG_SPEC_SIZE) {
+                return false;
+            }
+            if (strchr("diouxXc",conversion) != NULL) {
+                type = sized ? LOG_ARG_SIZE : longs >= 2 ? LOG_ARG_LONG_LONG : longs == 1 ? LOG_ARG_LONG : LOG_ARG_INT;
+                return !other && !(conversion == 'c' && longs > 0);
+            }
+            if (strchr("fFeEgGaA",conversion) != NULL) {
+                type = LOG_ARG_DOUBLE;
+                return !other;
+            }
+            if (conversion == 's') {
+                type = LOG_ARG_STRING;
+                return longs == 0;
+            }
+            if (conversion == 'p') {
+                type = LOG_ARG_POINTER;
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        // store the arguments.  false if the format needs to be formatted now
+        bool capture(LogEntry* entry, const char * format, va_list args) {
+            entry->format = format;
+            entry->argCount = 0;
+            int argIndex = 0;
+            const char * pos = format;
+            while(*pos != 0) {
+                if (*pos != '%') {
+                    pos++;
+                    continue;
+                }
+                LogArgType type;
+                if (!parseSpec(pos,type)) {
+                    return false;
+                }
+                if (type == LOG_ARG_NONE) {
+                    continue;
+                }
+                if (argIndex >= LOG_ENTRY_ARGS) {
+                    return false;
+                }
+                LogArg& arg = entry->args[argIndex++];
+                entry->argCount = argIndex;
+                switch(type) {
+                    case LOG_ARG_INT:
+                        arg.integer = va_arg(args,int);
+                        break;
+                    case LOG_ARG_LONG:
+                        arg.integer = va_arg(args,long);
+                        break;
+                    case LOG_ARG_LONG_LONG:
+                        arg.integer = va_arg(args,long long);
+                        break;
+                    case LOG_ARG_SIZE:
+                        arg.integer = va_arg(args,size_t);
+                        break;
+                    case LOG_ARG_DOUBLE:
+                        arg.number = va_arg(args,double);
+                        break;
+                    case LOG_ARG_POINTER:
+                        arg.pointer = va_arg(args,void*);
+                        break;
+                    case LOG_ARG_STRING:
+                        copyString(entry,arg,va_arg(args,const char*));
+                        break;
+                    default:
+                        break;
+                }
+            }
+            return true;
+        }
+
+        // the argument is the string's offset in entry->text or -1 for NULL
+        static void copyString(LogEntry* entry, LogArg& arg, const char * text) {
+            if (text == NULL) {
+                arg.integer = -1;
+                return;
+            }
+            int used = entry->textUsed;
+            if (used >= LOG_ENTRY_TEXT_SIZE-1) {
+                // no room left.  the string is empty
+                entry->text[LOG_ENTRY_TEXT_SIZE-1] = 0;
+                arg.integer = LOG_ENTRY_TEXT_SIZE-1;
+                return;
+            }
+            int space = LOG_ENTRY_TEXT_SIZE - used - 1;
+            int length = 0;
+            while(length < space && text[length] != 0) {
+                length++;
+            }
+            memcpy(entry->text+used,text,length);
+            entry->text[used+length] = 0;
+            entry->textUsed = used+length+1;
+            arg.integer = used;
+        }
+
+        LogEntry* m_entries;
+        int m_capacity;
+        volatile uint32_t m_head;   // entries written
+        volatile uint32_t m_tail;   // entries drained
+        uint32_t m_dropped;
+};
+
+LogRing BinaryLog(BINARY_LOG_SIZE);
+
 class Logger {
 public:
     Logger(const char * name, int level = 100) {
@@ -64,6 +477,7 @@ public:
 
     void setModuleName(const char * name) {
         m_name = name;
+        m_module = name;
 
     }
 
@@ -95,16 +509,12 @@ public:
             return;
         }
 
+        if (BinaryLog.isStarted()) {
+            BinaryLog.add(level,m_level,m_module,loggerIndent,message,args);
+            return;
+        }
         vsnprintf(messageBuffer,MAX_MESSAGE_SIZE,message,args);
-        unsigned long now = millis()/1000;
-        int hours = now/3600;
-        now = now % 3600;
-        int minutes = now/60;
-        int seconds = now % 60;
-        const char * tabs = loggerIndent<=0 ? "" : (TABS + MAX_TAB_COUNT-loggerIndent);
-        Serial.printf("%6s/%3d - %02d:%02d:%02d - %20s: %s ",
-            getLevelName(level),m_level,hours,minutes,seconds,m_name.c_str(),tabs);
-        Serial.println(messageBuffer);
+        writeLogLine(level,m_level,millis(),m_name.c_str(),loggerIndent,messageBuffer);
     }
 
     void write(int level, const char * message,...) {
@@ -238,35 +648,40 @@ public:
     }
 
     const char * getLevelName(int level) {
-        if (level > 80) {
-            return "DEBUG";
-        }
-        if (level > 60) {
-            return "INFO ";
-        }if (level > 40) {
-            return "WARN ";
-        }
-        if (level ==  ALWAYS) {
-            return "ALWAYS";
-        } else if (level == TEST_LEVEL) {
-            return "TEST";
-        }
-        return "ERROR";
-        
+        return logLevelName(level);
     }
 
     void showMemory(const char * label="Memory") {
         write(INFO_LEVEL,"%s: stack=%d,  heap=%d",label,ESP.getFreeContStack(),ESP.getFreeHeap());
-
+        if (ShowMemoryHook != NULL) {
+            ShowMemoryHook(this,label);
+        }
     }
 
 private:
     String m_name;
+    const char * m_module;  // literal name for the deferred log
     int m_level;
     long m_periodicTimer;
 
 };
 #else
+    class LogRing {
+        public:
+        LogRing(int capacity) {}
+        bool start() { return false;}
+        void stop() {}
+        bool isStarted() { return false;}
+        int drain(int maxEntries, unsigned long maxMsecs) { return 0;}
+        int getRecentCount() { return 0;}
+        bool formatRecent(int index, char * buffer, size_t size) { return false;}
+        uint32_t getWritten() { return 0;}
+        uint32_t getPending() { return 0;}
+        uint32_t getDropped() { return 0;}
+        int getCapacity() { return 0;}
+    };
+    LogRing BinaryLog(0);
+
     class Logger {
         public: 
         Logger(const char * name, int level = 100) {}
@@ -1,9 +1,10 @@
 #ifndef PARSE_GEN_H
 #define PARSE_GEN_H
 
-#include "./logger.h";
-#include "./buffer.h";
-#include "./util.h";
+#include "./logger.h"
+#include "./buffer.h"
+#include "./util.h"
+#include "./arena.h"
 
 
 namespace DevRelief {
@@ -54,7 +55,7 @@ Logger ParserLogger("JsonParser",PARSER_LOGGER_LEVEL);
 Logger GeneratorLogger("JsonGenerator",GENERATOR_LOGGER_LEVEL);
 
 
-typedef enum TokenType {
+enum TokenType {
     TOK_EOD=1000,
     TOK_ERROR=1001,
     TOK_START=1002,
@@ -72,7 +73,7 @@ typedef enum TokenType {
     TOK_FALSE
 };
 
-typedef enum JsonType {
+enum JsonType {
     JSON_UNKNOWN=999,
     JSON_NULL=998,
     JSON_INTEGER=100,
@@ -179,6 +180,66 @@ class JsonBase {
 class JsonObject;
 class JsonArray;
 
+// the arena of the JsonRoot being parsed.  JSON elements created outside a
+// parse use the heap
+Arena* CurrentJsonArena = NULL;
+
+static int jsonHexDigit(char c) {
+    if (c >= '0' && c <= '9') { return c-'0';}
+    if (c >= 'a' && c <= 'f') { return c-'a'+10;}
+    if (c >= 'A' && c <= 'F') { return c-'A'+10;}
+    return -1;
+}
+
+// write text without its JSON escapes.  out may be text since the result is
+// never longer.  \u escapes are written as UTF-8.  returns the length written
+size_t jsonUnescape(char * out, const char * text, size_t length) {
+    size_t o = 0;
+    for(size_t i=0;i<length;i++) {
+        char c = text[i];
+        if (c != '\\' || i+1 >= length) {
+            out[o++] = c;
+            continue;
+        }
+        c = text[++i];
+        switch(c) {
+            case 'n': out[o++] = '\n'; break;
+            case 't': out[o++] = '\t'; break;
+            case 'r': out[o++] = '\r'; break;
+            case 'b': out[o++] = '\b'; break;
+            case 'f': out[o++] = '\f'; break;
+            case 'u': {
+                int code = 0;
+                int digits = 0;
+                while(digits < 4 && i+1+digits < length && jsonHexDigit(text[i+1+digits]) >= 0) {
+                    code = code*16 + jsonHexDigit(text[i+1+digits]);
+                    digits++;
+                }
+                if (digits < 4) {
+                    out[o++] = 'u';
+                } else if (code < 0x80) {
+                    out[o++] = (char)code;
+                } else if (code < 0x800) {
+                    out[o++] = (char)(0xC0 | (code >> 6));
+                    out[o++] = (char)(0x80 | (code & 0x3F));
+                } else {
+                    out[o++] = (char)(0xE0 | (code >> 12));
+                    out[o++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                    out[o++] = (char)(0x80 | (code & 0x3F));
+                }
+                if (digits == 4) {
+                    i += 4;
+                }
+                break;
+            }
+            default:
+                // \" \\ \/ and anything unknown
+                out[o++] = c;
+        }
+    }
+    return o;
+}
+
 class JsonRoot : public JsonBase {
     public:
         JsonRoot() : JsonBase() {
@@ -186,6 +247,8 @@ class JsonRoot : public JsonBase {
             m_logger = &JSONLogger;
             mem.construct("JsonRoot",this);
             m_nextJsonId = 1;
+            m_source = NULL;
+            m_sourceEnd = NULL;
             setJsonId(this);
         }
 
@@ -208,11 +271,42 @@ class JsonRoot : public JsonBase {
             return str;
         }
 
+        // a string token's text without its escapes.  a root read in place
+        // changes the token in its source and returns it.  otherwise a copy
+        char * parsedString(const char * token, size_t len) {
+            if (len == 0) {
+                return NULL;
+            }
+            char * str = inSource(token) ? (char*)token : (char*)malloc(len+1);
+            if (str == NULL) {
+                m_logger->errorNoRepeat("out of memory for JSON string");
+                return NULL;
+            }
+            size_t unescaped = jsonUnescape(str,token,len);
+            str[unescaped] = 0;
+            if (str != token) {
+                mem.allocString(str,len,this);
+            }
+            return str;
+        }
+
         void freeString(const char * val) {
+            if (val == NULL || inSource(val)) {
+                return;
+            }
             mem.freeString(val,this);
             free((void*)val);
         }
 
+        // the text strings are kept in after JsonParser::readInPlace()
+        void setSource(char * source) {
+            m_source = source;
+            m_sourceEnd = source == NULL ? NULL : source+strlen(source);
+        }
+
+        // elements made while this root is parsed
+        Arena* getArena() { return &m_arena;}
+
         virtual JsonRoot* getRoot() { return this;}
         virtual JsonElement* asElement() { return m_value;}
         virtual bool add(JsonElement* child) { 
@@ -252,9 +346,15 @@ class JsonRoot : public JsonBase {
         JsonObject* asObject();
         JsonArray* asArray();
     protected:
+        bool inSource(const char * str) { return str >= m_source && str < m_sourceEnd;}
+
         int m_nextJsonId;
         JsonElement * m_value;
         Logger* m_logger;
+        const char * m_source;
+        const char * m_sourceEnd;
+        // after m_value so elements are deleted before the arena is released
+        Arena m_arena;
 };
 
 class JsonElement : public JsonBase {
@@ -270,6 +370,15 @@ class JsonElement : public JsonBase {
             mem.destruct("JsonElement",this);
          }
 
+        // elements go in the arena of a root being parsed
+        static void* operator new(size_t size) {
+            return ArenaObject::allocate(CurrentJsonArena,size);
+        }
+
+        static void operator delete(void* ptr, size_t size) {
+            ArenaObject::release(ptr,size);
+        }
+
         virtual JsonElement* asElement() { return this;}
         virtual JsonRoot* getRoot() { return & m_root;}
         virtual Logger* getLogger() { return m_root.getLogger();}
@@ -293,7 +402,7 @@ class JsonElement : public JsonBase {
 class JsonProperty : public JsonElement {
     public:
         JsonProperty(JsonRoot& root, const char * name,size_t nameLength,JsonElement* value) : JsonElement(root,JSON_PROPERTY) {
-            m_name = root.allocString(name,nameLength);
+            m_name = root.parsedString(name,nameLength);
             m_value = value;
             m_next = NULL;
             m_logger->info("JsonProperty for type %d",m_value->getType());
@@ -323,27 +432,36 @@ class JsonProperty : public JsonElement {
         JsonElement * getValue() { return m_value;}
         const char * getName() { return m_name;}
         
-        int getCount() { return m_next == NULL ? 1 : 1+m_next->getCount();}
+        // this property and the ones after it
+        int getCount() {
+            int count = 0;
+            for(JsonProperty* prop=this;prop != NULL;prop=prop->m_next) {
+                count++;
+            }
+            return count;
+        }
+
         JsonElement* getAt(size_t idx) {
-            return idx==0 ? m_value : m_next == NULL ? NULL :m_next->getAt(idx-1);
+            JsonProperty* prop = this;
+            while(prop != NULL && idx > 0) {
+                prop = prop->m_next;
+                idx--;
+            }
+            return prop == NULL ? NULL : prop->m_value;
         }
 
         void setNext(JsonProperty*  next) {
-            m_logger->info("setNext property [%d]-->[%d]",getJsonId(),(next == NULL ? -1 : next->getJsonId()));
             if (m_next != NULL) {
                 delete m_next;
             }
             m_next = next;
         }
 
-        void addEnd(JsonProperty* next) {
-            if (m_next == NULL) {
-                m_logger->info("addEnd last [%d]-->[%d]",getJsonId(),(next == NULL ? -1 : next->getJsonId()));
-                m_next = next;
-            } else {
-                m_logger->info("addEnd middle [%d]-->[%d]",getJsonId(),(next == NULL ? -1 : next->getJsonId()));
-                m_next->addEnd(next);
-            }
+        // unlink the rest of the chain so it is not deleted with this property
+        JsonProperty* detachNext() {
+            JsonProperty* next = m_next;
+            m_next = NULL;
+            return next;
         }
 
         void setValue(JsonElement*val) {
@@ -369,16 +487,23 @@ class JsonProperty : public JsonElement {
         JsonProperty* m_next;
 };
 
+// objects with more properties than this get a hash index of their names
+#define JSON_INDEX_MIN_KEYS 8
+
 class JsonObject : public JsonElement {
     public:
         JsonObject(JsonRoot& root) : JsonElement(root,JSON_OBJECT) {
             m_logger->debug("create JsonObject ");
             m_firstProperty = NULL;
+            m_lastProperty = NULL;
+            m_count = 0;
+            m_index = NULL;
+            m_indexSize = 0;
             mem.construct("JsonObject",this);
             set("jsonId",getJsonId());
         }
         virtual ~JsonObject() {
-            delete m_firstProperty;
+            clear();
              mem.destruct("JsonObject",this);
        }
         
@@ -397,20 +522,15 @@ class JsonObject : public JsonElement {
             }
         }
         JsonProperty* add(JsonProperty* prop){
-            if (m_firstProperty == NULL) {
-                m_logger->info("set firstProperty of [%d]",getJsonId());
+            if (m_lastProperty == NULL) {
                 m_firstProperty = prop;
             } else {
-                m_logger->info("add property  [%d] (count=%d)",getJsonId(),getCount());
-                JsonProperty * end = m_firstProperty;
-                while(end->getNext() != NULL) {
-                    end = end->getNext();
-                }
-                end->setNext(prop);
-                m_logger->info("\tadded property  [%d] (count=%d)",getJsonId(),getCount());
-                for(JsonProperty*p=m_firstProperty;p!=NULL;p=p->getNext()){
-                    m_logger->info("\t\tprop [%d] %d",p->getJsonId(),p->getType());
-                }                
+                m_lastProperty->setNext(prop);
+            }
+            m_lastProperty = prop;
+            m_count++;
+            if (m_count > JSON_INDEX_MIN_KEYS) {
+                addToIndex(prop);
             }
             return prop;
         }
@@ -461,39 +581,109 @@ class JsonObject : public JsonElement {
         JsonArray* getArray(const char * name);
         JsonObject* getChild(const char * name);
 
+        // the first property with the name
         JsonProperty * getProperty(const char * name) {
-            m_logger->never("get property %s",name);
+            if (m_index != NULL) {
+                size_t slot = nameHash(name) & (m_indexSize-1);
+                while(m_index[slot] != NULL) {
+                    if (sameName(m_index[slot]->getName(),name)) {
+                        return m_index[slot];
+                    }
+                    slot = (slot+1) & (m_indexSize-1);
+                }
+                return NULL;
+            }
             for(JsonProperty*prop=m_firstProperty;prop!=NULL;prop=prop->getNext()){
-                m_logger->never("\tcheck %s",prop->getName());
-                if (strcmp(prop->getName(),name)==0) {
-                    m_logger->never("\tmatch");
+                if (sameName(prop->getName(),name)) {
                     return prop;
                 }
             }
-            m_logger->never("\tno match");
             return NULL;
         }
         JsonProperty* getFirstProperty() { return m_firstProperty;}
 
         JsonElement * getPropertyValue(const char * name) {
-            JsonProperty*e = m_firstProperty;
-            while(e != NULL && strcmp(e->getName(),name) != 0) {
-                e = e->getNext();
-            }
+            JsonProperty*e = getProperty(name);
             return e == NULL ? NULL : e->getValue();
         }
 
-        int getCount() { return m_firstProperty == NULL ? 0 : m_firstProperty->getCount();}
+        int getCount() { return m_count;}
         JsonElement* getAt(size_t idx) {
             return m_firstProperty == NULL ? NULL : m_firstProperty->getAt(idx);
         }
 
         void clear(){
-            delete m_firstProperty;
+            JsonProperty* prop = m_firstProperty;
+            while(prop != NULL) {
+                JsonProperty* next = prop->detachNext();
+                delete prop;
+                prop = next;
+            }
             m_firstProperty=NULL;
+            m_lastProperty=NULL;
+            m_count = 0;
+            ArenaObject::release(m_index,m_indexSize*sizeof(JsonProperty*));
+            m_index = NULL;
+            m_indexSize = 0;
         }
     protected:
+        // parsed strings are NULL if they are empty
+        static bool sameName(const char * a, const char * b) {
+            return strcmp(a ? a : "",b ? b : "")==0;
+        }
+
+        static uint32_t nameHash(const char * name) {
+            return name == NULL ? DRStringTable::hash("",0) : DRStringTable::hash(name,strlen(name));
+        }
+
+        void addToIndex(JsonProperty* prop) {
+            if (m_count*2 > m_indexSize) {
+                // keep the index at most half full.  rebuilding adds prop
+                buildIndex();
+                return;
+            }
+            size_t slot = nameHash(prop->getName()) & (m_indexSize-1);
+            while(m_index[slot] != NULL) {
+                if (sameName(m_index[slot]->getName(),prop->getName())) {
+                    // a duplicate name.  getProperty() returns the first
+                    return;
+                }
+                slot = (slot+1) & (m_indexSize-1);
+            }
+            m_index[slot] = prop;
+        }
+
+        void buildIndex() {
+            ArenaObject::release(m_index,m_indexSize*sizeof(JsonProperty*));
+            m_index = NULL;
+            int indexSize = JSON_INDEX_MIN_KEYS*2;
+            while(indexSize < m_count*2) {
+                indexSize *= 2;
+            }
+            JsonProperty** index = (JsonProperty**)ArenaObject::allocate(CurrentJsonArena,indexSize*sizeof(JsonProperty*));
+            if (index == NULL) {
+                // getProperty() walks the properties instead
+                m_logger->errorNoRepeat("out of memory for JSON property index");
+                m_indexSize = 0;
+                return;
+            }
+            memset(index,0,indexSize*sizeof(JsonProperty*));
+            m_index = index;
+            m_indexSize = indexSize;
+            // temporarily smaller than m_count so addToIndex() does not rebuild
+            int count = m_count;
+            m_count = 0;
+            for(JsonProperty*prop=m_firstProperty;prop!=NULL;prop=prop->getNext()){
+                addToIndex(prop);
+            }
+            m_count = count;
+        }
+
         JsonProperty* m_firstProperty;
+        JsonProperty* m_lastProperty;
+        int m_count;
+        JsonProperty** m_index;    // open addressing.  NULL until there are more than JSON_INDEX_MIN_KEYS
+        int m_indexSize;           // a power of 2
 };
 
 
@@ -518,21 +708,36 @@ class JsonArrayItem : public JsonElement {
         }
 
 
-        int getCount() { return m_next == NULL ? 1 : 1+m_next->getCount();}
+        // this item and the ones after it
+        int getCount() {
+            int count = 0;
+            for(JsonArrayItem* item=this;item != NULL;item=item->m_next) {
+                count++;
+            }
+            return count;
+        }
         
         JsonElement* getAt(size_t idx) {
-            return idx==0 ? m_value : m_next == NULL ? NULL :m_next->getAt(idx-1);
+            JsonArrayItem* item = this;
+            while(item != NULL && idx > 0) {
+                item = item->m_next;
+                idx--;
+            }
+            return item == NULL ? NULL : item->m_value;
         }
 
         JsonArrayItem* getNext() { return m_next;}
         JsonElement* getValue() { return m_value;}
 
-        void add(JsonArrayItem *last) {
-            if (m_next != NULL) {
-                m_next->add(last);
-            } else {
-                m_next = last;
-            }
+        void setNext(JsonArrayItem *next) {
+            m_next = next;
+        }
+
+        // unlink the rest of the chain so it is not deleted with this item
+        JsonArrayItem* detachNext() {
+            JsonArrayItem* next = m_next;
+            m_next = NULL;
+            return next;
         }
 
         
@@ -546,11 +751,21 @@ class JsonArray : public JsonElement {
         JsonArray(JsonRoot& root) : JsonElement(root,JSON_ARRAY) {
             m_logger->debug("create JsonArray ");
             m_firstItem = NULL;
+            m_lastItem = NULL;
+            m_count = 0;
+            m_items = NULL;
+            m_itemCapacity = 0;
             mem.construct("JsonArray",this);
         
         }
         virtual ~JsonArray() {
-            delete m_firstItem;
+            JsonArrayItem* item = m_firstItem;
+            while(item != NULL) {
+                JsonArrayItem* next = item->detachNext();
+                delete item;
+                item = next;
+            }
+            ArenaObject::release(m_items,m_itemCapacity*sizeof(JsonArrayItem*));
             mem.destruct("JsonArray",this);
         
         }
@@ -560,11 +775,19 @@ class JsonArray : public JsonElement {
 
         JsonArrayItem* addItem(JsonElement * value){
             JsonArrayItem* item = new JsonArrayItem(m_root,value);
-            if (m_firstItem == NULL) {
+            if (m_lastItem == NULL) {
                 m_firstItem = item;
             } else {
-                m_firstItem->add(item);
+                m_lastItem->setNext(item);
             }
+            m_lastItem = item;
+            if (m_count == m_itemCapacity) {
+                growItems();
+            }
+            if (m_count < m_itemCapacity) {
+                m_items[m_count] = item;
+            }
+            m_count++;
             return item;
         }
 
@@ -573,9 +796,16 @@ class JsonArray : public JsonElement {
         JsonArrayItem* add(double val);
         JsonArrayItem* add(bool val);
 
-        int getCount() { return m_firstItem == NULL ? 0 : m_firstItem->getCount();}
+        int getCount() { return m_count;}
         JsonElement* getAt(size_t idx) {
-            return m_firstItem == NULL ? NULL : m_firstItem->getAt(idx);
+            if (idx >= (size_t)m_count) {
+                return NULL;
+            }
+            if (idx < (size_t)m_itemCapacity) {
+                return m_items[idx]->getValue();
+            }
+            // the item table could not grow
+            return m_firstItem->getAt(idx);
         }
         JsonArrayItem* getFirstItem() {
             return m_firstItem;
@@ -592,7 +822,29 @@ class JsonArray : public JsonElement {
 
 
     protected: 
+        // the items are also in a table so getAt() does not walk the list.
+        // if the table cannot grow the items past its end are only in the list.
+        // like the elements it is in the arena of a parse or on the heap
+        void growItems() {
+            int capacity = m_itemCapacity == 0 ? 8 : m_itemCapacity*2;
+            JsonArrayItem** items = (JsonArrayItem**)ArenaObject::allocate(CurrentJsonArena,capacity*sizeof(JsonArrayItem*));
+            if (items == NULL) {
+                m_logger->errorNoRepeat("out of memory for JSON array items");
+                return;
+            }
+            if (m_items != NULL) {
+                memcpy(items,m_items,m_itemCapacity*sizeof(JsonArrayItem*));
+                ArenaObject::release(m_items,m_itemCapacity*sizeof(JsonArrayItem*));
+            }
+            m_items = items;
+            m_itemCapacity = capacity;
+        }
+
         JsonArrayItem * m_firstItem;
+        JsonArrayItem * m_lastItem;
+        int m_count;
+        JsonArrayItem ** m_items;
+        int m_itemCapacity;
 };
 
 class JsonValue : public JsonElement {
@@ -615,8 +867,9 @@ class JsonString : public JsonValue {
             m_logger->debug("create JsonString ~%s~ ",m_value ? m_value : "NULL");
             mem.construct("JsonString",this);
         }
+        // value is string token text from JSON
         JsonString(JsonRoot& root, const char * value, size_t len) : JsonValue(root,JSON_STRING) {
-            m_value = root.allocString(value,len);
+            m_value = root.parsedString(value,len);
             m_logger->debug("create JsonString ~%s~ ",m_value);
             mem.construct("JsonString",this);
         }
@@ -772,12 +1025,63 @@ class ParseGen {
 
 };
 
+/* IJsonSink is where JsonGenerator sends its text, JSON_CHUNK_SIZE bytes
+ * or less at a time.  begin() is called before the first write() and end()
+ * after the last, so a sink can send headers or finish a response.  any
+ * of them returning false stops the generator.
+ */
+class IJsonSink {
+    public:
+        virtual bool begin() { return true;}
+        virtual bool write(const char * text, size_t length)=0;
+        virtual bool end() { return true;}
+};
+
+// the whole document in a DRString
+class JsonStringSink : public IJsonSink {
+    public:
+        JsonStringSink(DRString* buffer) {
+            m_buf = buffer;
+        }
+
+        bool begin() override {
+            m_buf->clear();
+            return true;
+        }
+
+        bool write(const char * text, size_t length) override {
+            char * pos = m_buf->increaseLength(length);
+            if (pos == NULL) {
+                return false;
+            }
+            memcpy(pos,text,length);
+            return true;
+        }
+    private:
+        DRString* m_buf;
+};
+
+/* JsonGenerator writes JSON text into a JSON_CHUNK_SIZE buffer and gives
+ * it to an IJsonSink each time it fills, so a document sent to an HTTP
+ * response or a file never has to be in memory at once.
+ */
 class JsonGenerator : public ParseGen {
 public:
-    JsonGenerator(DRString& buffer) : m_buf(buffer) {
-        m_buf = buffer;
+    JsonGenerator(DRString& buffer) : m_stringSink(&buffer) {
+        m_sink = &m_stringSink;
+        m_depth = 0;
+        m_pos = 0;
+        m_written = 0;
+        m_failed = false;
+        m_logger = &GeneratorLogger;
+    }
+
+    JsonGenerator(IJsonSink& sink) : m_stringSink(NULL) {
+        m_sink = &sink;
         m_depth = 0;
         m_pos = 0;
+        m_written = 0;
+        m_failed = false;
         m_logger = &GeneratorLogger;
     }
 
@@ -786,17 +1090,16 @@ public:
     }
 
     bool generate(JsonBase* element) {
-        m_logger->debug("Generate JSON %d",element->getType());
         m_pos = 0;
         m_depth = 0; 
-        m_logger->debug("clear buffer");
-        
-        m_buf.clear();
-        m_logger->debug("\tcleared buffer");
+        m_written = 0;
+        m_failed = !m_sink->begin();
         if (element == NULL) {
             m_logger->error("\telement is NULL");
+            m_sink->end();
             return false;
         }
+        m_logger->debug("Generate JSON %d",element->getType());
         if (element->getType() == JSON_ROOT){
             m_logger->debug("write top element");
             writeElement(((JsonRoot*)element)->getTopElement());
@@ -804,10 +1107,20 @@ public:
             m_logger->debug("write self");
             writeElement((JsonElement*)element);
         }
-        m_logger->debug("generated: %s",m_buf.text());
-        return true;
+        flush();
+        if (!m_sink->end()) {
+            m_failed = true;
+        }
+        if (m_failed) {
+            m_logger->error("JSON output failed after %d bytes",m_written);
+        }
+        m_logger->debug("generated %d bytes",m_written);
+        return !m_failed;
     }
 
+    // bytes given to the sink by the last generate()
+    size_t getWritten() { return m_written;}
+
     void writeElement(JsonElement* element){
         if (element == NULL) {
             writeText("null");
@@ -954,42 +1267,77 @@ public:
             writeText("null");
             return;
         }
-        writeText("\"");
-        const char * end = strchr(txt,'\"');
-        while(end != NULL) {
-            size_t len = end-txt+1;
-            char* pos = m_buf.increaseLength(len+1);
-            memcpy(pos,txt,len);
-            pos[len] = '\\';
-            pos[len+1] = '\"';
-            txt = end+1;
-            end = strchr(txt,'\"');
-        }
-        writeText(txt);
-        writeText("\"");
+        writeString(txt);
+    }
+
+    // text with the JSON escapes parsed strings had removed
+    void writeEscaped(const char * text) {
+        if (text == NULL) {
+            return;
+        }
+        const char * start = text;
+        for(const char * c=text;*c != 0;c++) {
+            const char * escape = NULL;
+            char control[8];
+            if (*c == '"') {
+                escape = "\\\"";
+            } else if (*c == '\\') {
+                escape = "\\\\";
+            } else if (*c == '\n') {
+                escape = "\\n";
+            } else if (*c == '\r') {
+                escape = "\\r";
+            } else if (*c == '\t') {
+                escape = "\\t";
+            } else if ((uint8_t)*c < 0x20) {
+                snprintf(control,sizeof(control),"\\u%04x",*c);
+                escape = control;
+            }
+            if (escape != NULL) {
+                writeChars(start,c-start);
+                writeText(escape);
+                start = c+1;
+            }
+        }
+        writeText(start);
     }
-    
-        
 
+    void writeChars(const char * text, size_t len) {
+        while(len > 0 && !m_failed) {
+            if (m_pos == JSON_CHUNK_SIZE) {
+                flush();
+                continue;
+            }
+            size_t count = JSON_CHUNK_SIZE-m_pos;
+            if (count > len) {
+                count = len;
+            }
+            memcpy(m_chunk+m_pos,text,count);
+            m_pos += count;
+            text += count;
+            len -= count;
+        }
+    }
     
     void writeText(const char * text) {
         if (text == NULL) {
             return;
         }
-        size_t len = strlen(text);
-        if (len == 0) {
-            return;
+        writeChars(text,strlen(text));
+    }
+
+    // give the chunk to the sink
+    void flush() {
+        if (m_pos > 0 && !m_failed) {
+            m_failed = !m_sink->write(m_chunk,m_pos);
+            m_written += m_pos;
         }
-        m_logger->debug("writeText %d %d ~%.15s~",len,m_buf.getLength(),text);
-        char *pos = m_buf.increaseLength(len);
-        memcpy(pos,text,len);
-        pos[len] = 0;
-        m_logger->never("\tJSON: %d %.300s", m_buf.getLength(),m_buf.text());
+        m_pos = 0;
     }
 
     void writeString(const char * text) {
         writeText("\"");
-        writeText(text);
+        writeEscaped(text);
         writeText("\"");
     }
 
@@ -1017,9 +1365,13 @@ public:
 
 protected:
     char m_tmp[32];
-    DRString& m_buf;    
+    char m_chunk[JSON_CHUNK_SIZE];
+    IJsonSink* m_sink;
+    JsonStringSink m_stringSink;    // the sink for a DRString
     int m_depth;
-    size_t m_pos;
+    size_t m_pos;                   // bytes in m_chunk
+    size_t m_written;
+    bool m_failed;
     Logger * m_logger;
 };
 
@@ -1176,9 +1528,9 @@ class TokenParser {
             return m_pos-m_data+len;
         }
         int getCurrentLine(){
-            char * nl = strchr(m_data,'\n');
+            const char * nl = strchr(m_data,'\n');
             int p = 1;
-            while(nl > 0 && nl <= m_pos)  {
+            while(nl != NULL && nl <= m_pos)  {
                 nl = strchr(nl+1,'\n');
                 p++;
             }
@@ -1188,7 +1540,7 @@ class TokenParser {
         int getLineCount(){
             const char * nl = strchr(m_data,'\n');
             int p = 1;
-            while(nl > 0)  {
+            while(nl != NULL)  {
                 nl = strchr(nl+1,'\n');
                 p++;
             }
@@ -1242,7 +1594,21 @@ public:
     }
 
 
+    // strings in the root are copies.  data can change once this returns
     JsonRoot* read(const char * data) {
+        return parse(data,false);
+    }
+
+    /* strings in the root point into data instead of being copied; they are
+     * unescaped and terminated where they are, so data is changed.  data
+     * must not be changed or freed until the root is deleted.  LoadResult
+     * keeps the file buffer it reads in place for as long as its root.
+     */
+    JsonRoot* readInPlace(char * data) {
+        return parse(data,true);
+    }
+
+    JsonRoot* parse(const char * data, bool inPlace) {
         m_logger->debug("parsing %s",data);
         
         m_errorMessage = NULL;
@@ -1254,10 +1620,17 @@ public:
         if (data == NULL) {
             return root;
         }
+        if (inPlace) {
+            root->setSource((char*)data);
+        }
         
         TokenParser tokParser(data);
         m_logger->never("created TokenParser");
-        JsonElement * json = parseNext(tokParser);
+        JsonElement * json = NULL;
+        {
+            ArenaScope nodes(root->getArena(),&CurrentJsonArena);
+            json = parseNext(tokParser);
+        }
         if (json != NULL) {
             m_logger->never("got top");
             root->setTopElement(json);
@@ -1316,10 +1689,10 @@ public:
         if (elem == NULL) {
             DRString errLine = tok.getCurrentLineText();
             m_logger->error("Parse error:");
-            m_logger->error(errLine.get());
+            m_logger->error("%s",errLine.get());
             DRString pos('-',tok.getLinePos());
             pos += "^";
-            m_logger->error(pos.get());
+            m_logger->error("%s",pos.get());
         }
         return elem;
     }
@@ -1463,6 +1836,262 @@ public:
 
 };
 
+/* events from JsonEventParser, in document order.  strings are not copied;
+ * name and value point into the text being parsed and are not terminated,
+ * so a handler that keeps one must copy length characters.  a handler
+ * returns false to stop the parse.
+ */
+class IJsonEventHandler {
+    public:
+        virtual ~IJsonEventHandler() {}
+        virtual bool startObject()=0;
+        virtual bool endObject()=0;
+        virtual bool startArray()=0;
+        virtual bool endArray()=0;
+        // the name of the next value in an object
+        virtual bool key(const char * name, size_t length)=0;
+        virtual bool stringValue(const char * value, size_t length)=0;
+        virtual bool intValue(int value)=0;
+        virtual bool floatValue(double value)=0;
+        virtual bool boolValue(bool value)=0;
+        virtual bool nullValue()=0;
+};
+
+/* JsonEventParser reads the same JSON as JsonParser but calls an
+ * IJsonEventHandler for each token instead of building a JsonRoot, so a
+ * reader that converts the JSON to something else never holds the whole
+ * tree.
+ */
+class JsonEventParser : public ParseGen {
+public:
+    JsonEventParser() {
+        m_logger = &ParserLogger;
+        m_hasError = false;
+        m_handler = NULL;
+    }
+
+    bool read(const char * data, IJsonEventHandler* handler) {
+        m_hasError = false;
+        m_errorMessage = NULL;
+        m_handler = handler;
+        if (data == NULL || handler == NULL) {
+            return false;
+        }
+        TokenParser tokParser(data);
+        if (!parseNext(tokParser)) {
+            m_hasError = true;
+            m_errorMessage = "parse error";
+            m_errorLine = tokParser.getCurrentLineText();
+            m_errorLineNumber = tokParser.getCurrentLine();
+            m_errorCharacter = tokParser.getLinePos();
+            m_errorPosition = tokParser.getCurrentPos();
+        }
+        m_handler = NULL;
+        return !m_hasError;
+    }
+
+    bool hasError() { return m_hasError;}
+    const char * errorMessage() { return m_errorMessage.text();}
+    const char * errorLine() { return m_errorLine.text();}
+    int errorLineNumber() { return m_errorLineNumber;}
+    int errorCharacter() { return m_errorCharacter;}
+    int errorPosition() { return m_errorPosition;}
+
+private:
+    bool parseNext(TokenParser& tok) {
+        TokenType next = tok.peek();
+        if (next == TOK_OBJECT_START) {
+            return parseObject(tok);
+        } else if (next == TOK_ARRAY_START) {
+            return parseArray(tok);
+        } else if (next == TOK_STRING) {
+            const char * start;
+            size_t len;
+            return tok.nextString(start,len) && m_handler->stringValue(start,len);
+        } else if (next == TOK_INT) {
+            int val = 0;
+            return tok.nextInt(val) && m_handler->intValue(val);
+        } else if (next == TOK_FLOAT) {
+            double val = 0;
+            return tok.nextFloat(val) && m_handler->floatValue(val);
+        } else if (next == TOK_NULL) {
+            return skipToken(tok,TOK_NULL) && m_handler->nullValue();
+        } else if (next == TOK_TRUE) {
+            return skipToken(tok,TOK_TRUE) && m_handler->boolValue(true);
+        } else if (next == TOK_FALSE) {
+            return skipToken(tok,TOK_FALSE) && m_handler->boolValue(false);
+        }
+        DRString errLine = tok.getCurrentLineText();
+        m_logger->error("Parse error:");
+        m_logger->error("%s",errLine.get());
+        DRString pos('-',tok.getLinePos());
+        pos += "^";
+        m_logger->error("%s",pos.get());
+        return false;
+    }
+
+    bool skipToken(TokenParser&tok, TokenType type) {
+        TokenType next = tok.next();
+        if (next != type) {
+            m_logger->error("expected token type %d but got %d",(int)type,(int)next);
+            m_logger->error("\ttoken pos %.20s",tok.getTokPos());
+            return false;
+        }
+        return true;
+    }
+
+    bool parseObject(TokenParser& tok) {
+        if (!skipToken(tok,TOK_OBJECT_START) || !m_handler->startObject()) {
+            return false;
+        }
+        const char * nameStart;
+        size_t nameLen;
+        while(tok.nextString(nameStart,nameLen)){
+            if (!skipToken(tok,TOK_COLON) || !m_handler->key(nameStart,nameLen) || !parseNext(tok)) {
+                return false;
+            }
+            if (tok.peek() == TOK_COMMA) {
+                tok.next();
+            }
+        }
+        return skipToken(tok,TOK_OBJECT_END) && m_handler->endObject();
+    }
+
+    bool parseArray(TokenParser& tok) {
+        if (!skipToken(tok,TOK_ARRAY_START) || !m_handler->startArray()) {
+            return false;
+        }
+        while(tok.peek() != TOK_ARRAY_END) {
+            if (!parseNext(tok)) {
+                return false;
+            }
+            if (tok.peek() == TOK_COMMA) {
+                tok.next();
+            }
+        }
+        return skipToken(tok,TOK_ARRAY_END) && m_handler->endArray();
+    }
+
+    Logger * m_logger;
+    IJsonEventHandler* m_handler;
+    bool        m_hasError;
+    int m_errorLineNumber;
+    int m_errorCharacter;
+    int m_errorPosition;
+    DRString m_errorMessage;
+    DRString m_errorLine;
+};
+
+#define JSON_TREE_MAX_DEPTH 32
+
+/* JsonTreeBuilder turns events back into elements of a JsonRoot, in the
+ * root's arena.  a handler can pass it the events for one part of a
+ * document to get just that part as a tree.
+ */
+class JsonTreeBuilder : public IJsonEventHandler {
+    public:
+        JsonTreeBuilder(JsonRoot* root) {
+            m_root = root;
+            m_depth = 0;
+            m_key = NULL;
+            m_keyLength = 0;
+        }
+
+        // true when every object and array started has ended
+        bool isComplete() { return m_depth == 0 && m_root->getTopElement() != NULL;}
+
+        bool startObject() override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return push(new JsonObject(*m_root));
+        }
+
+        bool startArray() override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return push(new JsonArray(*m_root));
+        }
+
+        bool endObject() override { return pop();}
+        bool endArray() override { return pop();}
+
+        bool key(const char * name, size_t length) override {
+            m_key = name;
+            m_keyLength = length;
+            return true;
+        }
+
+        bool stringValue(const char * value, size_t length) override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return add(new JsonString(*m_root,value,length));
+        }
+        bool intValue(int value) override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return add(new JsonInt(*m_root,value));
+        }
+        bool floatValue(double value) override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return add(new JsonFloat(*m_root,value));
+        }
+        bool boolValue(bool value) override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return add(new JsonBool(*m_root,value));
+        }
+        bool nullValue() override {
+            ArenaScope nodes(m_root->getArena(),&CurrentJsonArena);
+            return add(new JsonNull(*m_root));
+        }
+
+    private:
+        bool add(JsonElement* value) {
+            if (m_depth == 0) {
+                if (m_root->getTopElement() != NULL) {
+                    delete value;
+                    return false;
+                }
+                m_root->setTopElement(value);
+                return true;
+            }
+            JsonElement* parent = m_stack[m_depth-1];
+            if (parent->isObject()) {
+                if (m_key == NULL) {
+                    delete value;
+                    return false;
+                }
+                parent->asObject()->set(m_key,m_keyLength,value);
+                m_key = NULL;
+            } else {
+                parent->asArray()->addItem(value);
+            }
+            return true;
+        }
+
+        bool push(JsonElement* container) {
+            if (m_depth == JSON_TREE_MAX_DEPTH) {
+                m_root->getLogger()->error("JSON is nested more than %d levels",JSON_TREE_MAX_DEPTH);
+                delete container;
+                return false;
+            }
+            if (!add(container)) {
+                return false;
+            }
+            m_stack[m_depth++] = container;
+            return true;
+        }
+
+        bool pop() {
+            if (m_depth == 0) {
+                return false;
+            }
+            m_depth--;
+            return true;
+        }
+
+        JsonRoot* m_root;
+        JsonElement* m_stack[JSON_TREE_MAX_DEPTH];
+        int m_depth;
+        const char * m_key;
+        size_t m_keyLength;
+};
+
 JsonObject* JsonRoot::createObject(){
     
     JsonObject* obj = new JsonObject(*this);
@@ -1553,30 +2182,22 @@ void MemLogger::freeString(const char * type,JsonBase* object){
 
 JsonArrayItem* JsonArray::add(const char * val) {
     JsonString * value = new JsonString(*getRoot(),val);
-    JsonArrayItem* item = new JsonArrayItem(m_root,value);
-    addItem(item);
-    return item;
+    return addItem(value);
 }
 
 JsonArrayItem* JsonArray::add(int val) {
     JsonInt * value = new JsonInt(*getRoot(),val);
-    JsonArrayItem* item = new JsonArrayItem(m_root,value);
-    addItem(item);
-    return item;
+    return addItem(value);
 }
 
 JsonArrayItem* JsonArray::add(double val) {
     JsonFloat * value = new JsonFloat(*getRoot(),val);
-    JsonArrayItem* item = new JsonArrayItem(m_root,value);
-    addItem(item);
-    return item;
+    return addItem(value);
 }
 
 JsonArrayItem* JsonArray::add(bool val) {
     JsonBool * value = new JsonBool(*getRoot(),val);
-    JsonArrayItem* item = new JsonArrayItem(m_root,value);
-    addItem(item);
-    return item;
+    return addItem(value);
 }
 
 bool JsonObject::get(const char *name,bool defaultValue){
@@ -0,0 +1,119 @@
+#ifndef DR_POOL_H
+#define DR_POOL_H
+
+#include <new>
+#include "./logger.h"
+
+namespace DevRelief {
+
+/* ObjectPool is a fixed number of slots for objects of one type that are
+ * created and destroyed while a script runs.  The slots are one allocation
+ * made the first time the pool is used, so objects are recycled without
+ * going through the heap.  When every slot is in use allocate() returns
+ * NULL and counts the miss in getExhausted(); callers fall back to the heap or skip the object.
+ *
+ *   void* memory = pool.allocate();
+ *   T* object = memory ? new (memory) T(...) : NULL;
+ *   ...
+ *   pool.release(object);      // runs ~T()
+ */
+template<class T>
+class ObjectPool {
+    public:
+        ObjectPool(int capacity=0) {
+            m_slots = NULL;
+            m_free = NULL;
+            m_capacity = capacity;
+            m_inUse = 0;
+            m_peak = 0;
+            m_allocated = 0;
+            m_exhausted = 0;
+        }
+
+        // objects in the pool must be released first
+        ~ObjectPool() {
+            free(m_slots);
+        }
+
+        // only changes an unused pool
+        void setCapacity(int capacity) {
+            if (m_inUse > 0 || capacity < 0) {
+                return;
+            }
+            free(m_slots);
+            m_slots = NULL;
+            m_free = NULL;
+            m_capacity = capacity;
+        }
+
+        // memory for one T.  NULL if every slot is in use
+        void* allocate() {
+            if (m_slots == NULL && m_capacity > 0) {
+                reserve();
+            }
+            PoolSlot* slot = m_free;
+            if (slot == NULL) {
+                m_exhausted++;
+                return NULL;
+            }
+            m_free = slot->next;
+            m_inUse++;
+            m_allocated++;
+            if (m_inUse > m_peak) {
+                m_peak = m_inUse;
+            }
+            return slot;
+        }
+
+        // destroy an object from allocate() and reuse its slot
+        void release(T* object) {
+            if (object == NULL) {
+                return;
+            }
+            object->~T();
+            PoolSlot* slot = (PoolSlot*)(void*)object;
+            slot->next = m_free;
+            m_free = slot;
+            m_inUse--;
+        }
+
+        bool owns(const void* ptr) {
+            return m_slots != NULL && ptr >= (void*)m_slots && ptr < (void*)(m_slots+m_capacity);
+        }
+
+        int getCapacity() { return m_capacity;}
+        int getInUse() { return m_inUse;}
+        int getPeak() { return m_peak;}
+        // objects created since the pool was created
+        uint32_t getAllocated() { return m_allocated;}
+        // allocate() calls that found every slot in use
+        uint32_t getExhausted() { return m_exhausted;}
+
+    private:
+        union PoolSlot {
+            PoolSlot* next;
+            alignas(T) char object[sizeof(T)];
+        };
+
+        void reserve() {
+            m_slots = (PoolSlot*)malloc(m_capacity*sizeof(PoolSlot));
+            if (m_slots == NULL) {
+                return;
+            }
+            for(int i=m_capacity-1;i>=0;i--) {
+                m_slots[i].next = m_free;
+                m_free = m_slots+i;
+            }
+        }
+
+        PoolSlot* m_slots;
+        PoolSlot* m_free;
+        int m_capacity;
+        int m_inUse;
+        int m_peak;
+        uint32_t m_allocated;
+        uint32_t m_exhausted;
+};
+
+}
+#endif
@@ -8,7 +8,7 @@ namespace DevRelief
 {
     Logger AnimationLogger("Animation", ANIMATION_LOGGER_LEVEL);
 
-  class AnimationRange
+  class AnimationRange : public ArenaObject
     {
     public:
         AnimationRange(double low, double high, bool unfold=false)
@@ -17,7 +17,7 @@ namespace DevRelief
             m_high = high;
             m_unfold = unfold;
             m_logger = &AnimationLogger;
-            m_logger->debug("create AnimationRange %f-%f  %s",low,high,unfold?"unfold":"");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"create AnimationRange %f-%f  %s",low,high,unfold?"unfold":"");
             m_lastPosition = 99999999;
             m_lastValue = 0;
         }
@@ -25,7 +25,7 @@ namespace DevRelief
         double getValue(double position)
         {
             if (position == m_lastPosition) { return m_lastValue;}
-            m_logger->never("AnimationRange.getValue(%f)  %f-%f",position,m_low,m_high);
+            DRLOG_NEVER("AnimationRange.getValue(%f)  %f-%f",position,m_low,m_high);
             if (m_unfold) {
                 if (position<=0.5) {
                     position=position*2;
@@ -35,18 +35,18 @@ namespace DevRelief
             }
             if (position <= 0 || m_high == m_low)
             {
-                m_logger->never("\t return low %f",position,m_low);
+                DRLOG_NEVER("\t return low %f",position,m_low);
 
                 return m_low;
             }
             if (position >= 1)
             {
-                m_logger->never("\treturn high %f",position,m_high);
+                DRLOG_NEVER("\treturn high %f",position,m_high);
                 return m_high;
             }
             double diff = m_high - m_low;
             double value = m_low + position * diff;
-            m_logger->never("\t %f  %f %f-%f",value,diff,m_low,m_high);
+            DRLOG_NEVER("\t %f  %f %f-%f",value,diff,m_low,m_high);
             m_lastPosition = position;
             m_lastValue = value;
             return value;
@@ -67,14 +67,14 @@ namespace DevRelief
     };
 
 
-    class AnimationDomain
+    class AnimationDomain : public ArenaObject
     {
     public:
         AnimationDomain()
         {
             m_logger = &AnimationLogger;
             m_changed = true;
-            m_logger->never("create AnimationDomain");
+            DRLOG_NEVER("create AnimationDomain");
         }
 
         // update based on current state if implementation needs to
@@ -86,29 +86,29 @@ namespace DevRelief
          */
         double getPosition()
         {
-            m_logger->never("AnimationDomain.getPosition");
+            DRLOG_NEVER("AnimationDomain.getPosition");
             if (!m_changed) { 
-                m_logger->never("\tno change");
+                DRLOG_NEVER("\tno change");
                 return m_lastValue;
             }
-            m_logger->debug("getPosition()");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"getPosition()");
             double value = getValue();
             double low = getMin();
             double high = getMax();
 
             if (value <= low)
             {
-                m_logger->never("\t low %f<%f",value,low);
+                DRLOG_NEVER("\t low %f<%f",value,low);
                 return 0;
             }
             if (value >= high)
             {
-                m_logger->never("\thigh %f>%f",value,high);
+                DRLOG_NEVER("\thigh %f>%f",value,high);
                 return 1;
             }
             double diff = high - low;
             double pct = diff == 0 ? 1 : (value - low) / (diff);
-            m_logger->never("\thigh=%f low=%f diff=%f value=%f pos=%f",high,low,diff,value,pct);
+            DRLOG_NEVER("\thigh=%f low=%f diff=%f value=%f pos=%f",high,low,diff,value,pct);
             m_changed = false;
             m_lastValue = pct;
             return pct;
@@ -148,7 +148,7 @@ namespace DevRelief
 
         void update(IScriptState* state) override {
             if (m_lastStep == state->getStepNumber()) {
-                m_logger->never("time domain no change %d",m_lastStep);
+                DRLOG_NEVER("time domain no change %d",m_lastStep);
 
                 return;
             }
@@ -160,14 +160,14 @@ namespace DevRelief
                 m_min = m_startMillis;
                 m_max = m_startMillis;
                 m_val  = m_startMillis;
-                m_logger->never("time domain duration==0");
+                DRLOG_NEVER("time domain duration==0");
 
             } else {
                 int diff = m_val - m_startMillis;
                 m_repeat = diff / m_durationMmsecs;
                 m_min = m_startMillis + m_repeat*m_durationMmsecs;
                 m_max = m_min + m_durationMmsecs;
-                m_logger->never("time domain %d %d %d %d %d",m_val,m_startMillis,m_min,m_max,m_lastStep);
+                DRLOG_NEVER("time domain %d %d %d %d %d",m_val,m_startMillis,m_min,m_max,m_lastStep);
             }
         }
 
@@ -266,7 +266,7 @@ namespace DevRelief
 
     
 
-    class AnimationEase
+    class AnimationEase : public ArenaObject
     {
     public:
         AnimationEase() {
@@ -283,7 +283,7 @@ namespace DevRelief
     public:
         double calculate(double position)
         {
-            m_logger->debug("Linear ease %f",position);
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"Linear ease %f",position);
             return position;
         }
     };
@@ -324,7 +324,7 @@ namespace DevRelief
         Animator(AnimationDomain &domain, AnimationEase *ease = &DefaultEase) : m_domain(domain), m_ease(ease)
         {
             m_logger = &AnimationLogger;
-            m_logger->debug("create Animator()");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"create Animator()");
         }
 
         double get(AnimationRange &range, IScriptCommand* cmd)
@@ -332,13 +332,13 @@ namespace DevRelief
             if (m_ease == NULL) {
                 m_ease = &DefaultEase;
             }
-            m_logger->debug("Animator.get()");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"Animator.get()");
             m_domain.update(cmd->getState());
             double position = m_domain.getPosition();
             double ease = m_ease->calculate(position);
-            //m_logger->debug("\tpos %f.  ease %f",position,ease);
+            //DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tpos %f.  ease %f",position,ease);
             double result = range.getValue(ease);
-            m_logger->never("\tpos %f.  ease %f. result %f.  ",result);
+            DRLOG_NEVER("\tpos %f.  ease %f. result %f.  ",result);
             return result;
         };
 
@@ -404,33 +404,33 @@ namespace DevRelief
 
      
         double get(IScriptCommand*cmd, AnimationRange&range) override {
-            m_logger->debug("ValueAnimator.get() 0x%04X",cmd);
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"ValueAnimator.get() 0x%04X",cmd);
 
 
-            m_logger->debug("\tcheck paused");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tcheck paused");
 
-            m_logger->debug("\tget domain");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tget domain");
             AnimationDomain* domain = getDomain(cmd,range);
-            m_logger->debug("\tset ease");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tset ease");
             setEaseParameters(cmd);
             if (domain == NULL) {
                 m_logger->error("Animation domain is NULL");
                 return range.getHigh();
             }
-            m_logger->debug("\tcreate animator");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tcreate animator");
 
             Animator animator(*domain,m_selectedEase);
-            m_logger->debug("\tset unfold");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tset unfold");
             range.setUnfolded(isUnfolded(cmd));
-            m_logger->debug("\tget value");
+            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tget value");
 
             if (isPaused(cmd,range)) {
-                m_logger->debug("\treturn pause value");
+                DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\treturn pause value");
                 return getPauseValue(cmd,range);
             }
             double value = animator.get(range,cmd);
             m_lastValue = value;
-            m_logger->never("ValueAnimator value=%f",value);
+            DRLOG_NEVER("ValueAnimator value=%f",value);
 
             return value;
           
@@ -438,6 +438,13 @@ namespace DevRelief
 
         virtual AnimationDomain* getDomain(IScriptCommand*cmd,AnimationRange&range) =0;
 
+        ScriptValueScope getScope(IScriptCommand*cmd) override {
+            ScriptValueScope scope = combineScope(SCOPE_CONSTANT,m_unfoldValue,cmd);
+            scope = combineScope(scope,m_ease,cmd);
+            scope = combineScope(scope,m_easeIn,cmd);
+            return combineScope(scope,m_easeOut,cmd);
+        }
+
         void setEaseParameters(IScriptCommand* cmd) {
             double in = 1;
             double out = 1;
@@ -450,34 +457,34 @@ namespace DevRelief
             if (m_ease) {
                 in = 1-m_ease->getFloatValue(cmd,1);
                 out = 1-in;
-                m_logger->never("got ease %x %f %f",this,in,out);
+                DRLOG_NEVER("got ease %x %f %f",this,in,out);
             }
             if (m_easeIn) {
                 in = 1-m_easeIn->getFloatValue(cmd,0.123);
-                m_logger->never("got ease-in %x %f",this,in);
+                DRLOG_NEVER("got ease-in %x %f",this,in);
 
             }
 
             if (m_easeOut) {
                 out = m_easeOut->getFloatValue(cmd,0);
-                m_logger->never("got ease-out %x %f",this,out);
+                DRLOG_NEVER("got ease-out %x %f",this,out);
             }
-            m_logger->never("ease in/out  %f/%f",in,out);
+            DRLOG_NEVER("ease in/out  %f/%f",in,out);
             m_cubicBeszierEase.setValues(in,out);
         }
 
 
         void setEase(IScriptValue* ease) { 
-            m_logger->never("ease %x %x %s",this,ease, (ease ? ease->toString().text():""));
+            DRLOG_NEVER("ease %x %x %s",this,ease, (ease ? ease->toString().text():""));
             m_ease = ease;
         }
 
         void setEaseIn(IScriptValue* ease) {
-            m_logger->never("ease-in %x %x %s",this,ease, (ease ? ease->toString().text():""));
+            DRLOG_NEVER("ease-in %x %x %s",this,ease, (ease ? ease->toString().text():""));
             m_easeIn = ease;
         }
         void setEaseOut(IScriptValue* ease) {
-            m_logger->never("ease-out %x %x %s",this,ease, (ease ? ease->toString().text():""));
+            DRLOG_NEVER("ease-out %x %x %s",this,ease, (ease ? ease->toString().text():""));
             m_easeOut = ease;
         }
 
@@ -538,25 +545,36 @@ namespace DevRelief
                 m_delayResponseValue = delayResponse;
             }
 
+            // time animations change once per step.  the repeat/delay state is also
+            // meant to advance once per step
+            ScriptValueScope getScope(IScriptCommand*cmd) override {
+                ScriptValueScope scope = combineScope(SCOPE_FRAME,m_repeatValue,cmd);
+                scope = combineScope(scope,m_delayValue,cmd);
+                scope = combineScope(scope,m_delayResponseValue,cmd);
+                if (scope == SCOPE_LED) { return scope;}
+                ScriptValueScope base = ValueAnimator::getScope(cmd);
+                return base > scope ? base : scope;
+            }
+
         protected: 
             bool isPaused(IScriptCommand* cmd, AnimationRange&range) override  { 
                 m_timeDomain.update(cmd->getState());
-                m_logger->debug("check repeat count");
+                DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"check repeat count");
                 if (m_timeDomain.getRepeatCount()==0) {
-                    m_logger->debug("\tno repeat");
+                    DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tno repeat");
                     return false;
                 };
-                m_logger->debug("\tgot repeat",m_timeDomain.getRepeatCount());
+                DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tgot repeat",m_timeDomain.getRepeatCount());
                 if (m_delayUntil == 0) {
-                    m_logger->debug("\tincrement iteration %d",m_iterationCount);
+                    DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tincrement iteration %d",m_iterationCount);
                     
                     m_iterationCount += 1;
                     if (m_repeatValue) {
-                        m_logger->debug("\tcheck max repeat");
+                        DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\tcheck max repeat");
 
                         int maxRepeat = m_repeatValue->getIntValue(cmd,1);
                         if (m_iterationCount>= maxRepeat) {
-                            m_logger->debug("\treached max");
+                            DRLOG_DEBUG(ANIMATION_LOGGER_LEVEL,m_logger,"\treached max");
                             m_isComplete = true;
                             cmd->onAnimationComplete(this);
                             return true;
@@ -585,10 +603,10 @@ namespace DevRelief
             double getPauseValue(IScriptCommand* cmd, AnimationRange&range) override {
                 if (m_delayResponseValue != NULL) {
                     double val = m_delayResponseValue->getFloatValue(cmd,m_lastValue);
-                    m_logger->never("return response value %f (high=%f)",val,range.getHigh());
+                    DRLOG_NEVER("return response value %f (high=%f)",val,range.getHigh());
                     return val;
                 }
-                m_logger->never("return high value %f",range.getHigh());
+                DRLOG_NEVER("return high value %f",range.getHigh());
                 return range.getUnfold() ? range.getLow() :  range.getHigh();
             }
 
@@ -623,6 +641,10 @@ namespace DevRelief
             }
 
             void setSpeed(IScriptValue* speed) { m_speedValue = speed;}
+
+            ScriptValueScope getScope(IScriptCommand*cmd) override {
+                return combineScope(TimeValueAnimator::getScope(cmd),m_speedValue,cmd);
+            }
             
             IValueAnimator* clone(IScriptCommand* cmd) {
                 SpeedValueAnimator* other = new SpeedValueAnimator(this,cmd); //m_speedValue->eval(cmd,0));
@@ -656,10 +678,14 @@ namespace DevRelief
 
             void setDuration(IScriptValue* duration) { m_durationValue = duration;}
 
+            ScriptValueScope getScope(IScriptCommand*cmd) override {
+                return combineScope(TimeValueAnimator::getScope(cmd),m_durationValue,cmd);
+            }
+
             IValueAnimator* clone(IScriptCommand* cmd) {
-                m_logger->never("clone duration %f",m_durationValue->getFloatValue(cmd,-2));
+                DRLOG_NEVER("clone duration %f",m_durationValue->getFloatValue(cmd,-2));
                 DurationValueAnimator* other = new DurationValueAnimator(this,cmd); //m_speedValue->eval(cmd,0));
-                m_logger->never("\tcloned duration %f",other->m_durationValue->getFloatValue(cmd,-2));
+                DRLOG_NEVER("\tcloned duration %f",other->m_durationValue->getFloatValue(cmd,-2));
                 return other;
             }
 
@@ -687,6 +713,8 @@ namespace DevRelief
                 return new PositionValueAnimator();
             }
 
+            ScriptValueScope getScope(IScriptCommand*cmd) override { return SCOPE_LED;}
+
         private: 
 
     };
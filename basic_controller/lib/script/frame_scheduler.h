@@ -0,0 +1,148 @@
+#ifndef DRFRAME_SCHEDULER_H
+#define DRFRAME_SCHEDULER_H
+
+#include "../logger.h"
+#include "../parse_gen.h"
+
+namespace DevRelief
+{
+    Logger FrameSchedulerLogger("FrameScheduler", SCRIPT_LOGGER_LEVEL);
+
+    // longest frame period is the script frequency times this
+    #define FRAME_SCHEDULER_MAX_DIVISOR 8
+    // consecutive frames longer than the frame period before the frame rate is halved
+    #define FRAME_SCHEDULER_SLOW_FRAMES 3
+    // consecutive frames that would fit at twice the rate before it is doubled again
+    #define FRAME_SCHEDULER_FAST_FRAMES 30
+
+    /* FrameScheduler decides when Script::step() draws a frame.  Frames are
+     * due on a fixed grid of absolute deadlines (start + n*period) so the
+     * time loop() or the HTTP server takes does not add up as drift.  A
+     * frame that starts more than a period late drops the deadlines it
+     * missed instead of running frames back to back to catch up.
+     *
+     * When frames keep taking longer than the frame period the period
+     * is doubled (up to FRAME_SCHEDULER_MAX_DIVISOR times the frequency) so
+     * the LEDs update less often instead of stalling the loop.  It goes back
+     * down once frames are cheap again.  Every command is slowed the same
+     * amount since the strip is redrawn from scratch each frame.
+     *
+     * All times are millis().
+     */
+    class FrameScheduler {
+        public:
+            FrameScheduler() {
+                m_logger = &FrameSchedulerLogger;
+                reset();
+            }
+
+            void reset() {
+                m_started = false;
+                m_nextDeadline = 0;
+                m_frameStart = 0;
+                m_divisor = 1;
+                m_slowFrames = 0;
+                m_fastFrames = 0;
+                m_onTime = 0;
+                m_late = 0;
+                m_dropped = 0;
+                m_skipped = 0;
+            }
+
+            // a frequency of 0 runs a frame every time
+            bool isDue(unsigned long now, int frequencyMSecs) {
+                return !m_started || frequencyMSecs <= 0 || (long)(now - m_nextDeadline) >= 0;
+            }
+
+            // call when a due frame starts.  moves the deadline to the next frame
+            void beginFrame(unsigned long now, int frequencyMSecs) {
+                m_frameStart = now;
+                if (frequencyMSecs <= 0) {
+                    m_started = true;
+                    m_nextDeadline = now;
+                    m_onTime++;
+                    return;
+                }
+                unsigned long period = getPeriod(frequencyMSecs);
+                if (!m_started) {
+                    m_started = true;
+                    m_nextDeadline = now;
+                }
+                unsigned long late = now - m_nextDeadline;
+                if (late >= period) {
+                    unsigned long missed = late/period;
+                    m_dropped += missed;
+                    m_nextDeadline += missed*period;
+                    late -= missed*period;
+                }
+                // a quarter of a frame late is still on time
+                if (late*4 > (unsigned long)frequencyMSecs) {
+                    m_late++;
+                } else {
+                    m_onTime++;
+                }
+                m_skipped += m_divisor-1;
+                m_nextDeadline += period;
+            }
+
+            // call when the frame is shown.  adjusts the frame rate to the frame's cost
+            void endFrame(unsigned long now, int frequencyMSecs) {
+                if (frequencyMSecs <= 0) {
+                    return;
+                }
+                unsigned long cost = now - m_frameStart;
+                unsigned long frequency = frequencyMSecs;
+                if (cost > getPeriod(frequencyMSecs)) {
+                    m_fastFrames = 0;
+                    if (++m_slowFrames >= FRAME_SCHEDULER_SLOW_FRAMES && m_divisor < FRAME_SCHEDULER_MAX_DIVISOR) {
+                        m_divisor *= 2;
+                        m_slowFrames = 0;
+                        m_logger->warn("frames take %dms.  updating every %dms",(int)cost,(int)(frequency*m_divisor));
+                    }
+                } else if (m_divisor > 1 && cost <= frequency*(m_divisor/2)) {
+                    m_slowFrames = 0;
+                    if (++m_fastFrames >= FRAME_SCHEDULER_FAST_FRAMES) {
+                        m_divisor /= 2;
+                        m_fastFrames = 0;
+                        m_logger->info("updating every %dms",(int)(frequency*m_divisor));
+                    }
+                } else {
+                    m_slowFrames = 0;
+                    m_fastFrames = 0;
+                }
+            }
+
+            unsigned long getPeriod(int frequencyMSecs) {
+                return (frequencyMSecs < 0 ? 0 : frequencyMSecs)*m_divisor;
+            }
+
+            unsigned long getNextDeadline() { return m_nextDeadline;}
+            int getDivisor() { return m_divisor;}
+            uint32_t getOnTime() { return m_onTime;}
+            uint32_t getLate() { return m_late;}
+            uint32_t getDropped() { return m_dropped;}
+            uint32_t getSkipped() { return m_skipped;}
+
+            void toJson(JsonObject* json) {
+                json->set("onTime",(int)m_onTime);
+                json->set("late",(int)m_late);
+                json->set("dropped",(int)m_dropped);
+                json->set("skipped",(int)m_skipped);
+                json->set("divisor",m_divisor);
+            }
+
+        private:
+            Logger* m_logger;
+            bool m_started;
+            unsigned long m_nextDeadline;
+            unsigned long m_frameStart;
+            int m_divisor;
+            int m_slowFrames;
+            int m_fastFrames;
+            uint32_t m_onTime;
+            uint32_t m_late;
+            uint32_t m_dropped;     // deadlines missed because a frame started a period or more late
+            uint32_t m_skipped;     // frames left out by the reduced frame rate
+    };
+}
+#endif
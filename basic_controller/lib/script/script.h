@@ -1,20 +1,21 @@
 #ifndef DRSCRIPT_H
 #define DRSCRIPT_H
 
-#include "../parse_gen.h";
-#include "../logger.h";
-#include "../led_strip.h";
-#include "../config.h";
-#include "../standard.h";
-#include "../list.h";
-#include "../led_strip.h";
+#include "../parse_gen.h"
+#include "../logger.h"
+#include "../led_strip.h"
+#include "../config.h"
+#include "../standard.h"
+#include "../list.h"
+#include "../led_strip.h"
 #include "./script_interface.h"
 #include "./script_value.h"
 #include "./script_position.h"
 #include "./script_state.h"
 #include "./script_command.h"
 #include "./script_container.h"
-#include "./animation.h";
+#include "./animation.h"
+#include "./frame_scheduler.h"
 
 namespace DevRelief
 {
@@ -44,60 +45,80 @@ namespace DevRelief
 
 
         void begin(IHSLStrip * ledStrip, JsonObject* params) override {
-            m_logger->never("begin Script.  frequency %d",m_frequencyMSecs);
+            DRLOG_NEVER("begin Script.  frequency %d",m_frequencyMSecs);
             delete m_state;
-            m_state = new ScriptState();
+            m_state = new ScriptState(&m_symbols);
             if (params) {
                 params->eachProperty([&](const char * name, JsonElement*value){
                     m_state->setValue(name,new ScriptStringValue(value->getString()));
                 });
             }
-            m_logger->never("\tset strip 0x%04X",ledStrip);
+            DRLOG_NEVER("\tset strip 0x%04X",ledStrip);
             m_rootContainer->setStrip(ledStrip);
-            m_logger->never("\tm_state->beginScript");
+            DRLOG_NEVER("\tm_state->beginScript");
             m_state->beginScript(this,ledStrip);
+            m_scheduler.reset();
+#if SCRIPT_PROFILE==1
+            ScriptProfile.reset();
+#endif
 
         }
 
         void step() override
         {
-            int ms = m_state->msecsSinceLastStep();
-            m_logger->never("frequency %d %d",m_frequencyMSecs,ms);
-            if (m_frequencyMSecs > m_state->msecsSinceLastStep())
-            {   m_logger->never("frequency too soon");
+            unsigned long now = millis();
+            if (!m_scheduler.isDue(now,m_frequencyMSecs))
+            {   DRLOG_NEVER("frequency too soon");
                  return;
             }
-            m_logger->never("Script step");
+            m_scheduler.beginFrame(now,m_frequencyMSecs);
+            DRLOG_NEVER("Script step");
 
             IHSLStrip * strip = m_state->getStrip();
-            m_logger->never("strip 0x%04X",strip);
-
-            int startMs = millis();
+            DRLOG_NEVER("strip 0x%04X",strip);
 
+            unsigned long start = micros();
             strip->clear();
-            m_logger->never("cleared");
+            DRLOG_NEVER("cleared");
+            unsigned long cleared = micros();
             m_state->beginStep();
-            m_logger->never("began");
-            m_logger->never("root container 0x%04X",m_rootContainer);
+            DRLOG_NEVER("began");
+            DRLOG_NEVER("root container 0x%04X",m_rootContainer);
             m_rootContainer->execute(m_state);
-            m_logger->never("executed");
+            DRLOG_NEVER("executed");
             m_state->endStep();
-            m_logger->never("ended");
+            DRLOG_NEVER("ended");
+            unsigned long executed = micros();
             strip->show();
-            m_logger->never("done %d",millis()-startMs);
+            DRLOG_NEVER("done %d",micros()-start);
+            m_scheduler.endFrame(millis(),m_frequencyMSecs);
+#if SCRIPT_PROFILE==1
+            ScriptProfile.addStep(cleared-start,executed-cleared,micros()-executed,m_frequencyMSecs);
+#endif
         }
 
+        // lower LED commands to ScriptPrograms.  called by the loader after all commands are added
+        void compile() { m_rootContainer->compile(); }
+
         void setName(const char *name) { m_name = name; }
         const char *getName() { return m_name.text(); }
         void setFrequencyMSec(int msecs) { m_frequencyMSecs = msecs; }
         int getFrequencyMSec() { return m_frequencyMSecs; }
         ScriptRootContainer* getContainer() { return m_rootContainer;}
+        ScriptSymbolTable* getSymbols() { return &m_symbols;}
+        FrameScheduler* getScheduler() { return &m_scheduler;}
+        // ScriptDataLoader builds the script in it
+        Arena* getArena() { return &m_arena;}
     private:
+        // first so it is released after every member that may be in it
+        Arena m_arena;
         Logger *m_logger;
         ScriptRootContainer* m_rootContainer;
         DRString m_name;
         int m_frequencyMSecs;
         ScriptState* m_state;
+        ScriptSymbolTable m_symbols;
+        FrameScheduler m_scheduler;
     };
 
    
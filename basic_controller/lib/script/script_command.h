@@ -1,15 +1,17 @@
 #ifndef DRSCRIPT_COMMAND_H
 #define DRSCRIPT_COMMAND_H
 
-#include "../parse_gen.h";
-#include "../logger.h";
-#include "../led_strip.h";
-#include "../config.h";
-#include "../ensure.h";
-#include "../list.h";
-#include "../led_strip.h";
-#include "./script_interface.h";
-#include "./animation.h";
+#include "../parse_gen.h"
+#include "../logger.h"
+#include "../led_strip.h"
+#include "../config.h"
+#include "../ensure.h"
+#include "../list.h"
+#include "../led_strip.h"
+#include "./script_interface.h"
+#include "./animation.h"
+#include "./script_program.h"
+#include "./script_profile.h"
 
 namespace DevRelief
 {
@@ -24,8 +26,10 @@ namespace DevRelief
             m_type = type;
             m_values = NULL;
             m_position = NULL;
-            m_logger->debug("Create command %s",type);
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"Create command %s",type);
             m_status = SCRIPT_RUNNING;
+            m_profileSlot = -1;
+            m_profileGeneration = 0;
         }
 
         virtual ~ScriptCommandBase()
@@ -53,51 +57,58 @@ namespace DevRelief
         }
 
         ScriptPosition* getPosition() override { 
-            m_logger->never("base getPosition 0x%x",this);
+            DRLOG_NEVER("base getPosition 0x%x",this);
             if (m_position) {
-                m_logger->never("\t 0x%x",m_position);
+                DRLOG_NEVER("\t 0x%x",m_position);
                 return m_position;
             } else {
-                m_logger->never("\tgetContainer");
+                DRLOG_NEVER("\tgetContainer");
                 IScriptCommand* container = m_state->getContainer();
                 if (container) {
-                    m_logger->debug("\tget container position %x",container);
+                    DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tget container position %x",container);
                     return container->getPosition();
                 }
-                m_logger->debug("\tno container");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tno container");
                 return NULL;
             }
         }
         
         PositionDomain* getAnimationPositionDomain() override {
             ScriptPosition* strip = getPosition();
-            m_logger->never("getAnimationPositionDomain from strip 0x%04X",strip);
+            DRLOG_NEVER("getAnimationPositionDomain from strip 0x%04X",strip);
             return strip->getAnimationPositionDomain();
 
         }
 
         ScriptStatus execute(IScriptState *state) override
         {
-            m_logger->never("ScriptCommandBase.execute %s 0x%x",getType(),this);
+            DRLOG_NEVER("ScriptCommandBase.execute %s 0x%x",getType(),this);
             if (m_status != SCRIPT_RUNNING) {
                 return m_status;
             }
             m_state = state;
-             m_logger->never("get previous");
+             DRLOG_NEVER("get previous");
             m_previousCommand = state->getPreviousCommand();
             if (m_position) {
-                m_logger->never("update position");
+                DRLOG_NEVER("update position");
                 m_position->updateValues(this,state);
             } else {
-                m_logger->never("no position");
+                DRLOG_NEVER("no position");
             }
-            m_logger->never("setCurrentCommand");
+            DRLOG_NEVER("setCurrentCommand");
             state->setCurrentCommand(this);
-            m_logger->never("doCommand");
+            DRLOG_NEVER("doCommand");
+#if SCRIPT_PROFILE==1
+            ScriptProfile.beginCommand(m_profileSlot,m_profileGeneration,getType());
+            unsigned long start = micros();
+#endif
             beginCommandStep(state);
             doCommand(state);
             endCommandStep(state);
-            m_logger->never("done %d",state);
+#if SCRIPT_PROFILE==1
+            ScriptProfile.addCommand(m_profileSlot,micros()-start);
+#endif
+            DRLOG_NEVER("done %d",state);
             return m_status;
         }
 
@@ -106,15 +117,15 @@ namespace DevRelief
         
 
         /* Value methods */
-        virtual void addValue(const char *name, IScriptValue *value) 
+        virtual void addValue(const char *name, IScriptValue *value, int symbol=NO_SCRIPT_SYMBOL) 
         {
-            m_logger->debug("ScriptCommandBase.addValue %s 0x%04x",name,value);
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptCommandBase.addValue %s 0x%04x",name,value);
             if (m_values == NULL) {
-                m_logger->never("\tcreate ScriptValueList");
+                DRLOG_NEVER("\tcreate ScriptValueList");
                 m_values = new ScriptValueList();
             }
-            m_values->addValue(name, value);
-            m_logger->never("added NameValue");
+            m_values->addValue(name, value, symbol);
+            DRLOG_NEVER("added NameValue");
         }
 
 
@@ -128,25 +139,42 @@ namespace DevRelief
 
         IScriptValue *getValue(const char *name) override
         {
-            m_logger->never("getvalue %s",name);
+            DRLOG_NEVER("getvalue %s",name);
             IScriptValue* val =  m_values == NULL ? NULL : m_values->getValue(name);
             if (val && !val->isRecursing()) {
                 return val;
             }
-            m_logger->never("getvalue from state %s",name);
+            DRLOG_NEVER("getvalue from state %s",name);
             IScriptValue * stateValue = m_state->getValue(name);
             if (stateValue) {
                 return stateValue;
             }
 
-            m_logger->never("\tnot found in state");
+            DRLOG_NEVER("\tnot found in state");
             if ((val == NULL||val->isRecursing()) && m_previousCommand != NULL) {
-                m_logger->never("\tcheck previous %x",m_previousCommand);
+                DRLOG_NEVER("\tcheck previous %x",m_previousCommand);
                 return m_previousCommand->getValue(name);
             }
             return val;
         }
 
+        // same resolution order as getValue(name) with slot lookups at each step
+        IScriptValue *getSymbolValue(int symbol) override
+        {
+            IScriptValue* val =  m_values == NULL ? NULL : m_values->getSymbolValue(symbol);
+            if (val && !val->isRecursing()) {
+                return val;
+            }
+            IScriptValue * stateValue = m_state->getSymbolValue(symbol);
+            if (stateValue) {
+                return stateValue;
+            }
+            if ((val == NULL||val->isRecursing()) && m_previousCommand != NULL) {
+                return m_previousCommand->getSymbolValue(symbol);
+            }
+            return val;
+        }
+
         int getIntValue(const char * name,int defaultValue) {
             IScriptValue* sv = m_state->getValue(name);
             if (sv == NULL) {
@@ -166,6 +194,8 @@ namespace DevRelief
             m_status = SCRIPT_COMPLETE;
         }
 
+        void compile() override {}
+
         IScriptState* getState() { return m_state;}
         ScriptStatus getStatus() override { return m_status;}
 
@@ -185,6 +215,8 @@ namespace DevRelief
         DRString m_type;
         IScriptState* m_state;
         ScriptStatus m_status;
+        int16_t m_profileSlot;
+        uint16_t m_profileGeneration;
     };
 
   
@@ -259,42 +291,66 @@ namespace DevRelief
         {
             memLogger->debug("LEDCommand()");
             m_operation = REPLACE;
+            m_program = NULL;
         }
 
         virtual ~LEDCommand()
         {
             memLogger->debug("~LEDCommand() ");
+            if (m_program) { m_program->destroy();}
+        }
+
+        void compile() override {
+            if (m_program) { m_program->destroy();}
+            m_program = new ScriptProgram();
+            compileProgram(m_program);
+            m_program->finish();
+            if (!m_program->isValid()) {
+                m_logger->error("cannot compile %s.  values will be evaluated each LED",getType());
+                m_program->destroy();
+                m_program = NULL;
+            }
         }
 
         ScriptStatus doCommand(IScriptState* state) override
         {
-            m_logger->never("LEDCommand");
+            DRLOG_NEVER("LEDCommand");
             
             auto *position = getPosition();
-            m_logger->never("got position");
+            DRLOG_NEVER("got position");
             int count = position->getCount();
             if (count == 0)
             {
-                m_logger->never( "strip has 0 LEDS");
+                DRLOG_NEVER( "strip has 0 LEDS");
                 return SCRIPT_ERROR;
             }
-            m_logger->never("LEDCommand count=%d",count);
+            DRLOG_NEVER("LEDCommand count=%d",count);
             auto* positionDomain = position->getAnimationPositionDomain();
-            m_logger->never("\tgot position domain %d",count);
+            DRLOG_NEVER("\tgot position domain %d",count);
+
+            if (m_program) {
+                m_program->beginFrame(this);
+                for (int i = 0; i < count; i++)
+                {
+                    position->setPositionIndex(i);
+                    m_program->run(this,position,positionDomain,i,m_operation);
+                }
+                return SCRIPT_RUNNING;
+            }
 
             for (int i = 0; i < count; i++)
             {
-                m_logger->never("\tLED %d",i);
+                DRLOG_NEVER("\tLED %d",i);
                 position->setPositionIndex(i); 
-                m_logger->never("\tposition set %d",i);   
+                DRLOG_NEVER("\tposition set %d",i);   
                 updateLED(i,position);
-                m_logger->never("\tupdated");
+                DRLOG_NEVER("\tupdated");
             }
             return SCRIPT_RUNNING;
         }
 
         void setOperation(const char *op) {
-            m_logger->never("HSL op %s",op);
+            DRLOG_NEVER("HSL op %s",op);
             if (Util::equal(op,"replace")){
                 m_operation = REPLACE;
             } else if (Util::equal(op,"add")){
@@ -310,12 +366,15 @@ namespace DevRelief
             } else {
                 m_operation = REPLACE;
             }
-            m_logger->never("HSL op %s=%d",op,m_operation);
+            DRLOG_NEVER("HSL op %s=%d",op,m_operation);
         }
 
     protected:
         virtual void updateLED(int index, IHSLStrip* strip)=0;
+        // add the ops for one LED.  must match what updateLED() does
+        virtual void compileProgram(ScriptProgram* program)=0;
         HSLOperation m_operation;
+        ScriptProgram* m_program;
 
     };
 
@@ -359,7 +418,7 @@ namespace DevRelief
             }
             if (m_lightness) {
                 int l = m_lightness ? m_lightness->getIntValue(this, -1) : -1;
-                m_logger->never("HSL op %d",m_operation);
+                DRLOG_NEVER("HSL op %d",m_operation);
                 if (l >= 0) {
                     strip->setLightness(index, l, m_operation);
                 }
@@ -373,6 +432,21 @@ namespace DevRelief
 
         }
 
+        void compileProgram(ScriptProgram* program) override {
+            if (m_hue) {
+                program->compileInt(m_hue,-1);
+                program->add(OP_HUE);
+            }
+            if (m_lightness) {
+                program->compileInt(m_lightness,-1);
+                program->add(OP_LIGHTNESS);
+            }
+            if (m_saturation) {
+                program->compileInt(m_saturation,-1);
+                program->add(OP_SATURATION);
+            }
+        }
+
     protected:
         virtual int mapHue(int h) { return h;}
     private:
@@ -406,6 +480,11 @@ namespace DevRelief
                 return m_map.calculate(1.0*h/360.0)*(360);
             }
 
+            void compileProgram(ScriptProgram* program) override {
+                program->setHueMap(&m_map);
+                HSLCommand::compileProgram(program);
+            }
+
 
         private:
             IScriptValue* m_in;
@@ -444,17 +523,24 @@ namespace DevRelief
         IScriptValue *getBlue(IScriptValue *blue) { return m_blue; }
 
         void updateLED(int index, IHSLStrip* strip) override {
-                m_logger->never("RGB Led %d (0x%04, 0x%04, 0x%04)",index, m_red, m_green, m_blue);
+                DRLOG_NEVER("RGB Led %d (0x%04, 0x%04, 0x%04)",index, m_red, m_green, m_blue);
                 int r = m_red ? m_red->getIntValue(this, 0) : 0;
-                m_logger->never("\tred=%d", r);
+                DRLOG_NEVER("\tred=%d", r);
                 int g = m_green ? m_green->getIntValue(this, 0) : 0;
-                m_logger->never("\tgreen=%d", g);
+                DRLOG_NEVER("\tgreen=%d", g);
                 int b = m_blue ? m_blue->getIntValue(this, 0) : 0;
-                m_logger->never("\tblue=%d", b);
+                DRLOG_NEVER("\tblue=%d", b);
                 CRGB crgb(r, g, b);
                 strip->setRGB(index, crgb, m_operation);
         }
 
+        void compileProgram(ScriptProgram* program) override {
+            program->compileInt(m_red,0);
+            program->compileInt(m_green,0);
+            program->compileInt(m_blue,0);
+            program->add(OP_RGB);
+        }
+
     private:
         IScriptValue *m_red;
         IScriptValue *m_blue;
@@ -1,16 +1,16 @@
 #ifndef DRSCRIPT_CONTAINER_H
 #define DRSCRIPT_CONTAINER_H
 
-#include "../parse_gen.h";
-#include "../logger.h";
-#include "../led_strip.h";
-#include "../config.h";
-#include "../ensure.h";
-#include "../list.h";
-#include "../led_strip.h";
-#include "./script_interface.h";
-#include "./script.h";
-#include "./animation.h";
+#include "../parse_gen.h"
+#include "../logger.h"
+#include "../led_strip.h"
+#include "../config.h"
+#include "../ensure.h"
+#include "../list.h"
+#include "../led_strip.h"
+#include "./script_interface.h"
+#include "./script.h"
+#include "./animation.h"
 
 namespace DevRelief
 {
@@ -21,14 +21,14 @@ namespace DevRelief
         public:
             ScriptContainer(const char * type = "Container") : ScriptCommandBase(type)
             {
-                m_logger->debug("ScriptContainer() create");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptContainer() create");
                 m_position = NULL;
                 m_strip  = NULL;
             }
 
             virtual ~ScriptContainer()
             {
-                m_logger->debug("~ScriptContainer()");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"~ScriptContainer()");
             }
 
             void destroy() override { delete this; }
@@ -36,69 +36,75 @@ namespace DevRelief
             IScriptState* getState() { return m_state;}
 
             void add(IScriptCommand* cmd) { 
-                m_logger->never("\tadd command %s",cmd->getType());
+                DRLOG_NEVER("\tadd command %s",cmd->getType());
 
                 m_commands.add(cmd);
             }
+
+            void compile() override {
+                m_commands.each([&](IScriptCommand*cmd) {
+                    cmd->compile();
+                });
+            }
  
             ScriptPosition* getPosition() override { 
-                m_logger->never("container getPosition 0x%x",this);
+                DRLOG_NEVER("container getPosition 0x%x",this);
 
                 if (m_position) {
-                    m_logger->never("\tposition %x",m_position);
+                    DRLOG_NEVER("\tposition %x",m_position);
                     return m_position;
                 } else {
                     if (m_parentContainer) {
-                        m_logger->never("\tget parent position %x",m_parentContainer);
+                        DRLOG_NEVER("\tget parent position %x",m_parentContainer);
                         return m_parentContainer->getPosition();
                     }
-                    m_logger->never("\tno position");
+                    DRLOG_NEVER("\tno position");
 
                     return NULL;
                 }
             }
         protected:
             virtual ScriptStatus doCommand(IScriptState *state) {
-                m_logger->debug("ScriptContainer.execute");
-                m_logger->debug("\t %s 0x%x",getType(),this);
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptContainer.execute");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\t %s 0x%x",getType(),this);
                 ScriptStatus status = SCRIPT_RUNNING;
-                m_logger->debug("\tsetprev");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tsetprev");
                 state->setPreviousCommand(NULL);
-                m_logger->debug("\tsetcontainer");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tsetcontainer");
                 m_parentContainer = state->setContainer(this);
-                m_logger->debug("\tgetstrip");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tgetstrip");
                 auto oldStrip = state->getStrip();
                 if (m_position) {
                     state->setStrip(m_position);
                 } else if (m_strip) {
                     state->setStrip(m_strip);
                 }
-                m_logger->debug("\truncommands");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\truncommands");
                 status = runCommands(state);
-                m_logger->debug("\tset old strip");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tset old strip");
                 state->setStrip(oldStrip);
                 state->setContainer(m_parentContainer);
                 m_parentContainer = NULL;
-                m_logger->never("\tdoneScriptCommandList.execute()");
+                DRLOG_NEVER("\tdoneScriptCommandList.execute()");
                 return status;
             }
 
             virtual ScriptStatus runCommands(IScriptState* state) {
                 ScriptStatus status = SCRIPT_RUNNING;
                 m_commands.each([&](IScriptCommand*cmd) {
-                    m_logger->never("\tcommand 0x%04X - %s - %d",cmd,cmd->getType(),(int)status);
+                    DRLOG_NEVER("\tcommand 0x%04X - %s - %d",cmd,cmd->getType(),(int)status);
                     if (status == SCRIPT_RUNNING) {
                         status = cmd->execute(state);
                         state->setPreviousCommand(cmd);
                     } else {
-                        m_logger->never("\tscript status %d",(int)status);
+                        DRLOG_NEVER("\tscript status %d",(int)status);
 
                     }
                 });
                 return status;
             }
 
-            PtrList<IScriptCommand*> m_commands;
+            PtrSmallList<IScriptCommand*> m_commands;
             
             PositionDomain m_positionDomain;
 
@@ -123,7 +129,7 @@ namespace DevRelief
             }
 
             virtual void setPosition(int index) { 
-                m_logger->debug("ScriptRootContainer.setPosition(%d)",index);
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptRootContainer.setPosition(%d)",index);
                 m_position->setPositionIndex(index);
             }
 
@@ -153,15 +159,19 @@ namespace DevRelief
 
     class TemplateInstance {
         public:
-            TemplateInstance(IScriptCommand* parent,ScriptValueList& values){
+            TemplateInstance(IScriptCommand* parent,ScriptValueList& values,ObjectPool<TemplateInstance>* pool=NULL,ObjectPool<ChildState>* statePool=NULL){
                 m_parent=parent;
+                m_pool = pool;
                 m_logger = &ScriptCommandLogger;;
-                m_state = parent->getState()->createChild();
+                m_state = statePool ? parent->getState()->createChild(statePool) : NULL;
+                if (m_state == NULL) {
+                    m_state = parent->getState()->createChild();
+                }
                 values.each([&](NameValue* nv){
                     //IScriptValue*val = new ScriptNumberValue(parent,nv->getValue(),0);
                     IScriptValue*val = nv->getValue()->eval(parent,0);
-                    m_logger->debug("add ChildState %s=%s",nv->getName(),val->toString().get());
-                    m_state->setValue(nv->getName(),val);
+                    DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"add ChildState %s=%s",nv->getName(),val->toString().get());
+                    m_state->setValue(nv->getName(),val,nv->getSymbol());
                 });
                 m_status = SCRIPT_RUNNING;
             }
@@ -170,25 +180,31 @@ namespace DevRelief
                 m_state->destroy();
             }
 
-            void destroy() { delete this;}
+            void destroy() {
+                if (m_pool) {
+                    m_pool->release(this);
+                } else {
+                    delete this;
+                }
+            }
 
 
-            ScriptStatus run(PtrList<IScriptCommand*>& commands){
+            ScriptStatus run(PtrSmallList<IScriptCommand*>& commands){
                 if (m_status != SCRIPT_RUNNING) {
                     return m_status;
                 }
-                m_logger->debug("run instance");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"run instance");
                 m_state->beginStep();
                 m_state->setPreviousCommand(m_parent);
                 commands.each([&](IScriptCommand*cmd) {
-                    m_logger->never("\tcommand 0x%04X - %s - %d",cmd,cmd->getType(),(int)m_status);
+                    DRLOG_NEVER("\tcommand 0x%04X - %s - %d",cmd,cmd->getType(),(int)m_status);
                     cmd->setStatus(SCRIPT_RUNNING);
                     m_status = cmd->execute(m_state);
                     m_state->setPreviousCommand(cmd);
                 });
                 m_state->setPreviousCommand(NULL);
                 m_state->endStep();
-                m_logger->debug("\tinstance done");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tinstance done");
                 return m_status;
             }
 
@@ -199,20 +215,24 @@ namespace DevRelief
             IScriptCommand* m_parent;
             IScriptState* m_state;
             ScriptStatus m_status;
+            ObjectPool<TemplateInstance>* m_pool;
     };
 
     class ScriptTemplate : public ScriptContainer {
         public:
             ScriptTemplate() : ScriptContainer("ScriptTemplate") {
-                m_logger->never("create ScriptTemplate");
+                DRLOG_NEVER("create ScriptTemplate");
                 m_count=NULL;
                 m_minCount=NULL;
                 m_maxCount=NULL;
                 m_startChance=NULL;
                 m_endChance=NULL;
+                setPoolSize(TEMPLATE_POOL_SIZE);
             }
 
             virtual ~ScriptTemplate(){
+                // instances go back to the pools before the pools are freed
+                m_instances.clear();
                 if (m_count) {m_count->destroy();}
                 if (m_minCount) {m_minCount->destroy();}
                 if (m_maxCount) {m_maxCount->destroy();}
@@ -220,13 +240,13 @@ namespace DevRelief
                 if (m_endChance) {m_endChance->destroy();}
             }
 
-            void addValue(const char * name, IScriptValue* value) override {
-                m_logger->never("get value DRString");
+            void addValue(const char * name, IScriptValue* value, int symbol=NO_SCRIPT_SYMBOL) override {
+                DRLOG_NEVER("get value DRString");
                 DRString drval = value->toString();
-                m_logger->never("\tgot value DRString");
-                m_logger->never("\t%s",drval.get());
-                m_logger->never("\tadd value %s=%s",name,value->toString().get());
-                m_values.addValue(name,value);
+                DRLOG_NEVER("\tgot value DRString");
+                DRLOG_NEVER("\t%s",drval.get());
+                DRLOG_NEVER("\tadd value %s=%s",name,value->toString().get());
+                m_values.addValue(name,value,symbol);
             }
 
             bool shouldHappen(double chance, IScriptState* state) {
@@ -234,7 +254,7 @@ namespace DevRelief
                 double frac = msecs/1000.0;
                 double probability = (frac * chance)*100;
                 double roll = random(100);
-                m_logger->never("should happen: %f x %f (%f/1000)  %f>%f?",chance, frac,msecs,probability,roll);
+                DRLOG_NEVER("should happen: %f x %f (%f/1000)  %f>%f?",chance, frac,msecs,probability,roll);
                 if (probability> roll) {
                     return true;
                 }
@@ -247,33 +267,38 @@ namespace DevRelief
                 int maxCount = m_maxCount ? m_maxCount->getIntValue(this,count) : count;
                 minCount = max(minCount,count);
                 maxCount = max(maxCount,count);
-                m_logger->never("counts %d %d %d %d",count,minCount,maxCount,m_instances.size());
+                DRLOG_NEVER("counts %d %d %d %d",count,minCount,maxCount,m_instances.size());
 
                 double startChance = m_startChance?m_startChance->getFloatValue(this,0):0;
                 double endChance = m_endChance?m_endChance->getFloatValue(this,0):0;
 
                 if (shouldHappen(startChance,state) && maxCount>m_instances.size()+1) {
-                    TemplateInstance* inst = new TemplateInstance(this,m_values);
-                    m_logger->never("\tshould create");
-                    m_instances.add(inst);
+                    TemplateInstance* inst = createInstance();
+                    DRLOG_NEVER("\tshould create");
+                    if (inst) {
+                        m_instances.add(inst);
+                    }
                 }
 
                 if (shouldHappen(endChance,state) && minCount<m_instances.size()) {
-                    m_logger->never("\tshould remove");
+                    DRLOG_NEVER("\tshould remove");
                     m_instances.removeAt(0);
                 }
 
-                m_logger->debug("run template");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"run template");
                 while(maxCount < m_instances.size()) {
-                    m_logger->never("\t remove extra instance");
+                    DRLOG_NEVER("\t remove extra instance");
                     m_instances.removeAt(0);
                 }
                 while(minCount > m_instances.size()) {
-                    m_logger->never("\t create instance for min");
-                    TemplateInstance* inst = new TemplateInstance(this,m_values);
-                    m_logger->never("\t created");
+                    DRLOG_NEVER("\t create instance for min");
+                    TemplateInstance* inst = createInstance();
+                    DRLOG_NEVER("\t created");
+                    if (inst == NULL) {
+                        break;
+                    }
                     m_instances.add(inst);
-                    m_logger->never("\t added");
+                    DRLOG_NEVER("\t added");
                 };
            }
 
@@ -281,22 +306,29 @@ namespace DevRelief
                manageInstances(state);
                 ScriptStatus status = SCRIPT_RUNNING;
                 m_instances.each([&](TemplateInstance*instance){
-                    m_logger->debug("\t run instance 0x%x",instance);
+                    DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\t run instance 0x%x",instance);
                     if (instance->run(m_commands) != SCRIPT_RUNNING) {
-                        m_logger->never("remove instance %x",instance);
+                        DRLOG_NEVER("remove instance %x",instance);
                         m_instances.removeFirst(instance);
-                        m_logger->never("\tremoved");
+                        DRLOG_NEVER("\tremoved");
                     }
                 });
 
                 return status;
             }
 
-            void setCount(IScriptValue*count) { m_count = count;}
-            void setMinCount(IScriptValue*count) { m_minCount = count;}
-            void setMaxCount(IScriptValue*count) { m_maxCount = count;}
-            void setStartChance(IScriptValue*chance) { m_startChance = chance;}
-            void setEndChance(IScriptValue*chance) { m_endChance = chance;}
+            void setCount(IScriptValue*count) { replace(m_count,count);}
+            void setMinCount(IScriptValue*count) { replace(m_minCount,count);}
+            void setMaxCount(IScriptValue*count) { replace(m_maxCount,count);}
+            void setStartChance(IScriptValue*chance) { replace(m_startChance,chance);}
+            void setEndChance(IScriptValue*chance) { replace(m_endChance,chance);}
+            // most instances at once.  set while loading
+            void setPoolSize(int size) {
+                m_instancePool.setCapacity(size);
+                m_statePool.setCapacity(size);
+            }
+            ObjectPool<TemplateInstance>* getInstancePool() { return &m_instancePool;}
+            int getInstanceCount() { return m_instances.size();}
 
         protected:
             IScriptValue* m_count;
@@ -305,8 +337,28 @@ namespace DevRelief
             ScriptValueList m_values;
             IScriptValue* m_startChance;
             IScriptValue* m_endChance;
-            PtrList<TemplateInstance*> m_instances;
+            PtrSmallList<TemplateInstance*> m_instances;
+            // each instance has one state so they have the same capacity
+            ObjectPool<TemplateInstance> m_instancePool;
+            ObjectPool<ChildState> m_statePool;
+
+        private:
+            void replace(IScriptValue*& member, IScriptValue* value) {
+                if (member) { member->destroy();}
+                member = value;
+            }
 
+            // instances past the pool size come from the heap so the count limits still hold
+            TemplateInstance* createInstance() {
+                void* memory = m_instancePool.allocate();
+                if (memory == NULL) {
+                    if (m_instancePool.getExhausted() == 1) {
+                        m_logger->warn("template instance pool is full (%d).  using the heap",m_instancePool.getCapacity());
+                    }
+                    return new TemplateInstance(this,m_values);
+                }
+                return new (memory) TemplateInstance(this,m_values,&m_instancePool,&m_statePool);
+            }
     };
 
 }
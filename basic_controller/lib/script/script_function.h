@@ -0,0 +1,275 @@
+#ifndef DRSCRIPT_FUNCTION_H
+#define DRSCRIPT_FUNCTION_H
+
+#include "../logger.h"
+#include "../list.h"
+#include "../color.h"
+#include "./script_interface.h"
+
+namespace DevRelief
+{
+    Logger ScriptFunctionLogger("ScriptFunction", SCRIPT_LOGGER_LEVEL);
+
+    class FunctionArgs : public ArenaObject {
+        public:
+            FunctionArgs() {}
+            virtual ~FunctionArgs() {}
+
+            void add(IScriptValue* val) { args.add(val);}
+            IScriptValue* get(int index) { return args.get(index);}
+            size_t length() { return args.size();}
+
+            double getFloat(IScriptCommand*cmd, int idx, double defaultValue){
+                IScriptValue* val = args.get(idx);
+                if (val == NULL) { return defaultValue;}
+                return val->getFloatValue(cmd,defaultValue);
+            }
+        PtrSmallList<IScriptValue*> args;
+    };
+
+    // state belongs to the ScriptFunction node.  functions like seq keep their position in it
+    typedef double (*ScriptFunctionHandler)(IScriptCommand* cmd, FunctionArgs* args, double& state, double defaultValue);
+    typedef double (*ScriptSystemValueHandler)(IScriptCommand* cmd, double defaultValue);
+
+    #define SCRIPT_FUNCTION_ANY_ARGS 255
+    #define SCRIPT_FUNCTION_REGISTRY_SIZE 32
+    #define SCRIPT_SYSTEM_VALUE_REGISTRY_SIZE 24
+
+    enum ScriptFunctionFlags {
+        SCRIPT_FUNCTION_MSECS=1,    // getMsecValue() returns the function result
+        SCRIPT_FUNCTION_PURE=2,     // result depends only on the arguments.  constant arguments are folded at load
+        SCRIPT_FUNCTION_FRAME=4     // result can be reused for every LED in a step
+    };
+
+    struct ScriptFunctionDef {
+        const char * name;
+        ScriptFunctionHandler handler;
+        uint8_t minArgs;
+        uint8_t maxArgs;
+        uint8_t flags;
+    };
+
+    struct ScriptSystemValueDef {
+        const char * name;
+        ScriptSystemValueHandler handler;  // NULL for constants
+        double value;
+    };
+
+    /* ScriptFunctionRegistry maps function and sys() names to handlers.
+     * ScriptDataLoader resolves names once when it builds a ScriptFunction or
+     * ScriptSystemValue, so evaluation is a direct call.  Applications can add
+     * their own entries to ScriptFunctions before loading scripts.  Names are
+     * not copied and must be string literals (or live as long as the registry).
+     */
+    class ScriptFunctionRegistry {
+        public:
+            ScriptFunctionRegistry() {
+                m_logger = &ScriptFunctionLogger;
+                m_functionCount = 0;
+                m_systemValueCount = 0;
+                addBuiltins();
+            }
+
+            // an existing function with the same name is replaced
+            bool addFunction(const char * name, ScriptFunctionHandler handler, int minArgs, int maxArgs, int flags=0) {
+                ScriptFunctionDef* def = (ScriptFunctionDef*)findFunction(name);
+                if (def == NULL) {
+                    if (m_functionCount >= SCRIPT_FUNCTION_REGISTRY_SIZE) {
+                        m_logger->error("too many script functions.  cannot add %s",name);
+                        return false;
+                    }
+                    def = &m_functions[m_functionCount++];
+                }
+                def->name = name;
+                def->handler = handler;
+                def->minArgs = minArgs;
+                def->maxArgs = maxArgs;
+                def->flags = flags;
+                return true;
+            }
+
+            bool addSystemValue(const char * name, ScriptSystemValueHandler handler, double value=0) {
+                ScriptSystemValueDef* def = (ScriptSystemValueDef*)findSystemValue(name);
+                if (def == NULL) {
+                    if (m_systemValueCount >= SCRIPT_SYSTEM_VALUE_REGISTRY_SIZE) {
+                        m_logger->error("too many system values.  cannot add %s",name);
+                        return false;
+                    }
+                    def = &m_systemValues[m_systemValueCount++];
+                }
+                def->name = name;
+                def->handler = handler;
+                def->value = value;
+                return true;
+            }
+
+            bool addSystemValue(const char * name, double value) {
+                return addSystemValue(name,NULL,value);
+            }
+
+            const ScriptFunctionDef* findFunction(const char * name) {
+                if (name == NULL) { return NULL;}
+                for(int i=0;i<m_functionCount;i++) {
+                    if (strcmp(m_functions[i].name,name)==0) {
+                        return &m_functions[i];
+                    }
+                }
+                return NULL;
+            }
+
+            const ScriptSystemValueDef* findSystemValue(const char * name) {
+                if (name == NULL) { return NULL;}
+                for(int i=0;i<m_systemValueCount;i++) {
+                    if (strcmp(m_systemValues[i].name,name)==0) {
+                        return &m_systemValues[i];
+                    }
+                }
+                return NULL;
+            }
+
+            bool checkArgs(const ScriptFunctionDef* def, int count) {
+                if (count < def->minArgs || count > def->maxArgs) {
+                    if (def->minArgs == def->maxArgs) {
+                        m_logger->error("function %s needs %d arguments.  got %d",def->name,def->minArgs,count);
+                    } else {
+                        m_logger->error("function %s needs %d-%d arguments.  got %d",def->name,def->minArgs,def->maxArgs,count);
+                    }
+                    return false;
+                }
+                return true;
+            }
+
+            /* built-in handlers */
+            static double randomRange(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                int low = args ? args->getFloat(cmd,0,0) : 0;
+                int high = args ? args->getFloat(cmd,1,low) : low;
+                if (high == low) {
+                    low = 0;
+                }
+                if (high < low) {
+                    int t = low;
+                    low = high;
+                    high = t;
+                }
+                return random(low,high+1);
+            }
+
+            static double add(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                return args->getFloat(cmd,0,defaultValue) + args->getFloat(cmd,1,defaultValue);
+            }
+
+            static double subtract(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                return args->getFloat(cmd,0,defaultValue) - args->getFloat(cmd,1,defaultValue);
+            }
+
+            static double multiply(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                return args->getFloat(cmd,0,defaultValue) * args->getFloat(cmd,1,defaultValue);
+            }
+
+            static double divide(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                double first = args->getFloat(cmd,0,defaultValue);
+                double second = args->getFloat(cmd,1,defaultValue);
+                return (second == 0) ? 0 : first / second;
+            }
+
+            static double mod(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                double first = args->getFloat(cmd,0,defaultValue);
+                double second = args->getFloat(cmd,1,defaultValue);
+                return (int)second == 0 ? 0 : (double)((int)first % (int)second);
+            }
+
+            static double minimum(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                double first = args->getFloat(cmd,0,defaultValue);
+                double second = args->getFloat(cmd,1,defaultValue);
+                return first < second ? first : second;
+            }
+
+            static double maximum(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                double first = args->getFloat(cmd,0,defaultValue);
+                double second = args->getFloat(cmd,1,defaultValue);
+                return first > second ? first : second;
+            }
+
+            static double randomOf(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                int idx = random(args->length());
+                return args->getFloat(cmd,idx,defaultValue);
+            }
+
+            static double sequence(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                int start = args ? args->getFloat(cmd,0,0) : 0;
+                int end = args ? args->getFloat(cmd,1,100) : 100;
+                int step = args ? args->getFloat(cmd,2,1) : 1;
+
+                if (state < start){
+                    state = start;
+                } else {
+                    state += step;
+                }
+                if (state > end){
+                    state = start;
+                }
+                return state;
+            }
+
+            static double currentMillis(IScriptCommand*cmd, FunctionArgs* args, double& state, double defaultValue) {
+                return millis();
+            }
+
+            static double stripStart(IScriptCommand* cmd, double defaultValue) {
+                return cmd->getState()->getStrip()->getStart();
+            }
+
+            static double stripCount(IScriptCommand* cmd, double defaultValue) {
+                return cmd->getState()->getStrip()->getCount();
+            }
+
+            static double stepNumber(IScriptCommand* cmd, double defaultValue) {
+                return cmd->getState()->getStepNumber();
+            }
+
+        private:
+            void addBuiltins() {
+                addFunction("rand",randomRange,0,2);
+                addFunction("add",add,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("+",add,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("subtract",subtract,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("sub",subtract,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("-",subtract,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("multiply",multiply,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("mult",multiply,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("*",multiply,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("divide",divide,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("div",divide,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("/",divide,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("mod",mod,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("%",mod,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("min",minimum,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("max",maximum,2,2,SCRIPT_FUNCTION_PURE);
+                addFunction("randOf",randomOf,1,SCRIPT_FUNCTION_ANY_ARGS);
+                addFunction("seq",sequence,0,3);
+                addFunction("sequence",sequence,0,3);
+                addFunction("millis",currentMillis,0,0,SCRIPT_FUNCTION_MSECS|SCRIPT_FUNCTION_FRAME);
+
+                addSystemValue("start",stripStart);
+                addSystemValue("count",stripCount);
+                addSystemValue("step",stepNumber);
+                addSystemValue("red",HUE::RED);
+                addSystemValue("orange",HUE::ORANGE);
+                addSystemValue("yellow",HUE::YELLOW);
+                addSystemValue("green",HUE::GREEN);
+                addSystemValue("cyan",HUE::CYAN);
+                addSystemValue("blue",HUE::BLUE);
+                addSystemValue("magenta",HUE::MAGENTA);
+                addSystemValue("purple",HUE::PURPLE);
+            }
+
+            Logger* m_logger;
+            ScriptFunctionDef m_functions[SCRIPT_FUNCTION_REGISTRY_SIZE];
+            int m_functionCount;
+            ScriptSystemValueDef m_systemValues[SCRIPT_SYSTEM_VALUE_REGISTRY_SIZE];
+            int m_systemValueCount;
+    };
+
+    ScriptFunctionRegistry ScriptFunctions;
+}
+#endif
@@ -1,9 +1,12 @@
 #ifndef DRSCRIPT_INTERFACE_H
 #define DRSCRIPT_INTERFACE_H
 
-#include "../logger.h";
-#include "../led_strip.h";
-#include "../util.h";
+#include "../logger.h"
+#include "../led_strip.h"
+#include "../util.h"
+#include "../arena.h"
+#include "../pool.h"
+#include "./script_symbol.h"
 
 namespace DevRelief
 {
@@ -12,13 +15,13 @@ namespace DevRelief
     Logger ScriptCommandLogger("ScriptCommand", SCRIPT_LOGGER_LEVEL);
     Logger ScriptStateLogger("ScriptState", SCRIPT_STATE_LOGGER_LEVEL);
 
-    typedef enum PositionUnit
+    enum PositionUnit
     {
         POS_PERCENT = 0,
         POS_PIXEL = 1,
         POS_INHERIT = 2
     };
-    typedef enum PositionType
+    enum PositionType
     {
         POS_RELATIVE = 0,
         POS_ABSOLUTE = 1,
@@ -26,7 +29,7 @@ namespace DevRelief
         POS_STRIP = 4
     };
 
-    typedef enum ScriptStatus {
+    enum ScriptStatus {
         SCRIPT_CREATED,
         SCRIPT_RUNNING,
         SCRIPT_COMPLETE,
@@ -34,7 +37,15 @@ namespace DevRelief
         SCRIPT_PAUSED
     };
 
+    // what a value's result depends on.  ordered so the larger scope wins when values combine
+    enum ScriptValueScope {
+        SCOPE_CONSTANT=0,   // never changes
+        SCOPE_FRAME=1,      // time, step or state.  the same for every LED in a step
+        SCOPE_LED=2         // position, random or stateful.  evaluated for each LED
+    };
+
     class ScriptState;
+    class ChildState;
     class Script;
     class ScriptCommand;
     class ScriptPosition;
@@ -43,11 +54,12 @@ namespace DevRelief
     class TimeDomain;
     class PositionDomain;
     class IValueAnimator;
+    class ScriptProgram;
 
     Logger *memLogger = &ScriptMemoryLogger;
     class IScriptCommand;
 
-    class IScriptValue
+    class IScriptValue : public ArenaObject
     {
     public:
         virtual void destroy() =0; // cannot delete pure virtual interfaces. they must all implement destroy
@@ -66,6 +78,14 @@ namespace DevRelief
         virtual IScriptValue* eval(IScriptCommand*cmd, double defaultValue)=0; 
 
 
+        // append this value's evaluation to a ScriptProgram.  return false (and add nothing)
+        // if it cannot be lowered and must be called as a value
+        virtual bool compile(ScriptProgram* program, double defaultValue)=0;
+
+        // true if the value never changes (number and bool literals)
+        virtual bool isConstant() = 0;
+        // what the result depends on when evaluated for cmd
+        virtual ScriptValueScope getScope(IScriptCommand* cmd) = 0;
         virtual bool isRecursing() = 0; // mainly for variable values
         // for debugging
         virtual DRString toString() = 0;
@@ -105,22 +125,26 @@ namespace DevRelief
         virtual void endStep()=0;
         virtual int getStepStartTime()=0;
         virtual int getStepNumber()=0;
-        virtual void setValue(const char * valueName, IScriptValue* val)=0;
+        virtual void setValue(const char * valueName, IScriptValue* val, int symbol=NO_SCRIPT_SYMBOL)=0;
         virtual void setValue(void*owner, const char * valueName, IScriptValue* val)=0;
         virtual void setPreviousCommand(IScriptCommand* cmd)=0;
         virtual void setCurrentCommand(IScriptCommand* cmd)=0;
         virtual IScriptCommand* getPreviousCommand()=0;
         virtual IScriptValue* getValue(const char * valueName)=0;
         virtual IScriptValue* getValue(void* owner,const char * valueName)=0;
+        // same as getValue(name) for a symbol from the script's ScriptSymbolTable
+        virtual IScriptValue* getSymbolValue(int symbol)=0;
         virtual IScriptCommand* setContainer(IScriptCommand*)=0;// return previous value
         virtual IScriptCommand* getContainer()=0;
         virtual IHSLStrip* setStrip(IHSLStrip*)=0; // return previous value
         virtual IHSLStrip* getStrip()=0;
         virtual IScriptState* createChild()=0;
+        // NULL if the pool is full
+        virtual IScriptState* createChild(ObjectPool<ChildState>* pool)=0;
         virtual long msecsSinceLastStep()=0;
     };
 
-    class IPositionable {
+    class IPositionable : public ArenaObject {
         public:
             virtual ScriptPosition* getPosition()=0;
             virtual PositionDomain* getAnimationPositionDomain()=0;
@@ -137,12 +161,15 @@ namespace DevRelief
             virtual void setStatus(ScriptStatus status)=0;
             virtual ScriptStatus execute(IScriptState*state)=0;
             virtual IScriptValue* getValue(const char* name)=0;
+            virtual IScriptValue* getSymbolValue(int symbol)=0;
             virtual const char * getType()=0;
             virtual IScriptState* getState()=0;
             virtual void onAnimationComplete(IValueAnimator*animator)=0;
+            // build any ScriptProgram the command runs.  called once after the script is loaded
+            virtual void compile()=0;
     };
 
-    class IValueAnimator
+    class IValueAnimator : public ArenaObject
     {
         public:
         virtual void destroy() =0; // cannot delete pure virtual interfaces. they must all implement destroy    
@@ -150,8 +177,18 @@ namespace DevRelief
         virtual double get(IScriptCommand*cmd, AnimationRange&range)=0;
         virtual IValueAnimator* clone(IScriptCommand*cmd)=0;
         virtual AnimationDomain* getDomain(IScriptCommand*cmd, AnimationRange&range)=0;
+        virtual ScriptValueScope getScope(IScriptCommand*cmd)=0;
     };
 
+    // the larger of scope and value's scope.  a NULL value does not change it
+    ScriptValueScope combineScope(ScriptValueScope scope, IScriptValue* value, IScriptCommand* cmd) {
+        if (value == NULL || scope == SCOPE_LED) {
+            return scope;
+        }
+        ScriptValueScope other = value->getScope(cmd);
+        return other > scope ? other : scope;
+    }
+
   
     class IScript {
         public:
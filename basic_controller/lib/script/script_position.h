@@ -1,17 +1,17 @@
 #ifndef DRSCRIPT_POSITION_H
 #define DRSCRIPT_POSITION_H
 
-#include "../logger.h";
-#include "../led_strip.h";
-#include "./script_interface.h";
-#include "./script_value.h";
-#include "./script_state.h";
-#include "./animation.h";
+#include "../logger.h"
+#include "../led_strip.h"
+#include "./script_interface.h"
+#include "./script_value.h"
+#include "./script_state.h"
+#include "./animation.h"
 
 namespace DevRelief
 {
 
-    class ScriptPosition : public IHSLStrip, IPositionable
+    class ScriptPosition : public IHSLStrip, public IPositionable
     {
     public:
         ScriptPosition()
@@ -39,7 +39,7 @@ namespace DevRelief
             m_parentPosition = NULL;
         }
 
-        ~ScriptPosition() {
+        virtual ~ScriptPosition() {
             if (m_startValue) {m_startValue->destroy();}
             if (m_countValue) {m_countValue->destroy();}
             if (m_endValue) {m_endValue->destroy();}
@@ -60,9 +60,9 @@ namespace DevRelief
             m_type = t;
         }
         void updateValues(IScriptCommand* cmd, IScriptState* state){
-            m_logger->never("update position 0x%x 0x%x",cmd,state);
+            DRLOG_NEVER("update position 0x%x 0x%x",cmd,state);
             IScriptCommand* container = state->getContainer();
-            m_logger->never("\tcontainer 0x%x",container);
+            DRLOG_NEVER("\tcontainer 0x%x",container);
             m_parentPosition =  container ? container->getPosition() : NULL;
             m_strip = state->getStrip();
             if (m_strip == NULL) {
@@ -141,14 +141,14 @@ namespace DevRelief
         }
        
         int getStripPosition(IScriptCommand* cmd, IScriptState*state, IScriptValue* value,int defaultValue){
-            m_logger->debug("getStripPosition");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"getStripPosition");
             int rpos = defaultValue;
             if (value) {
-                //m_logger->debug("have value %s",value->toString().get());
+                //DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"have value %s",value->toString().get());
                 IScriptCommand*prev = state->getPreviousCommand();
                 if (prev&&value->equals(cmd,"after")){
                     ScriptPosition* pos =  prev->getPosition();
-                    //m_logger->debug("previous pos %d %d",pos->getStart(),pos->getCount());
+                    //DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"previous pos %d %d",pos->getStart(),pos->getCount());
                     if (pos != NULL) {
                         rpos = pos->getStart() + pos->getCount() + pos->getOffset();
                     } else {
@@ -156,7 +156,7 @@ namespace DevRelief
                     }
                 } else if (prev&&value->equals(cmd,"before")){
                     ScriptPosition* pos =  prev->getPosition();
-                    m_logger->debug("previous pos %d %d",pos->getStart(),pos->getCount());
+                    DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"previous pos %d %d",pos->getStart(),pos->getCount());
                     if (pos == NULL) {
                         rpos = -1;
                     } else {
@@ -164,13 +164,13 @@ namespace DevRelief
                     }
                 }  else if (value->equals(cmd,"center")){
                     IHSLStrip* pos =  m_strip;
-                    m_logger->debug("center pos %d %d",pos->getStart(),pos->getCount());
+                    DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"center pos %d %d",pos->getStart(),pos->getCount());
                     rpos = pos->getStart()+round(pos->getCount()/2);
                 } else {
                     rpos  = value->getIntValue(cmd,defaultValue);
                 }
             }  else {
-                m_logger->never("\tno value");
+                DRLOG_NEVER("\tno value");
             }
             return rpos;
         }
@@ -208,11 +208,11 @@ namespace DevRelief
         void setEndValue(IScriptValue *val) { m_endValue = val; }
         void setSkipValue(IScriptValue *val) {
             if (val != NULL) {
-                delete m_skipValue;
-                m_logger->never("got skip value %s",val->toString().get());
+                if (m_skipValue) {m_skipValue->destroy();}
+                DRLOG_NEVER("got skip value %s",val->toString().get());
                 m_skipValue = val; 
             } else {
-                m_logger->never("skip is NULL");
+                DRLOG_NEVER("skip is NULL");
             }
         }
         void setUnit(PositionUnit unit) { m_unit = unit; }
@@ -223,7 +223,7 @@ namespace DevRelief
                 //ScriptLogger.periodic(ERROR_LEVEL,100,NULL,"Script position missing a previous strip");
                 return;
             }
-            m_logger->never("%d==>%d",orig,index);
+            DRLOG_NEVER("%d==>%d",orig,index);
             m_strip->setHue((index), hue, op);
         }
         void setSaturation(int index, int16_t saturation, HSLOperation op)
@@ -240,7 +240,7 @@ namespace DevRelief
                 //ScriptLogger.periodic(ERROR_LEVEL,100,NULL,"Script position missing a previous strip");
                 return;
             }
-            m_logger->never("Position op %d",op);
+            DRLOG_NEVER("Position op %d",op);
             m_strip->setLightness((index), lightness, op);
         }
         void setRGB(int index, const CRGB &rgb, HSLOperation op)
@@ -250,7 +250,7 @@ namespace DevRelief
                 //ScriptLogger.periodic(ERROR_LEVEL,1000,NULL,"Script position missing a previous strip");
                 return;
             }
-          //  m_logger->never("\ttranslated RGB index %d===>%d",orig,index);
+          //  DRLOG_NEVER("\ttranslated RGB index %d===>%d",orig,index);
             m_strip->setRGB((index), rgb, op);
         }
         int getCount() { return m_count; }
@@ -269,10 +269,10 @@ namespace DevRelief
             }
             if (count == 0) { return false;}
             if (m_skipValue) {
-                m_logger->never("\tskip %d. index=%d",m_skip,index*m_skip);
+                DRLOG_NEVER("\tskip %d. index=%d",m_skip,index*m_skip);
                 index = index * m_skip;
             } else {
-                m_logger->never("\tno skip");
+                DRLOG_NEVER("\tno skip");
             }
             if (index < 0 && m_wrap) {
                     index = count + (index%count);
@@ -292,13 +292,13 @@ namespace DevRelief
             } else {
                 index = m_start+index;
             }
-           // m_logger->never("%d-->%d",orig,index);
+           // DRLOG_NEVER("%d-->%d",orig,index);
             return true;
         }
 
         void setPositionIndex(int index) override {
             // use original, not translated index
-            m_logger->never("ScriptPosition.setPosition %d",index);
+            DRLOG_NEVER("ScriptPosition.setPosition %d",index);
 
             m_positionDomain.setPos(index);
         }
@@ -0,0 +1,242 @@
+#ifndef DRSCRIPT_PROFILE_H
+#define DRSCRIPT_PROFILE_H
+
+#include "../logger.h"
+#include "../parse_gen.h"
+
+namespace DevRelief
+{
+    Logger ScriptProfileLogger("ScriptProfile", SCRIPT_LOGGER_LEVEL);
+
+    // 2 buckets per power of 2 from 1us to ~1s
+    #define PROFILE_BUCKETS 40
+    // bucket counts are halved when they add up to this so old frames fade out
+    #define PROFILE_DECAY_COUNT 512
+
+    /* TimeHistogram is a rolling histogram of durations in microseconds.
+     * Percentiles are the top of the bucket the sample falls in (at most
+     * 50% high) and never more than the largest sample.  max is exact
+     * since the last reset.
+     */
+    class TimeHistogram {
+        public:
+            TimeHistogram() {
+                reset();
+            }
+
+            void reset() {
+                memset(m_buckets,0,sizeof(m_buckets));
+                m_count = 0;
+                m_samples = 0;
+                m_max = 0;
+                m_total = 0;
+            }
+
+            void add(uint32_t micros) {
+                m_buckets[bucketOf(micros)]++;
+                m_count++;
+                m_samples++;
+                m_total += micros;
+                if (micros > m_max) {
+                    m_max = micros;
+                }
+                if (m_count >= PROFILE_DECAY_COUNT) {
+                    m_count = 0;
+                    for(int i=0;i<PROFILE_BUCKETS;i++) {
+                        m_buckets[i] = (m_buckets[i]+1)/2;
+                        m_count += m_buckets[i];
+                    }
+                }
+            }
+
+            // percent is 0-100
+            uint32_t getPercentile(int percent) {
+                if (m_count == 0) {
+                    return 0;
+                }
+                uint32_t target = (m_count*percent+99)/100;
+                uint32_t seen = 0;
+                for(int i=0;i<PROFILE_BUCKETS;i++) {
+                    seen += m_buckets[i];
+                    if (seen >= target && seen > 0) {
+                        uint32_t top = bucketTop(i);
+                        return top < m_max ? top : m_max;
+                    }
+                }
+                return m_max;
+            }
+
+            uint32_t getMax() { return m_max;}
+            uint32_t getSamples() { return m_samples;}
+            uint32_t getMean() { return m_samples == 0 ? 0 : m_total/m_samples;}
+
+            void toJson(JsonObject* json) {
+                json->set("count",(int)m_samples);
+                json->set("p50",(int)getPercentile(50));
+                json->set("p95",(int)getPercentile(95));
+                json->set("max",(int)m_max);
+                json->set("mean",(int)getMean());
+            }
+
+            static int bucketOf(uint32_t micros) {
+                if (micros < 2) {
+                    return 0;
+                }
+                int octave = 31-__builtin_clz(micros);
+                int bucket = octave*2 + ((micros >> (octave-1)) & 1);
+                return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS-1;
+            }
+
+            // largest duration that goes in a bucket
+            static uint32_t bucketTop(int bucket) {
+                int octave = bucket/2;
+                if (octave == 0) {
+                    return 1;
+                }
+                uint32_t half = 1 << (octave-1);
+                return (1 << octave) + (bucket%2)*half + half - 1;
+            }
+
+        private:
+            uint16_t m_buckets[PROFILE_BUCKETS];
+            uint32_t m_count;       // in the buckets after decay
+            uint32_t m_samples;     // since reset
+            uint32_t m_max;
+            uint64_t m_total;
+    };
+
+    #define PROFILE_TYPE_SIZE 20
+
+    struct CommandProfile {
+        char type[PROFILE_TYPE_SIZE];   // copied.  the script may be gone when the profile is read
+        TimeHistogram time;
+    };
+
+    /* ScriptProfiler times the phases of Script::step() and every
+     * ScriptCommandBase::execute().  Command times include the commands a
+     * container runs.  Commands are numbered in the order they first run,
+     * which is their order in the script, and keep their slot in the command
+     * so recording a time is an index.  The running script is reset when it
+     * begins.  Served as JSON at /api/profile.
+     * Compiled out with SCRIPT_PROFILE 0.
+     */
+    class ScriptProfiler {
+        public:
+            ScriptProfiler() {
+                m_logger = &ScriptProfileLogger;
+                m_commands = NULL;
+                m_commandCount = 0;
+                m_commandCapacity = 0;
+                m_generation = 0;
+                reset();
+            }
+
+            ~ScriptProfiler() {
+                free(m_commands);
+            }
+
+            void reset() {
+                free(m_commands);
+                m_commands = NULL;
+                m_commandCount = 0;
+                m_commandCapacity = 0;
+                // commands start at generation 0 so it is never current
+                if (++m_generation == 0) {
+                    m_generation = 1;
+                }
+                m_clear.reset();
+                m_execute.reset();
+                m_show.reset();
+                m_step.reset();
+                m_missed = 0;
+                m_frequencyMSecs = 0;
+            }
+
+            void addStep(uint32_t clearMicros, uint32_t executeMicros, uint32_t showMicros, int frequencyMSecs) {
+                uint32_t total = clearMicros+executeMicros+showMicros;
+                m_clear.add(clearMicros);
+                m_execute.add(executeMicros);
+                m_show.add(showMicros);
+                m_step.add(total);
+                m_frequencyMSecs = frequencyMSecs;
+                // a frequency of 0 runs a frame every loop so there is no deadline to miss
+                if (frequencyMSecs > 0 && total > (uint32_t)frequencyMSecs*1000) {
+                    m_missed++;
+                }
+            }
+
+            // slot and generation belong to the command.  called before the command runs so slots are in script order
+            void beginCommand(int16_t& slot, uint16_t& generation, const char * type) {
+                if (generation != m_generation) {
+                    generation = m_generation;
+                    slot = newCommand(type);
+                }
+            }
+
+            void addCommand(int16_t slot, uint32_t micros) {
+                if (slot >= 0) {
+                    m_commands[slot].time.add(micros);
+                }
+            }
+
+            uint32_t getSteps() { return m_step.getSamples();}
+            uint32_t getMissed() { return m_missed;}
+            int getCommandCount() { return m_commandCount;}
+            const char * getCommandType(int index) { return index < m_commandCount ? m_commands[index].type : NULL;}
+            TimeHistogram* getCommandTime(int index) { return index < m_commandCount ? &m_commands[index].time : NULL;}
+            TimeHistogram* getStepTime() { return &m_step;}
+
+            void toJson(JsonObject* json) {
+                json->set("steps",(int)getSteps());
+                json->set("missed",(int)m_missed);
+                json->set("frequency",m_frequencyMSecs);
+                JsonObject* phases = json->createObject("phases");
+                m_clear.toJson(phases->createObject("clear"));
+                m_execute.toJson(phases->createObject("execute"));
+                m_show.toJson(phases->createObject("show"));
+                m_step.toJson(phases->createObject("step"));
+                JsonArray* commands = json->createArray("commands");
+                for(int i=0;i<m_commandCount;i++) {
+                    JsonObject* command = new JsonObject(*json->getRoot());
+                    command->set("index",i);
+                    command->set("type",m_commands[i].type);
+                    m_commands[i].time.toJson(command);
+                    commands->addItem(command);
+                }
+            }
+
+        private:
+            int newCommand(const char * type) {
+                if (m_commandCount == m_commandCapacity) {
+                    int capacity = m_commandCapacity == 0 ? 8 : m_commandCapacity*2;
+                    CommandProfile* commands = (CommandProfile*)realloc(m_commands,capacity*sizeof(CommandProfile));
+                    if (commands == NULL) {
+                        m_logger->errorNoRepeat("out of memory for command profile");
+                        return -1;
+                    }
+                    m_commands = commands;
+                    m_commandCapacity = capacity;
+                }
+                CommandProfile* profile = m_commands + m_commandCount;
+                strncpy(profile->type,type == NULL ? "" : type,PROFILE_TYPE_SIZE-1);
+                profile->type[PROFILE_TYPE_SIZE-1] = 0;
+                profile->time.reset();
+                return m_commandCount++;
+            }
+
+            Logger* m_logger;
+            TimeHistogram m_clear;
+            TimeHistogram m_execute;
+            TimeHistogram m_show;
+            TimeHistogram m_step;
+            uint32_t m_missed;
+            int m_frequencyMSecs;
+            CommandProfile* m_commands;
+            int m_commandCount;
+            int m_commandCapacity;
+            uint16_t m_generation;
+    };
+
+    ScriptProfiler ScriptProfile;
+}
+#endif
@@ -0,0 +1,362 @@
+#ifndef DRSCRIPT_PROGRAM_H
+#define DRSCRIPT_PROGRAM_H
+
+#include "../logger.h"
+#include "../led_strip.h"
+#include "./script_interface.h"
+#include "./script_value.h"
+#include "./script_position.h"
+#include "./animation.h"
+
+namespace DevRelief
+{
+    Logger ScriptProgramLogger("ScriptProgram", SCRIPT_LOGGER_LEVEL);
+
+    // most values compile to 1-4 entries.  deeper expressions fall back to the value tree
+    #define SCRIPT_PROGRAM_STACK_SIZE 16
+
+    enum ScriptOpCode {
+        OP_NUMBER=0,    // push number
+        OP_VALUE,       // push value->getFloatValue(cmd,number)
+        OP_VALUE_INT,   // push value->getIntValue(cmd,number)
+        OP_TRUNC,       // top = (int)top
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_MOD,
+        OP_MIN,
+        OP_MAX,
+        OP_RANGE,       // pop end, start.  push start-end eased over the position domain
+        OP_HUE,         // pop and set hue if >= 0.  the hue map is applied if there is one
+        OP_LIGHTNESS,
+        OP_SATURATION,
+        OP_RGB          // pop blue, green, red
+    };
+
+    CubicBezierEase RangeEase;
+
+    struct ScriptOp {
+        uint8_t code;
+        bool cached;        // OP_VALUE result was evaluated by beginFrame()
+        IScriptValue* value;
+        double number;
+        double result;
+    };
+
+    /* ScriptProgram is an LED command's value trees lowered to a linear list of
+     * stack operations.  It is run once per LED instead of walking the command's
+     * IScriptValue tree.  Values that cannot be lowered (variables, patterns,
+     * animated ranges, random functions) are called through OP_VALUE so results
+     * match the tree exactly.  Those values are evaluated once per step instead
+     * when their scope says every LED gets the same result (beginFrame).
+     * The program does not own any IScriptValue.
+     */
+    class ScriptProgram {
+        public:
+            ScriptProgram() {
+                m_logger = &ScriptProgramLogger;
+                m_ops = NULL;
+                m_count = 0;
+                m_capacity = 0;
+                m_depth = 0;
+                m_maxDepth = 0;
+                m_valid = true;
+                m_hueMap = NULL;
+                m_valueCount = 0;
+            }
+
+            ~ScriptProgram() {
+                if (m_ops) { free(m_ops);}
+            }
+
+            void destroy() { delete this;}
+
+            /* builder */
+            void addNumber(double number) {
+                ScriptOp* op = add(OP_NUMBER);
+                if (op) { op->number = number;}
+            }
+
+            void addValue(IScriptValue* value, double defaultValue, bool asInt=false) {
+                ScriptOp* op = add(asInt ? OP_VALUE_INT : OP_VALUE);
+                if (op) {
+                    op->value = value;
+                    op->number = defaultValue;
+                    m_valueCount++;
+                }
+            }
+
+            ScriptOp* add(ScriptOpCode code) {
+                if (!m_valid) { return NULL;}
+                if (m_count == m_capacity) {
+                    int capacity = m_capacity == 0 ? 8 : m_capacity*2;
+                    ScriptOp* ops = (ScriptOp*)realloc(m_ops,capacity*sizeof(ScriptOp));
+                    if (ops == NULL) {
+                        m_logger->error("out of memory for ScriptProgram");
+                        m_valid = false;
+                        return NULL;
+                    }
+                    m_ops = ops;
+                    m_capacity = capacity;
+                }
+                m_depth += stackChange(code);
+                if (m_depth > m_maxDepth) {
+                    m_maxDepth = m_depth;
+                }
+                if (m_maxDepth > SCRIPT_PROGRAM_STACK_SIZE || m_depth < 0) {
+                    m_logger->error("ScriptProgram stack %d is out of range",m_depth);
+                    m_valid = false;
+                    return NULL;
+                }
+                ScriptOp* op = m_ops + m_count;
+                m_count++;
+                op->code = code;
+                op->cached = false;
+                op->value = NULL;
+                op->number = 0;
+                op->result = 0;
+                return op;
+            }
+
+            // leaves the value's float result on the stack
+            void compileFloat(IScriptValue* value, double defaultValue) {
+                if (value == NULL) {
+                    addNumber(defaultValue);
+                } else if (!value->compile(this,defaultValue)) {
+                    addValue(value,defaultValue,false);
+                }
+            }
+
+            // leaves the value's int result on the stack
+            void compileInt(IScriptValue* value, double defaultValue) {
+                if (value == NULL) {
+                    addNumber((int)defaultValue);
+                } else if (value->compile(this,(int)defaultValue)) {
+                    add(OP_TRUNC);
+                } else {
+                    addValue(value,defaultValue,true);
+                }
+            }
+
+            // shrink to the final size after compiling
+            void finish() {
+                if (m_valid && m_count > 0 && m_count < m_capacity) {
+                    ScriptOp* ops = (ScriptOp*)realloc(m_ops,m_count*sizeof(ScriptOp));
+                    if (ops) {
+                        m_ops = ops;
+                        m_capacity = m_count;
+                    }
+                }
+                m_logger->debug("compiled %d ops.  stack %d",m_count,m_maxDepth);
+            }
+
+            void setHueMap(AnimationEase* map) { m_hueMap = map;}
+            bool isValid() { return m_valid && m_depth == 0;}
+            int getOpCount() { return m_count;}
+
+            /* evaluate values that are not per-LED once before the LED loop.  the
+             * scope is checked each step since a var() can resolve to a different value
+             */
+            void beginFrame(IScriptCommand* cmd) {
+                if (m_valueCount == 0) {
+                    return;
+                }
+                const ScriptOp* end = m_ops + m_count;
+                for(ScriptOp* op = m_ops;op<end;op++) {
+                    if (op->code == OP_VALUE || op->code == OP_VALUE_INT) {
+                        op->cached = op->value->getScope(cmd) != SCOPE_LED;
+                        if (op->cached) {
+                            op->result = op->code == OP_VALUE ? op->value->getFloatValue(cmd,op->number) : op->value->getIntValue(cmd,(int)op->number);
+                        }
+                    }
+                }
+            }
+
+            /* interpreter.  runs every op for one LED */
+            void run(IScriptCommand* cmd, ScriptPosition* position, PositionDomain* domain, int index, HSLOperation operation) {
+                double stack[SCRIPT_PROGRAM_STACK_SIZE];
+                int sp = 0;
+                const ScriptOp* end = m_ops + m_count;
+                for(const ScriptOp* op = m_ops;op<end;op++) {
+                    switch(op->code) {
+                        case OP_NUMBER:
+                            stack[sp++] = op->number;
+                            break;
+                        case OP_VALUE:
+                            stack[sp++] = op->cached ? op->result : op->value->getFloatValue(cmd,op->number);
+                            break;
+                        case OP_VALUE_INT:
+                            stack[sp++] = op->cached ? op->result : op->value->getIntValue(cmd,(int)op->number);
+                            break;
+                        case OP_TRUNC:
+                            stack[sp-1] = (int)stack[sp-1];
+                            break;
+                        case OP_ADD:
+                            sp--;
+                            stack[sp-1] = stack[sp-1] + stack[sp];
+                            break;
+                        case OP_SUB:
+                            sp--;
+                            stack[sp-1] = stack[sp-1] - stack[sp];
+                            break;
+                        case OP_MUL:
+                            sp--;
+                            stack[sp-1] = stack[sp-1] * stack[sp];
+                            break;
+                        case OP_DIV:
+                            sp--;
+                            stack[sp-1] = stack[sp] == 0 ? 0 : stack[sp-1] / stack[sp];
+                            break;
+                        case OP_MOD:
+                            sp--;
+                            stack[sp-1] = (int)stack[sp] == 0 ? 0 : (double)((int)stack[sp-1] % (int)stack[sp]);
+                            break;
+                        case OP_MIN:
+                            sp--;
+                            stack[sp-1] = stack[sp-1] < stack[sp] ? stack[sp-1] : stack[sp];
+                            break;
+                        case OP_MAX:
+                            sp--;
+                            stack[sp-1] = stack[sp-1] > stack[sp] ? stack[sp-1] : stack[sp];
+                            break;
+                        case OP_RANGE:
+                            sp--;
+                            stack[sp-1] = positionRange(domain,stack[sp-1],stack[sp]);
+                            break;
+                        case OP_HUE: {
+                            int hue = (int)stack[--sp];
+                            if (hue >= 0) {
+                                if (m_hueMap) {
+                                    hue = m_hueMap->calculate(1.0*hue/360.0)*(360);
+                                }
+                                position->ScriptPosition::setHue(index,hue,operation);
+                            }
+                            break;
+                        }
+                        case OP_LIGHTNESS: {
+                            int lightness = (int)stack[--sp];
+                            if (lightness >= 0) {
+                                position->ScriptPosition::setLightness(index,lightness,operation);
+                            }
+                            break;
+                        }
+                        case OP_SATURATION: {
+                            int saturation = (int)stack[--sp];
+                            if (saturation >= 0) {
+                                position->ScriptPosition::setSaturation(index,saturation,operation);
+                            }
+                            break;
+                        }
+                        case OP_RGB: {
+                            sp -= 3;
+                            CRGB rgb((int)stack[sp],(int)stack[sp+1],(int)stack[sp+2]);
+                            position->ScriptPosition::setRGB(index,rgb,operation);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            // same result as ScriptRangeValue with no animator: the default
+            // CubicBezierEase over the command's position domain
+            static double positionRange(PositionDomain* domain, double start, double end) {
+                double ease = RangeEase.calculate(domain->getPosition());
+                if (ease <= 0 || start == end) {
+                    return start;
+                }
+                if (ease >= 1) {
+                    return end;
+                }
+                return start + ease*(end-start);
+            }
+
+        private:
+            static int stackChange(ScriptOpCode code) {
+                switch(code) {
+                    case OP_NUMBER:
+                    case OP_VALUE:
+                    case OP_VALUE_INT:
+                        return 1;
+                    case OP_TRUNC:
+                        return 0;
+                    case OP_RGB:
+                        return -3;
+                    default:
+                        return -1;
+                }
+            }
+
+            Logger* m_logger;
+            ScriptOp* m_ops;
+            int m_count;
+            int m_capacity;
+            int m_depth;
+            int m_maxDepth;
+            bool m_valid;
+            AnimationEase* m_hueMap;
+            int m_valueCount;
+    };
+    bool ScriptNumberValue::compile(ScriptProgram* program, double defaultValue) {
+        program->addNumber(m_value);
+        return true;
+    }
+
+    bool ScriptBoolValue::compile(ScriptProgram* program, double defaultValue) {
+        program->addNumber(m_value ? 1 : 0);
+        return true;
+    }
+
+    bool ScriptNullValue::compile(ScriptProgram* program, double defaultValue) {
+        program->addNumber(defaultValue);
+        return true;
+    }
+
+    bool ScriptFunction::compile(ScriptProgram* program, double defaultValue) {
+        ScriptFunctionHandler handler = m_function->handler;
+        ScriptOpCode code;
+        if (handler == ScriptFunctionRegistry::add) {
+            code = OP_ADD;
+        } else if (handler == ScriptFunctionRegistry::subtract) {
+            code = OP_SUB;
+        } else if (handler == ScriptFunctionRegistry::multiply) {
+            code = OP_MUL;
+        } else if (handler == ScriptFunctionRegistry::divide) {
+            code = OP_DIV;
+        } else if (handler == ScriptFunctionRegistry::mod) {
+            code = OP_MOD;
+        } else if (handler == ScriptFunctionRegistry::minimum) {
+            code = OP_MIN;
+        } else if (handler == ScriptFunctionRegistry::maximum) {
+            code = OP_MAX;
+        } else {
+            // rand, randOf, seq and registered functions are called as values
+            return false;
+        }
+        program->compileFloat(m_args ? m_args->get(0) : NULL,defaultValue);
+        program->compileFloat(m_args ? m_args->get(1) : NULL,defaultValue);
+        program->add(code);
+        return true;
+    }
+
+    bool ScriptRangeValue::compile(ScriptProgram* program, double defaultValue) {
+        if (m_animate) {
+            return false;
+        }
+        if (m_start == NULL) {
+            if (m_end) {
+                program->compileInt(m_end,defaultValue);
+            } else {
+                program->addNumber(defaultValue);
+            }
+        } else if (m_end == NULL) {
+            program->compileInt(m_start,defaultValue);
+        } else {
+            program->compileFloat(m_start,0);
+            program->compileFloat(m_end,1);
+            program->add(OP_RANGE);
+        }
+        return true;
+    }
+}
+#endif
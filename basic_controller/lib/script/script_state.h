@@ -10,6 +10,7 @@
 #include "../led_strip.h"
 #include "./script_interface.h"
 #include "./animation.h"
+#include "../pool.h"
 
 namespace DevRelief
 {
@@ -18,7 +19,7 @@ namespace DevRelief
     class ScriptState : public IScriptState, IScriptValueProvider
     {
     public:
-        ScriptState() 
+        ScriptState(ScriptSymbolTable* symbols=NULL) 
         {
             memLogger->debug("create ScriptState");
             m_logger = &ScriptStateLogger;
@@ -28,7 +29,7 @@ namespace DevRelief
             m_lastStepTime = 0;
             m_stepNumber = 0;
             m_stepStartTime = 0;
-            m_values = new ScriptValueList();
+            m_symbols = symbols;
             
             m_currentCommand = NULL;
             m_currentContainer = NULL;
@@ -38,7 +39,6 @@ namespace DevRelief
         virtual ~ScriptState()
         {
             memLogger->debug("~ScriptState");
-            m_values->destroy();
         }
 
         void destroy() override { 
@@ -92,31 +92,36 @@ namespace DevRelief
         int getStepNumber() override { return m_stepNumber;}
         IScriptCommand * getCurrentCommand() { return m_currentCommand;}
         void setCurrentCommand(IScriptCommand*cmd) { 
-            m_logger->never("current command 0x%04X",cmd);
+            DRLOG_NEVER("current command 0x%04X",cmd);
             m_currentCommand = cmd;
         }
 
         IScriptCommand * getPreviousCommand() { return m_previousCommand;}
         void setPreviousCommand(IScriptCommand*cmd) { 
-            m_logger->never("Previous command 0x%04X",cmd);
+            DRLOG_NEVER("Previous command 0x%04X",cmd);
             m_previousCommand = cmd;
         }
 
                 /* IScriptValueProvider */
         bool hasValue(const char *name) override
         {
-            return m_values == NULL ? false : m_values->hasValue(name) != NULL;
+            return m_values.hasValue(name);
         }
 
         IScriptValue *getValue(const char *name) override
         {
-            m_logger->never("getvalue %s",name);
+            DRLOG_NEVER("getvalue %s",name);
 
-            IScriptValue* val =  m_values == NULL ? NULL : m_values->getValue(name);
-            m_logger->never("\tgot %x",val);
+            IScriptValue* val = m_values.getValue(name);
+            DRLOG_NEVER("\tgot %x",val);
             return val;
         }
 
+        IScriptValue *getSymbolValue(int symbol) override
+        {
+            return m_values.getSymbolValue(symbol);
+        }
+
         int getIntValue(const char * name,int defaultValue) {
             IScriptValue* sv = getValue(name);
             if (sv == NULL) { return defaultValue;}
@@ -124,20 +129,22 @@ namespace DevRelief
         }
 
         void setValue(void*owner, const char * valueName, IScriptValue* val) {
-            DRFormattedString fullName("%04x-%s",owner,valueName);
-            m_values->addValue(fullName.get(),val);
+            m_values.addValue(ScriptValueKey{owner,valueName},val);
         }
 
-        void setValue(const char * valueName, IScriptValue* val) {
-            m_values->addValue(valueName,val);
+        void setValue(const char * valueName, IScriptValue* val, int symbol=NO_SCRIPT_SYMBOL) {
+            if (symbol == NO_SCRIPT_SYMBOL && m_symbols != NULL) {
+                symbol = m_symbols->intern(valueName);
+            }
+            m_values.addValue(valueName,val,symbol);
         }
 
         IScriptValue* getValue(void* owner,const char * valueName){
-            DRFormattedString fullName("%04x-%s",owner,valueName);
-            return getValue(fullName.get());
+            return m_values.getValue(ScriptValueKey{owner,valueName});
         }
         
         IScriptState* createChild();
+        IScriptState* createChild(ObjectPool<ChildState>* pool);
     protected:
         friend Script;
         friend ChildState;
@@ -165,7 +172,9 @@ namespace DevRelief
         Script *m_script;
         IScriptCommand* m_previousCommand;
 
-        ScriptValueList *m_values;
+        // part of the state so a pooled ChildState does not allocate it
+        ScriptValueList m_values;
+        ScriptSymbolTable* m_symbols;
         IScriptCommand* m_currentCommand;
         IHSLStrip * m_strip;
         IScriptCommand* m_currentContainer;
@@ -173,22 +182,33 @@ namespace DevRelief
 
     class ChildState : public ScriptState {
         public:
-            ChildState(ScriptState* parent) {
+            ChildState(ScriptState* parent, ObjectPool<ChildState>* pool=NULL) {
                 m_parent = parent;
+                m_pool = pool;
                 m_stepNumber = 0;
                 m_logger = parent->m_logger;
                 m_startTime = millis();
                 m_strip = parent->getStrip();
                 m_lastStepTime = 0;
                 m_script = parent->m_script;
+                m_symbols = parent->m_symbols;
                 m_previousCommand = NULL;
                 m_currentCommand = NULL;
                 m_currentContainer = parent->getContainer();
-                m_logger->never("Created ChildState 0x%x 0x%x",m_strip,m_currentContainer);
+                DRLOG_NEVER("Created ChildState 0x%x 0x%x",m_strip,m_currentContainer);
+            }
+
+            void destroy() override {
+                if (m_pool) {
+                    m_pool->release(this);
+                } else {
+                    delete this;
+                }
             }
 
         protected:
             IScriptState* m_parent;
+            ObjectPool<ChildState>* m_pool;
     };
 
    
@@ -196,5 +216,10 @@ namespace DevRelief
         ChildState* child = new ChildState(this);
         return child;
     }
+
+    IScriptState*   ScriptState::createChild(ObjectPool<ChildState>* pool) {
+        void* memory = pool->allocate();
+        return memory == NULL ? NULL : new (memory) ChildState(this,pool);
+    }
 }
 #endif
\ No newline at end of file
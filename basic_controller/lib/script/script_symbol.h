@@ -0,0 +1,95 @@
+#ifndef DRSCRIPT_SYMBOL_H
+#define DRSCRIPT_SYMBOL_H
+
+#include "../logger.h"
+#include "../util.h"
+
+namespace DevRelief
+{
+    #define NO_SCRIPT_SYMBOL -1
+
+    struct ScriptSymbol {
+        char * name;
+        bool referenced;   // read by a var() in the script
+    };
+
+    /* ScriptSymbolTable interns every value name a script uses to a small integer.
+     * ScriptDataLoader fills it while building the script so ScriptValueList,
+     * ScriptState and ScriptVariableValue can look values up by slot index
+     * instead of comparing strings every frame.  Each Script owns its table;
+     * symbols are only meaningful within that script.
+     */
+    class ScriptSymbolTable {
+        public:
+            ScriptSymbolTable() {
+                m_symbols = NULL;
+                m_count = 0;
+                m_capacity = 0;
+            }
+
+            ~ScriptSymbolTable() {
+                for(int i=0;i<m_count;i++) {
+                    free(m_symbols[i].name);
+                }
+                if (m_symbols) { free(m_symbols);}
+            }
+
+            // return the symbol for name, adding it if needed.  only called while loading
+            int intern(const char * name) {
+                if (Util::isEmpty(name)) {
+                    return NO_SCRIPT_SYMBOL;
+                }
+                int symbol = find(name);
+                if (symbol != NO_SCRIPT_SYMBOL) {
+                    return symbol;
+                }
+                if (m_count == m_capacity) {
+                    int capacity = m_capacity == 0 ? 8 : m_capacity*2;
+                    ScriptSymbol* symbols = (ScriptSymbol*)realloc(m_symbols,capacity*sizeof(ScriptSymbol));
+                    if (symbols == NULL) {
+                        return NO_SCRIPT_SYMBOL;
+                    }
+                    m_symbols = symbols;
+                    m_capacity = capacity;
+                }
+                m_symbols[m_count].name = strdup(name);
+                m_symbols[m_count].referenced = false;
+                return m_count++;
+            }
+
+            // intern a name that is read by the script
+            int reference(const char * name) {
+                int symbol = intern(name);
+                if (symbol != NO_SCRIPT_SYMBOL) {
+                    m_symbols[symbol].referenced = true;
+                }
+                return symbol;
+            }
+
+            bool isReferenced(int symbol) {
+                return symbol >= 0 && symbol < m_count && m_symbols[symbol].referenced;
+            }
+
+            int find(const char * name) {
+                if (name == NULL) { return NO_SCRIPT_SYMBOL;}
+                for(int i=0;i<m_count;i++) {
+                    if (strcmp(m_symbols[i].name,name)==0) {
+                        return i;
+                    }
+                }
+                return NO_SCRIPT_SYMBOL;
+            }
+
+            const char * getName(int symbol) {
+                return symbol >= 0 && symbol < m_count ? m_symbols[symbol].name : NULL;
+            }
+
+            int getCount() { return m_count;}
+
+        private:
+            ScriptSymbol* m_symbols;
+            int m_count;
+            int m_capacity;
+    };
+}
+#endif
@@ -6,6 +6,7 @@
 #include "../list.h"
 #include "../ensure.h"
 #include "./script_interface.h"
+#include "./script_function.h"
 #include "./animation.h"
 
 namespace DevRelief
@@ -21,6 +22,9 @@ namespace DevRelief
             void destroy() override { delete this;}
 
             bool isRecursing() override { return false;}
+            bool isConstant() override { return false;}
+            // values that do not know better are evaluated for each LED
+            ScriptValueScope getScope(IScriptCommand* cmd) override { return SCOPE_LED;}
 
             bool isString(IScriptCommand* cmd)  override{
               return false;  
@@ -39,6 +43,8 @@ namespace DevRelief
             bool equals(IScriptCommand*cmd,const char * match) override { return false;}
 
             IScriptValue* eval(IScriptCommand * cmd, double defaultValue=0) override;
+
+            bool compile(ScriptProgram* program, double defaultValue) override { return false;}
             
         protected:
             Logger* m_logger;
@@ -56,8 +62,11 @@ namespace DevRelief
                 } else {
                     m_name = buf.getAt(0);
                 }
+                m_value = ScriptFunctions.findSystemValue(m_name);
             }
 
+            bool isKnown() { return m_value != NULL;}
+
             int getIntValue(IScriptCommand* cmd,  int defaultValue) override
             {
                 return (int)getFloatValue(cmd,(double)defaultValue);
@@ -76,6 +85,9 @@ namespace DevRelief
         
         int getMsecValue(IScriptCommand* cmd,  int defaultValue) override { return defaultValue;}
         bool isNumber(IScriptCommand* cmd) override { return true;}
+        ScriptValueScope getScope(IScriptCommand* cmd) override {
+            return m_value == NULL || m_value->handler == NULL ? SCOPE_CONSTANT : SCOPE_FRAME;
+        }
 
 
 
@@ -83,48 +95,45 @@ namespace DevRelief
         private:
             double get(IScriptCommand* cmd, double defaultValue){
                 double val = defaultValue;
-                if (Util::equal(m_name,"start")) {
-                    val = cmd->getState()->getStrip()->getStart();
-                } else if (Util::equal(m_name,"count")) {
-                    val = cmd->getState()->getStrip()->getCount();
-                } else if (Util::equal(m_name,"step")) {
-                    val = cmd->getState()->getStepNumber();
-                } else if (Util::equal(m_name,"red")) {
-                    val = HUE::RED;
-                }  else if (Util::equal(m_name,"orange")) {
-                    val = HUE::ORANGE;
-                }  else if (Util::equal(m_name,"yellow")) {
-                    val = HUE::YELLOW;
-                }  else if (Util::equal(m_name,"green")) {
-                    val = HUE::GREEN;
-                }  else if (Util::equal(m_name,"cyan")) {
-                    val = HUE::CYAN;
-                }  else if (Util::equal(m_name,"blue")) {
-                    val = HUE::BLUE;
-                }  else if (Util::equal(m_name,"magenta")) {
-                    val = HUE::MAGENTA;
-                }  else if (Util::equal(m_name,"purple")) {
-                    val = HUE::PURPLE;
-                } 
-
-
-                m_logger->never("SystemValue %s:%s %f",m_scope.get(),m_name.get(),val);
+                if (m_value != NULL) {
+                    val = m_value->handler ? m_value->handler(cmd,defaultValue) : m_value->value;
+                }
+                DRLOG_NEVER("SystemValue %s:%s %f",m_scope.get(),m_name.get(),val);
                 return val;
             }
             DRString m_scope;
             DRString m_name;
+            const ScriptSystemValueDef* m_value;
 
 
     };
   
-    class NameValue
+    // a value set by one object (a command or animation) so objects using
+    // the same name do not see each other's values.  owner is NULL for
+    // ordinary script values
+    struct ScriptValueKey {
+        const void* owner;
+        const char* name;
+    };
+
+    class NameValue : public ArenaObject
     {
     public:
-        NameValue(const char *name, IScriptValue *value)
+        NameValue(const char *name, IScriptValue *value, int symbol=NO_SCRIPT_SYMBOL)
         {
             ScriptMemoryLogger.debug("NameValue %s", name);
-            m_name = name;
+            m_name = DRString::intern(name);
+            m_owner = NULL;
             m_value = value;
+            m_symbol = symbol;
+        }
+
+        NameValue(const ScriptValueKey& key, IScriptValue *value)
+        {
+            m_name = DRString::intern(key.name);
+            m_owner = key.owner;
+            m_value = value;
+            m_symbol = NO_SCRIPT_SYMBOL;
         }
 
         virtual ~NameValue()
@@ -136,30 +145,29 @@ namespace DevRelief
         virtual void destroy() { delete this;}
 
         const char *getName() { return m_name.text(); }
+        const void *getOwner() { return m_owner;}
         IScriptValue *getValue() { return m_value; }
+        int getSymbol() { return m_symbol;}
+
+        // names are interned so a name from the same script is the same pointer
+        bool matches(const ScriptValueKey& key) {
+            return m_owner == key.owner && (m_name.text() == key.name || strcmp(m_name.text(),key.name)==0);
+        }
 
     private:
         DRString m_name;
+        const void* m_owner;
         IScriptValue *m_value;
+        int m_symbol;
     };
     // ScriptVariableGenerator: ??? rand, trig, ...
-    class FunctionArgs {
-        public:
-            FunctionArgs() {}
-            virtual ~FunctionArgs() {}
-
-            void add(IScriptValue* val) { args.add(val);}
-            IScriptValue* get(int index) { return args.get(index);}
-            size_t length() { return args.size();}
-        PtrList<IScriptValue*> args;
-    };
-
     int randTotal = millis();
 
     class ScriptFunction : public ScriptValue
     {
     public:
-        ScriptFunction(const char *name, FunctionArgs* args) : m_name(name), m_args(args)
+        // the loader resolves and checks the function.  args can be NULL if it takes none
+        ScriptFunction(const ScriptFunctionDef* function, FunctionArgs* args) : m_name(function->name), m_function(function), m_args(args)
         {
             memLogger->debug("ScriptVariableValue()");
             randomSeed(analogRead(0)+millis());
@@ -189,138 +197,56 @@ namespace DevRelief
 
         DRString toString() { return DRString("Function: ").append(m_name); }
         int getMsecValue(IScriptCommand* cmd,  int defaultValue) override { 
-            if (Util::equal("millis",m_name)) {
-                return millis();
+            if (m_function->flags & SCRIPT_FUNCTION_MSECS) {
+                return invoke(cmd,defaultValue);
             }
             return defaultValue;
         }
         bool isNumber(IScriptCommand* cmd) override { return true;}
-        
-    protected:
-        double invoke(IScriptCommand * cmd,double defaultValue) {
-            double result = 0;
-            const char * name = m_name.get();
-            if (Util::equal("rand",name)){
-                result = invokeRand(cmd,defaultValue);
-            } else if (Util::equal("add",name) || Util::equal("+",name)) {
-                result = invokeAdd(cmd,defaultValue);
-            } else if (Util::equal("subtract",name) ||Util::equal("sub",name) || Util::equal("-",name)) {
-                result = invokeSubtract(cmd,defaultValue);
-            } else if (Util::equal("multiply",name) || Util::equal("mult",name) || Util::equal("*",name)) {
-                result = invokeMultiply(cmd,defaultValue);
-            } else if (Util::equal("divide",name) || Util::equal("div",name) || Util::equal("/",name)) {
-                result = invokeDivide(cmd,defaultValue);
-            } else if (Util::equal("mod",name) || Util::equal("%",name)) {
-                result = invokeMod(cmd,defaultValue);
-            } else if (Util::equal("min",name)) {
-                result = invokeMin(cmd,defaultValue);
-            } else if (Util::equal("max",name)) {
-                result = invokeMax(cmd,defaultValue);
-            } else if (Util::equal("randOf",name)) {
-                result = invokeRandomOf(cmd,defaultValue);
-            } else if (Util::equal("seq",name)||Util::equal("sequence",name)) {
-                result = invokeSequence(cmd,defaultValue);
-            } else {
-                m_logger->error("unknown function: %s",name);
-            }
-            m_logger->never("function: %s=%f",m_name.get(),result);
-            return result;
-        }
 
-        double invokeRand(IScriptCommand*cmd ,double defaultValue) {
-            int low = getArgValue(cmd,0,0);
-            int high = getArgValue(cmd, 1,low);
-            if (high == low) {
-                low = 0;
+        ScriptValueScope getScope(IScriptCommand* cmd) override {
+            ScriptValueScope scope;
+            if (m_function->flags & SCRIPT_FUNCTION_PURE) {
+                scope = SCOPE_CONSTANT;
+            } else if (m_function->flags & SCRIPT_FUNCTION_FRAME) {
+                scope = SCOPE_FRAME;
+            } else {
+                // rand, randOf and seq give a new result each call
+                return SCOPE_LED;
             }
-            if (high < low) {
-                int t = low;
-                low = high;
-                high = t;
+            int count = m_args ? m_args->length() : 0;
+            for(int i=0;i<count && scope != SCOPE_LED;i++) {
+                scope = combineScope(scope,m_args->get(i),cmd);
             }
-            int val = random(low,high+1);
-            return val;
-            
+            return scope;
         }
 
-        double invokeAdd(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return first + second;
-        }
-
-        double invokeSubtract(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return first - second;
-        }
+        bool compile(ScriptProgram* program, double defaultValue) override;
 
-        double invokeMultiply(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return first * second;
-        }
-
-        double invokeDivide(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return (second == 0) ? 0 : first / second;
-        }
-
-        
-        double invokeMod(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return (double)((int)first % (int)second);
-        }
-        
-        double invokeMin(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return first < second ? first : second;
-        }
-        
-        double invokeMax(IScriptCommand*cmd,double defaultValue) {
-            double first = getArgValue(cmd,0,defaultValue);
-            double second = getArgValue(cmd,1,defaultValue);
-            return first > second ? first : second;
-        }
-
-        double invokeRandomOf(IScriptCommand*cmd,double defaultValue) {
-            int count = m_args->length();
-            int idx = random(count);
-            return getArgValue(cmd,idx,defaultValue);
-        }
-
-        double invokeSequence(IScriptCommand*cmd,double defaultValue) {
-            
-            int start = getArgValue(cmd,0,0);
-            int end = getArgValue(cmd,1,100);
-            int step = getArgValue(cmd,2,1);
-
-            if (m_funcState < start){ 
-                m_funcState = start;
-            } else {
-                m_funcState += step;
+        // a pure function with constant arguments always has the same result
+        bool isFoldable() {
+            if ((m_function->flags & SCRIPT_FUNCTION_PURE) == 0) {
+                return false;
             }
-            if (m_funcState > end){
-                m_funcState = start;
+            int count = m_args ? m_args->length() : 0;
+            for(int i=0;i<count;i++) {
+                IScriptValue* arg = m_args->get(i);
+                if (arg == NULL || !arg->isConstant()) {
+                    return false;
+                }
             }
-
-            m_logger->never("Sequence %d %d %d ==> %f",start,end,step,m_funcState);
-            return m_funcState;
+            return true;
         }
-
-        double getArgValue(IScriptCommand*cmd, int idx, double defaultValue){
-            if (m_args == NULL) {
-                return defaultValue;
-            }
-            IScriptValue* val = m_args->get(idx);
-            if (val == NULL) { return defaultValue;}
-            return val->getFloatValue(cmd,defaultValue);
+        
+    protected:
+        double invoke(IScriptCommand * cmd,double defaultValue) {
+            double result = m_function->handler(cmd,m_args,m_funcState,defaultValue);
+            DRLOG_NEVER("function: %s=%f",m_name.get(),result);
+            return result;
         }
 
         DRString m_name;
+        const ScriptFunctionDef* m_function;
         FunctionArgs * m_args;
         double m_funcState; // different functions can use in their way
     };
@@ -363,10 +289,14 @@ namespace DevRelief
         int getMsecValue(IScriptCommand* cmd,  int defaultValue) override { 
             return m_value;
         }
+        bool isConstant() override { return true;}
+        ScriptValueScope getScope(IScriptCommand* cmd) override { return SCOPE_CONSTANT;}
         bool isNumber(IScriptCommand* cmd) override { return true;}
 
         virtual DRString toString() { return DRString::fromFloat(m_value); }
 
+        bool compile(ScriptProgram* program, double defaultValue) override;
+
     protected:
         double m_value;
     };
@@ -377,12 +307,12 @@ namespace DevRelief
         ScriptBoolValue(bool value) : m_value(value)
         {
             memLogger->debug("ScriptBoolValue()");
-            m_logger->debug("ScriptBoolValue()");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptBoolValue()");
         }
 
         virtual ~ScriptBoolValue()
         {
-            m_logger->debug("~ScriptBoolValue()");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"~ScriptBoolValue()");
             memLogger->debug("~ScriptBoolValue()");
         }
 
@@ -404,13 +334,17 @@ namespace DevRelief
             return defaultValue;
         }
         bool isBool(IScriptCommand* cmd) override { return true;}
+        bool isConstant() override { return true;}
+        ScriptValueScope getScope(IScriptCommand* cmd) override { return SCOPE_CONSTANT;}
+
+        bool compile(ScriptProgram* program, double defaultValue) override;
 
         DRString toString() override { 
-            m_logger->debug("ScriptBoolValue.toString()");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptBoolValue.toString()");
             const char * val =  m_value ? "true":"false"; 
-            m_logger->debug("\tval=%s",val);
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tval=%s",val);
             DRString drv(val);
-            m_logger->debug("\tcreated DRString");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tcreated DRString");
             return drv;
         }
 
@@ -425,15 +359,17 @@ namespace DevRelief
         ScriptNullValue() 
         {
             memLogger->debug("ScriptNullValue()");
-            m_logger->debug("ScriptNullValue()");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptNullValue()");
         }
 
         virtual ~ScriptNullValue()
         {
-            m_logger->debug("~ScriptNullValue()");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"~ScriptNullValue()");
             memLogger->debug("~ScriptNullValue()");
         }
 
+        ScriptValueScope getScope(IScriptCommand* cmd) override { return SCOPE_CONSTANT;}
+
         int getIntValue(IScriptCommand* cmd,  int defaultValue) override
         {
             return defaultValue;
@@ -457,10 +393,12 @@ namespace DevRelief
             return true;  
         } 
 
+        bool compile(ScriptProgram* program, double defaultValue) override;
+
         DRString toString() override { 
-            m_logger->debug("ScriptNulllValue.toString()");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptNulllValue.toString()");
             DRString drv("ScriptNullValue");
-            m_logger->debug("\tcreated DRString");
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tcreated DRString");
             return drv;
         }
 
@@ -475,7 +413,7 @@ namespace DevRelief
         ScriptStringValue(const char *value) : m_value(value)
         {
             memLogger->debug("ScriptStringValue()");
-            m_logger->debug("ScriptStringValue 0x%04X %s",this,value);
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"ScriptStringValue 0x%04X %s",this,value);
         }
 
         virtual ~ScriptStringValue()
@@ -483,6 +421,8 @@ namespace DevRelief
             memLogger->debug("~ScriptStringValue()");
         }
 
+        ScriptValueScope getScope(IScriptCommand* cmd) override { return SCOPE_CONSTANT;}
+
         int getIntValue(IScriptCommand* cmd,  int defaultValue) override
         {
             const char *n = m_value.text();
@@ -514,7 +454,7 @@ namespace DevRelief
         }
 
         bool equals(IScriptCommand*cmd, const char * match) override { 
-            m_logger->never("ScriptStringValue.equals %s==%s",m_value.get(),match);
+            DRLOG_NEVER("ScriptStringValue.equals %s==%s",m_value.get(),match);
             return Util::equal(m_value.text(),match);
         }
 
@@ -555,6 +495,19 @@ namespace DevRelief
         }
         bool isNumber(IScriptCommand* cmd) override { return true;}
 
+        // without an animator the range is over the LED position
+        ScriptValueScope getScope(IScriptCommand* cmd) override {
+            if (m_start == NULL || m_end == NULL) {
+                return combineScope(SCOPE_CONSTANT,m_start ? m_start : m_end,cmd);
+            }
+            if (m_animate == NULL) {
+                return SCOPE_LED;
+            }
+            ScriptValueScope scope = m_animate->getScope(cmd);
+            scope = combineScope(scope,m_start,cmd);
+            return combineScope(scope,m_end,cmd);
+        }
+
         virtual int getIntValue(IScriptCommand* cmd,  int defaultValue)
         {
             return (int)getFloatValue(cmd,(double)defaultValue);
@@ -564,12 +517,12 @@ namespace DevRelief
         {
             if (m_start == NULL)
             {
-                m_logger->debug("\tno start.  return end %f");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tno start.  return end %f");
                 return m_end ? m_end->getIntValue(cmd, defaultValue) : defaultValue;
             }
             else if (m_end == NULL)
             {
-                m_logger->debug("\tno end.  return start %f");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"\tno end.  return start %f");
                 return m_start ? m_start->getIntValue(cmd, defaultValue) : defaultValue;
             }
             double start = m_start->getFloatValue(cmd, 0);
@@ -588,7 +541,7 @@ namespace DevRelief
                 value = animator.get(range,cmd);
                 
             }
-            m_logger->never("Range %f-%f got %f",start,end,value);
+            DRLOG_NEVER("Range %f-%f got %f",start,end,value);
             return value;
   
         }
@@ -602,7 +555,7 @@ namespace DevRelief
 
         virtual DRString toString()
         {
-            m_logger->never("format range DRString");
+            DRLOG_NEVER("format range DRString");
             DRString result("range:");
             result.append(m_start ? m_start->toString() : "NULL")
                 .append("--")
@@ -614,6 +567,8 @@ namespace DevRelief
             m_animate = animator;
         }
 
+        bool compile(ScriptProgram* program, double defaultValue) override;
+
         IScriptValue* eval(IScriptCommand * cmd, double defaultValue=0) override{
             auto start = m_start ? m_start->eval(cmd,defaultValue) : NULL;
             auto end = m_end ? m_end->eval(cmd,defaultValue) : NULL;
@@ -631,7 +586,7 @@ namespace DevRelief
 
 
 
-    class ScriptPatternElement
+    class ScriptPatternElement : public ArenaObject
     {
     public:
         ScriptPatternElement(int repeatCount, IScriptValue* value)
@@ -657,12 +612,17 @@ namespace DevRelief
         int m_repeatCount;
     };
 
-    typedef enum PatternExtend {
+    enum PatternExtend {
         REPEAT_PATTERN=0,
         STRETCH_PATTERN=1,
         NO_EXTEND=2
     };
 
+    // patterns up to this many LEDs map each LED to its element with a byte table
+    #define PATTERN_MAP_MAX_COUNT 256
+    // patterns of constant values up to this many LEDs keep each LED's value
+    #define PATTERN_CACHE_MAX_COUNT 128
+
    class PatternValue : public ScriptValue
     {
     public:
@@ -672,12 +632,16 @@ namespace DevRelief
             m_animate = animate;
             m_extend = REPEAT_PATTERN;
             m_count = 0;
-
+            m_ends = NULL;
+            m_elementAt = NULL;
+            m_cache = NULL;
+            m_lookupBuilt = false;
         }
 
         virtual ~PatternValue()
         {
             memLogger->debug("~PatternValue() start");
+            freeLookup();
             if (m_animate) {m_animate->destroy();}
             memLogger->debug("~PatternValue() end");
         }
@@ -693,6 +657,7 @@ namespace DevRelief
             }
             m_elements.add(element);
             m_count += element->getRepeatCount();
+            freeLookup();
         }
 
         int getMsecValue(IScriptCommand* cmd,  int defaultValue) override { 
@@ -734,18 +699,23 @@ namespace DevRelief
             
             int index = pos % m_count;
             if (m_extend == STRETCH_PATTERN) {
-                double pct = (index*1.0/m_count);   
                 double domainVal = domain->getPosition();
                 index = m_count * domainVal;
-
+                // the end of the domain is the last LED of the pattern
+                if (index >= (int)m_count) {
+                    index = m_count-1;
+                } else if (index < 0) {
+                    index = 0;
+                }
             }
-            int elementIndex = 0;
-            ScriptPatternElement* element = m_elements.get(0);
-            while(index >= element->getRepeatCount()) {
-                elementIndex ++;
-                index -= element->getRepeatCount();
-                element = m_elements.get(elementIndex);
+            if (!m_lookupBuilt) {
+                buildLookup(cmd);
             }
+            if (m_cache) {
+                double cached = m_cache[index];
+                return isnan(cached) ? defaultValue : cached;
+            }
+            ScriptPatternElement* element = m_elements.get(elementIndexAt(index));
             IScriptValue* val = element?element->getValue() : NULL;
             if (val == NULL || val->isNull(cmd)) {
                 return defaultValue;
@@ -782,23 +752,114 @@ namespace DevRelief
 
 
     protected:
-        PtrList<ScriptPatternElement*> m_elements;
+        /* the element an LED of the pattern uses.  m_ends holds the running total
+         * of repeat counts so the element is a binary search, or a table read
+         * for patterns up to PATTERN_MAP_MAX_COUNT LEDs.  when every element
+         * is constant the value of each LED is computed once into m_cache
+         * (NAN means the caller's default) and animating only moves the index.
+         * built the first time the pattern is read.
+         */
+        void buildLookup(IScriptCommand* cmd) {
+            freeLookup();
+            m_lookupBuilt = true;
+            int elementCount = m_elements.size();
+            m_ends = (int*)malloc(sizeof(int)*(elementCount > 0 ? elementCount : 1));
+            if (m_ends == NULL) {
+                m_logger->errorNoRepeat("out of memory for pattern lookup");
+                m_lookupBuilt = false;
+                return;
+            }
+            int end = 0;
+            bool constant = true;
+            for(int i=0;i<elementCount;i++) {
+                ScriptPatternElement* element = m_elements.get(i);
+                end += element->getRepeatCount() > 0 ? element->getRepeatCount() : 0;
+                m_ends[i] = end;
+                IScriptValue* val = element->getValue();
+                constant = constant && (val == NULL || val->getScope(cmd) == SCOPE_CONSTANT);
+            }
+            if (m_count <= PATTERN_MAP_MAX_COUNT && elementCount <= 255) {
+                m_elementAt = (uint8_t*)malloc(m_count);
+                if (m_elementAt) {
+                    int element = 0;
+                    for(int index=0;index<(int)m_count;index++) {
+                        while(element < elementCount-1 && index >= m_ends[element]) {
+                            element++;
+                        }
+                        m_elementAt[index] = element;
+                    }
+                }
+            }
+            if (constant && m_count <= PATTERN_CACHE_MAX_COUNT) {
+                m_cache = (double*)malloc(sizeof(double)*m_count);
+                for(int index=0;m_cache && index<(int)m_count;index++) {
+                    ScriptPatternElement* element = m_elements.get(elementIndexAt(index));
+                    IScriptValue* val = element ? element->getValue() : NULL;
+                    m_cache[index] = NAN;
+                    if (val != NULL && !val->isNull(cmd)) {
+                        double value = val->getFloatValue(cmd,0);
+                        // a value that falls back to the default (a string that is not a number) stays NAN
+                        if (value == val->getFloatValue(cmd,1)) {
+                            m_cache[index] = value;
+                        }
+                    }
+                }
+            }
+        }
+
+        int elementIndexAt(int index) {
+            if (m_elementAt) {
+                return m_elementAt[index];
+            }
+            if (m_ends == NULL) {
+                return 0;
+            }
+            // first element that ends after index
+            int low = 0;
+            int high = m_elements.size()-1;
+            while(low < high) {
+                int mid = (low+high)/2;
+                if (m_ends[mid] > index) {
+                    high = mid;
+                } else {
+                    low = mid+1;
+                }
+            }
+            return low;
+        }
+
+        void freeLookup() {
+            free(m_ends);
+            free(m_elementAt);
+            free(m_cache);
+            m_ends = NULL;
+            m_elementAt = NULL;
+            m_cache = NULL;
+            m_lookupBuilt = false;
+        }
+
+        PtrSmallList<ScriptPatternElement*> m_elements;
         size_t m_count;
 
         IValueAnimator* m_animate;
         PatternExtend m_extend;
+        int* m_ends;
+        uint8_t* m_elementAt;
+        double* m_cache;
+        bool m_lookupBuilt;
     };
 
     class ScriptVariableValue : public IScriptValue
     {
     public:
-        ScriptVariableValue(const char *value) : m_name(value)
+        ScriptVariableValue(const char *value) : m_name(DRString::intern(value))
         {
             memLogger->debug("ScriptVariableValue()");
             m_logger = &ScriptLogger;
-            m_logger->debug("Created ScriptVariableValue %s.", value);
+            DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"Created ScriptVariableValue %s.", value);
             m_hasDefaultValue = false;
             m_recurse = false;
+            m_symbol = NO_SCRIPT_SYMBOL;
         }
 
         virtual ~ScriptVariableValue()
@@ -806,6 +867,9 @@ namespace DevRelief
             memLogger->debug("~ScriptVariableValue");
         }
 
+        // the loader sets the interned name so lookups do not compare strings
+        void setSymbol(int symbol) { m_symbol = symbol;}
+
         void setDefaultValue(double val) {
             m_defaultValue = val;
             m_hasDefaultValue = true;
@@ -825,7 +889,7 @@ namespace DevRelief
                 return dv;
             }
             m_recurse = true;
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             if (val != NULL) {
                 dv = val->getFloatValue(cmd,dv);
             }
@@ -836,7 +900,7 @@ namespace DevRelief
         virtual bool getBoolValue(IScriptCommand*cmd,  bool defaultValue) override
         {
             m_recurse = true;
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             bool dv = m_hasDefaultValue ? (m_defaultValue != 0) : defaultValue;
             if (val != NULL) {
                 dv = val->getBoolValue(cmd,dv);
@@ -846,32 +910,32 @@ namespace DevRelief
         }
 
         bool equals(IScriptCommand*cmd, const char * match) override {
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             return val ? val->equals(cmd,match) : false;
         }
 
         int getMsecValue(IScriptCommand* cmd,  int defaultValue) override { 
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
 
             return val ? val->getMsecValue(cmd,defaultValue) : defaultValue;
         }
 
         bool isNumber(IScriptCommand* cmd) { 
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             return val ? val->isNumber(cmd) : false;
 
          }
         bool isString(IScriptCommand* cmd) { 
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             return val ? val->isString(cmd) : false;
 
          }
         bool isBool(IScriptCommand* cmd) { 
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             return val ? val->isBool(cmd) : false;
          }
          bool isNull(IScriptCommand* cmd) { 
-            IScriptValue * val = cmd->getValue(m_name);
+            IScriptValue * val = lookup(cmd);
             return val ? val->isNull(cmd) : false;
          }
 
@@ -883,24 +947,48 @@ namespace DevRelief
         
         virtual DRString toString() { return DRString("Variable: ").append(m_name); }
 
+        // looked up at runtime so it cannot be compiled
+        bool compile(ScriptProgram* program, double defaultValue) override { return false;}
+
         bool isRecursing() { return m_recurse;}
+        bool isConstant() override { return false;}
+
+        // the scope of the value the name resolves to for cmd
+        ScriptValueScope getScope(IScriptCommand* cmd) override {
+            if (m_recurse) {
+                return SCOPE_LED;
+            }
+            m_recurse = true;
+            IScriptValue * val = lookup(cmd);
+            ScriptValueScope scope = val ? val->getScope(cmd) : SCOPE_CONSTANT;
+            m_recurse = false;
+            return scope;
+        }
     protected:
+        IScriptValue* lookup(IScriptCommand* cmd) {
+            return m_symbol == NO_SCRIPT_SYMBOL ? cmd->getValue(m_name) : cmd->getSymbolValue(m_symbol);
+        }
+
         DRString m_name;
+        int m_symbol;
         bool m_hasDefaultValue;
         double m_defaultValue;
         Logger *m_logger;
         bool m_recurse;
     };
 
-    class ScriptValueList : public IScriptValueProvider {
+    class ScriptValueList : public IScriptValueProvider, public ArenaObject {
         public:
             ScriptValueList() {
                 m_logger = &ScriptLogger;
-                m_logger->debug("create ScriptValueList()");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"create ScriptValueList()");
+                m_slots = NULL;
+                m_slotCount = 0;
             }
 
             virtual ~ScriptValueList() {
-                m_logger->debug("delete ~ScriptValueList()");
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"delete ~ScriptValueList()");
+                if (m_slots) { free(m_slots);}
             }
 
             bool hasValue(const char *name) override  {
@@ -908,22 +996,41 @@ namespace DevRelief
             }
             
             IScriptValue *getValue(const char *name)  override {
+                return getValue(ScriptValueKey{NULL,name});
+            }
+
+            IScriptValue *getValue(const ScriptValueKey& key) {
                 NameValue** first = m_values.first([&](NameValue*&nv) {
                     if (!Ensure::notNull(nv,NULL,"NameValue cannot be NULL")){
                         return false;
                     }
-                    return strcmp(nv->getName(),name)==0;
+                    return nv->matches(key);
                 });
                 return first ? (*first)->getValue() : NULL;
             }
 
-            void addValue(const char * name,IScriptValue * value) {
+            // values are indexed by symbol so this is a single array read
+            IScriptValue *getSymbolValue(int symbol) {
+                return symbol >= 0 && symbol < m_slotCount ? m_slots[symbol] : NULL;
+            }
+
+            void addValue(const char * name,IScriptValue * value, int symbol=NO_SCRIPT_SYMBOL) {
                 if (Util::isEmpty(name) || value == NULL) {
                     return;
                 }
-                m_logger->debug("add NameValue %s  0x%04X",name,value);
-                NameValue* nv = new NameValue(name,value);
+                DRLOG_DEBUG(SCRIPT_LOGGER_LEVEL,m_logger,"add NameValue %s  0x%04X",name,value);
+                NameValue* nv = new NameValue(name,value,symbol);
                 m_values.add(nv);
+                if (symbol >= 0) {
+                    setSlot(symbol,value);
+                }
+            }
+
+            void addValue(const ScriptValueKey& key,IScriptValue * value) {
+                if (Util::isEmpty(key.name) || value == NULL) {
+                    return;
+                }
+                m_values.add(new NameValue(key,value));
             }
 
             void each(auto&& lambda) const {
@@ -934,7 +1041,26 @@ namespace DevRelief
 
             int count() { return m_values.size();}
         private:
-            PtrList<NameValue*> m_values;
+            void setSlot(int symbol, IScriptValue* value) {
+                if (symbol >= m_slotCount) {
+                    IScriptValue** slots = (IScriptValue**)realloc(m_slots,(symbol+1)*sizeof(IScriptValue*));
+                    if (slots == NULL) {
+                        m_logger->error("out of memory for ScriptValueList slots");
+                        return;
+                    }
+                    memset(slots+m_slotCount,0,(symbol+1-m_slotCount)*sizeof(IScriptValue*));
+                    m_slots = slots;
+                    m_slotCount = symbol+1;
+                }
+                // getValue(name) returns the first match so keep the first value
+                if (m_slots[symbol] == NULL) {
+                    m_slots[symbol] = value;
+                }
+            }
+
+            PtrSmallList<NameValue*> m_values;
+            IScriptValue** m_slots;
+            int m_slotCount;
             Logger* m_logger;
    };
 
@@ -0,0 +1,351 @@
+#ifndef DR_SCRIPT_CACHE_H
+#define DR_SCRIPT_CACHE_H
+
+#include "./logger.h"
+#include "./buffer.h"
+#include "./parse_gen.h"
+
+namespace DevRelief {
+
+Logger ScriptCacheLogger("ScriptCache",SCRIPT_CACHE_LOGGER_LEVEL);
+
+// changes when the file layout or the events change
+#define SCRIPT_CACHE_FORMAT 1
+#define SCRIPT_CACHE_BUILD_SIZE 16
+const char * SCRIPT_CACHE_EXTENSION = ".bin";
+
+enum ScriptCacheOp {
+    CACHE_START_OBJECT=1,
+    CACHE_END_OBJECT=2,
+    CACHE_START_ARRAY=3,
+    CACHE_END_ARRAY=4,
+    CACHE_KEY=5,        // followed by a string offset
+    CACHE_STRING=6,     // followed by a string offset
+    CACHE_INT=7,        // followed by an int32_t
+    CACHE_FLOAT=8,      // followed by a double
+    CACHE_TRUE=9,
+    CACHE_FALSE=10,
+    CACHE_NULL=11
+};
+
+/* the start of a compiled script file.  the events follow it and the
+ * strings they use are at stringsOffset.  each string is a uint16_t length,
+ * the characters as they were in the JSON and a terminator.  an event refers
+ * to a string by its uint16_t offset in the strings, so each string is
+ * stored once.
+ */
+struct ScriptCacheHeader {
+    char magic[4];
+    uint16_t format;
+    uint16_t stringCount;
+    uint32_t jsonHash;      // DRStringTable::hash() of the JSON text
+    uint32_t jsonLength;
+    uint32_t stringsOffset;
+    uint32_t length;        // the whole file
+    char build[SCRIPT_CACHE_BUILD_SIZE];
+};
+
+const char SCRIPT_CACHE_MAGIC[4] = {'D','R','S','C'};
+
+/* ScriptCacheWriter records the parser events for a script's JSON and
+ * passes them on to the handler building the script, so the first load
+ * writes the cache without reading the JSON twice.
+ */
+class ScriptCacheWriter : public IJsonEventHandler {
+    public:
+        ScriptCacheWriter(uint32_t jsonHash, size_t jsonLength) {
+            m_logger = &ScriptCacheLogger;
+            m_target = NULL;
+            m_failed = false;
+            m_finished = false;
+            m_index = NULL;
+            m_indexSize = 0;
+            m_stringCount = 0;
+            ScriptCacheHeader* header = (ScriptCacheHeader*)append(m_events,sizeof(ScriptCacheHeader));
+            memset(header,0,sizeof(ScriptCacheHeader));
+            memcpy(header->magic,SCRIPT_CACHE_MAGIC,sizeof(header->magic));
+            header->format = SCRIPT_CACHE_FORMAT;
+            header->jsonHash = jsonHash;
+            header->jsonLength = jsonLength;
+            strncpy(header->build,BUILD_VERSION,SCRIPT_CACHE_BUILD_SIZE);
+        }
+
+        ~ScriptCacheWriter() {
+            free(m_index);
+        }
+
+        // events are recorded then passed to target
+        void setTarget(IJsonEventHandler* target) { m_target = target;}
+
+        bool startObject() override { return op(CACHE_START_OBJECT) && (m_target == NULL || m_target->startObject());}
+        bool endObject() override { return op(CACHE_END_OBJECT) && (m_target == NULL || m_target->endObject());}
+        bool startArray() override { return op(CACHE_START_ARRAY) && (m_target == NULL || m_target->startArray());}
+        bool endArray() override { return op(CACHE_END_ARRAY) && (m_target == NULL || m_target->endArray());}
+
+        bool key(const char * name, size_t length) override {
+            op(CACHE_KEY);
+            writeString(name,length);
+            return m_target == NULL || m_target->key(name,length);
+        }
+
+        bool stringValue(const char * value, size_t length) override {
+            op(CACHE_STRING);
+            writeString(value,length);
+            return m_target == NULL || m_target->stringValue(value,length);
+        }
+
+        bool intValue(int value) override {
+            op(CACHE_INT);
+            int32_t i = value;
+            memcpy(append(m_events,sizeof(i)),&i,sizeof(i));
+            return m_target == NULL || m_target->intValue(value);
+        }
+
+        bool floatValue(double value) override {
+            op(CACHE_FLOAT);
+            memcpy(append(m_events,sizeof(value)),&value,sizeof(value));
+            return m_target == NULL || m_target->floatValue(value);
+        }
+
+        bool boolValue(bool value) override {
+            return op(value ? CACHE_TRUE : CACHE_FALSE) && (m_target == NULL || m_target->boolValue(value));
+        }
+
+        bool nullValue() override {
+            return op(CACHE_NULL) && (m_target == NULL || m_target->nullValue());
+        }
+
+        // add the strings to the events.  false if the script cannot be cached
+        bool finish() {
+            if (m_failed || m_finished) {
+                return !m_failed;
+            }
+            size_t stringsOffset = m_events.getLength();
+            size_t stringsLength = m_strings.getLength();
+            if (stringsLength > 0) {
+                memcpy(append(m_events,stringsLength),m_strings.data(),stringsLength);
+            }
+            ScriptCacheHeader* header = (ScriptCacheHeader*)m_events.reserve(0);
+            header->stringCount = m_stringCount;
+            header->stringsOffset = stringsOffset;
+            header->length = m_events.getLength();
+            m_finished = true;
+            return true;
+        }
+
+        // the file after finish()
+        const uint8_t* getData() { return m_events.data();}
+        size_t getLength() { return m_events.getLength();}
+    private:
+        static uint8_t* append(DRBuffer& buffer, size_t length) {
+            size_t used = buffer.getLength();
+            if (used+length > buffer.getMaxLength()) {
+                buffer.reserve((used+length)*2);
+            }
+            uint8_t* data = buffer.reserve(used+length)+used;
+            buffer.setLength(used+length);
+            return data;
+        }
+
+        bool op(ScriptCacheOp code) {
+            *append(m_events,1) = (uint8_t)code;
+            return true;
+        }
+
+        void writeString(const char * text, size_t length) {
+            uint16_t offset = stringOffset(text,length);
+            memcpy(append(m_events,sizeof(offset)),&offset,sizeof(offset));
+        }
+
+        // the offset of the text in m_strings.  added the first time it is used
+        uint16_t stringOffset(const char * text, size_t length) {
+            if (m_stringCount*2 >= m_indexSize && !growIndex()) {
+                m_failed = true;
+                return 0;
+            }
+            size_t slot = DRStringTable::hash(text,length) & (m_indexSize-1);
+            while(m_index[slot] != 0) {
+                uint16_t offset = m_index[slot]-1;
+                if (sameString(offset,text,length)) {
+                    return offset;
+                }
+                slot = (slot+1) & (m_indexSize-1);
+            }
+            size_t offset = m_strings.getLength();
+            if (length > 0xFFFF || offset+sizeof(uint16_t)+length+1 >= 0xFFFF) {
+                m_logger->errorNoRepeat("script has too many strings to cache");
+                m_failed = true;
+                return 0;
+            }
+            uint16_t stringLength = length;
+            uint8_t* data = append(m_strings,sizeof(stringLength)+length+1);
+            memcpy(data,&stringLength,sizeof(stringLength));
+            memcpy(data+sizeof(stringLength),text,length);
+            data[sizeof(stringLength)+length] = 0;
+            m_index[slot] = offset+1;
+            m_stringCount++;
+            return offset;
+        }
+
+        bool sameString(uint16_t offset, const char * text, size_t length) {
+            const uint8_t* data = m_strings.data()+offset;
+            uint16_t stringLength;
+            memcpy(&stringLength,data,sizeof(stringLength));
+            return stringLength == length && memcmp(data+sizeof(stringLength),text,length)==0;
+        }
+
+        bool growIndex() {
+            int indexSize = m_indexSize == 0 ? 32 : m_indexSize*2;
+            uint16_t* index = (uint16_t*)malloc(indexSize*sizeof(uint16_t));
+            if (index == NULL) {
+                m_logger->errorNoRepeat("out of memory for script cache strings");
+                return false;
+            }
+            memset(index,0,indexSize*sizeof(uint16_t));
+            for(int i=0;i<m_indexSize;i++) {
+                if (m_index[i] != 0) {
+                    uint16_t offset = m_index[i]-1;
+                    const uint8_t* data = m_strings.data()+offset;
+                    uint16_t length;
+                    memcpy(&length,data,sizeof(length));
+                    size_t slot = DRStringTable::hash((const char*)data+sizeof(length),length) & (indexSize-1);
+                    while(index[slot] != 0) {
+                        slot = (slot+1) & (indexSize-1);
+                    }
+                    index[slot] = m_index[i];
+                }
+            }
+            free(m_index);
+            m_index = index;
+            m_indexSize = indexSize;
+            return true;
+        }
+
+        Logger* m_logger;
+        IJsonEventHandler* m_target;
+        DRBuffer m_events;      // the header and events.  the whole file after finish()
+        DRBuffer m_strings;
+        uint16_t* m_index;      // offset+1 of each string by hash.  0 is empty
+        int m_indexSize;        // a power of 2
+        int m_stringCount;
+        bool m_failed;
+        bool m_finished;
+};
+
+/* ScriptCacheReader replays the events in a file from ScriptCacheWriter.
+ * the strings given to the handler are in the file's data.
+ */
+class ScriptCacheReader {
+    public:
+        ScriptCacheReader(const uint8_t* data, size_t length) {
+            m_logger = &ScriptCacheLogger;
+            m_data = data;
+            m_length = length;
+        }
+
+        // written by this build from JSON with the hash and length
+        bool isValid(uint32_t jsonHash, size_t jsonLength) {
+            if (m_data == NULL || m_length < sizeof(ScriptCacheHeader)) {
+                return false;
+            }
+            ScriptCacheHeader header;
+            memcpy(&header,m_data,sizeof(header));
+            char build[SCRIPT_CACHE_BUILD_SIZE];
+            memset(build,0,sizeof(build));
+            strncpy(build,BUILD_VERSION,SCRIPT_CACHE_BUILD_SIZE);
+            return memcmp(header.magic,SCRIPT_CACHE_MAGIC,sizeof(header.magic))==0
+                && header.format == SCRIPT_CACHE_FORMAT
+                && memcmp(header.build,build,sizeof(build))==0
+                && header.jsonHash == jsonHash
+                && header.jsonLength == jsonLength
+                && header.length == m_length
+                && header.stringsOffset >= sizeof(ScriptCacheHeader)
+                && header.stringsOffset <= m_length;
+        }
+
+        // call the handler for each event.  false if it returns false or the data is bad
+        bool read(IJsonEventHandler* handler) {
+            ScriptCacheHeader header;
+            memcpy(&header,m_data,sizeof(header));
+            const uint8_t* pos = m_data+sizeof(header);
+            const uint8_t* end = m_data+header.stringsOffset;
+            m_strings = end;
+            m_stringsLength = m_length-header.stringsOffset;
+            while(pos < end) {
+                uint8_t op = *pos++;
+                bool ok = false;
+                switch(op) {
+                    case CACHE_START_OBJECT: ok = handler->startObject(); break;
+                    case CACHE_END_OBJECT: ok = handler->endObject(); break;
+                    case CACHE_START_ARRAY: ok = handler->startArray(); break;
+                    case CACHE_END_ARRAY: ok = handler->endArray(); break;
+                    case CACHE_TRUE: ok = handler->boolValue(true); break;
+                    case CACHE_FALSE: ok = handler->boolValue(false); break;
+                    case CACHE_NULL: ok = handler->nullValue(); break;
+                    case CACHE_KEY:
+                    case CACHE_STRING: {
+                        const char * text;
+                        uint16_t length;
+                        ok = readString(pos,end,text,length)
+                            && (op == CACHE_KEY ? handler->key(text,length) : handler->stringValue(text,length));
+                        break;
+                    }
+                    case CACHE_INT: {
+                        int32_t value;
+                        ok = pos+sizeof(value) <= end;
+                        if (ok) {
+                            memcpy(&value,pos,sizeof(value));
+                            pos += sizeof(value);
+                            ok = handler->intValue(value);
+                        }
+                        break;
+                    }
+                    case CACHE_FLOAT: {
+                        double value;
+                        ok = pos+sizeof(value) <= end;
+                        if (ok) {
+                            memcpy(&value,pos,sizeof(value));
+                            pos += sizeof(value);
+                            ok = handler->floatValue(value);
+                        }
+                        break;
+                    }
+                    default:
+                        m_logger->error("unknown script cache event %d",op);
+                        break;
+                }
+                if (!ok) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        bool readString(const uint8_t*& pos, const uint8_t* end, const char *& text, uint16_t& length) {
+            uint16_t offset;
+            if (pos+sizeof(offset) > end) {
+                return false;
+            }
+            memcpy(&offset,pos,sizeof(offset));
+            pos += sizeof(offset);
+            if ((size_t)offset+sizeof(length) > m_stringsLength) {
+                return false;
+            }
+            memcpy(&length,m_strings+offset,sizeof(length));
+            if ((size_t)offset+sizeof(length)+length >= m_stringsLength) {
+                return false;
+            }
+            text = (const char*)m_strings+offset+sizeof(length);
+            return text[length] == 0;
+        }
+
+        Logger* m_logger;
+        const uint8_t* m_data;
+        size_t m_length;
+        const uint8_t* m_strings;
+        size_t m_stringsLength;
+};
+
+}
+#endif
@@ -11,6 +11,7 @@
 #include "./script/script_position.h"
 #include "./script/json_names.h"
 #include "./data_loader.h"
+#include "./script_cache.h"
 #include "./util.h"
 
 
@@ -20,12 +21,46 @@ Logger ScriptLoaderLogger("ScriptDataLoader",SCRIPT_LOADER_LOGGER_LEVEL);
 const char * SCRIPT_PATH_BASE="/script/";
 
 
+// a value from a "values" object.  ScriptDataLoader holds them until every
+// var() in the script is known so unused values can be dropped
+class ScriptLoaderValue {
+    public:
+        ScriptLoaderValue(ScriptCommandBase* cmd, const char * name, IScriptValue* value, int symbol) : m_name(name) {
+            m_command = cmd;
+            m_value = value;
+            m_symbol = symbol;
+        }
+        void destroy() { delete this;}
+
+        ScriptCommandBase* m_command;
+        DRString m_name;
+        IScriptValue* m_value;
+        int m_symbol;
+};
+
+class ScriptEventHandler;
+
 class ScriptDataLoader : public DataLoader {
     public:
         ScriptDataLoader() {
             m_logger = & ScriptLoaderLogger;
+            m_symbols = NULL;
+            m_dropUnusedValues = true;
+            m_foldCount = 0;
+            m_dropCount = 0;
+            m_loadedFromCache = false;
         }
 
+        // values that no var() reads are dropped unless disabled.  code that reads
+        // values by name after loading (tests) needs to keep them
+        void setDropUnusedValues(bool drop) { m_dropUnusedValues = drop;}
+
+        // optimization counts for the last jsonToScript()
+        int getFoldCount() { return m_foldCount;}
+        int getDropCount() { return m_dropCount;}
+        // the last loadScript() used the compiled script
+        bool wasLoadedFromCache() { return m_loadedFromCache;}
+
 
         bool initialize(Script& script) {
 
@@ -39,20 +74,76 @@ class ScriptDataLoader : public DataLoader {
             m_logger->debug("getPath(%s)==>%s",name,path.text());
             return path;
         }
+
+        // the compiled script is next to the JSON
+        DRString getCachePath(const char * name) {
+            DRString path= SCRIPT_PATH_BASE;
+            path += name;
+            path += SCRIPT_CACHE_EXTENSION;
+            return path;
+        }
+
+        bool scriptExists(const char * name) {
+            return m_fileSystem.exists(getPath(name));
+        }
+
         bool deleteScript(const char * name) {
 
             m_logger->debug("Delete script %s",name);
+            DRString cachePath = getCachePath(name);
+            if (m_fileSystem.exists(cachePath)) {
+                m_fileSystem.deleteFile(cachePath);
+            }
             return m_fileSystem.deleteFile(getPath(name));
         }
 
         Script* writeScript(const char * name, const char * text){
-            SharedPtr<JsonRoot> jsonRoot;
-            jsonRoot = parse(text);
-            Script* script = jsonToScript(jsonRoot.get());
+            if (text == NULL) {
+                return NULL;
+            }
+            size_t length = strlen(text);
+            ScriptCacheWriter cache(DRStringTable::hash(text,length),length);
+            Script* script = streamToScript(text,&cache);
             if (script == NULL) {
                 return NULL;
             }
             m_fileSystem.write(getPath(name),text);
+            writeCache(name,cache);
+            return script;
+        }
+
+        // the script from its compiled form if that was made from the JSON
+        // in the file now.  otherwise from the JSON, and the compiled form is
+        // written for the next load
+        Script* loadScript(const char * name) {
+            m_loadedFromCache = false;
+            LoadResult load;
+            if (!loadScriptText(name,load)) {
+                return NULL;
+            }
+            const char * text = load.getText();
+            size_t length = strlen(text);
+            uint32_t hash = DRStringTable::hash(text,length);
+            if (SCRIPT_CACHE == 1) {
+                DRString cachePath = getCachePath(name);
+                DRFileBuffer cacheData;
+                if (m_fileSystem.exists(cachePath) && m_fileSystem.readBinary(cachePath,cacheData)) {
+                    ScriptCacheReader reader(cacheData.data(),cacheData.getLength());
+                    if (reader.isValid(hash,length)) {
+                        Script* script = cacheToScript(reader);
+                        if (script != NULL) {
+                            m_loadedFromCache = true;
+                            return script;
+                        }
+                    }
+                    m_logger->info("rebuild compiled script %s",name);
+                }
+            }
+            ScriptCacheWriter cache(hash,length);
+            Script* script = streamToScript(text,&cache);
+            if (script != NULL) {
+                writeCache(name,cache);
+            }
             return script;
         }
 
@@ -109,6 +200,12 @@ class ScriptDataLoader : public DataLoader {
             return false;
         }
 
+        // the file text without a JsonRoot, for streamToScript()
+        bool loadScriptText(const char * name,LoadResult& result){
+            m_logger->debug("load script text %s",name);
+            return readFile(getPath(name),result);
+        }
+
         bool readJson(Script& script, JsonRoot* root) {
             m_logger->debug("readJson.  getJson object");
           
@@ -127,6 +224,8 @@ class ScriptDataLoader : public DataLoader {
             
             JsonObject* obj = jsonRoot->getTopObject();
             Script* script = new Script();
+            ArenaScope arena(script->getArena());
+            beginLoad(script);
 
             m_logger->debug("convert JSON object to Script");
             script->setName(jsonString(obj,S_NAME,"unnamed"));
@@ -134,74 +233,80 @@ class ScriptDataLoader : public DataLoader {
 
             JsonArray * arr = obj->getArray("commands");
             jsonToCommands(arr,script->getContainer());
+            endLoad(script);
                        
             m_logger->debug("created Script");
             return script;
 
         }
 
+        // build the script from parser events.  each command's JSON is
+        // converted when the command ends so the file is never one JsonRoot
+        Script* streamToScript(const char * text);
+        // streamToScript() that also records the events in cache
+        Script* streamToScript(const char * text, ScriptCacheWriter* cache);
+        // the script from a compiled form.  check reader.isValid() first
+        Script* cacheToScript(ScriptCacheReader& reader);
+
         void jsonToCommands(JsonArray* arr, ICommandContainer* parent) {
             if (arr == NULL) {
                 return;
             }
             arr->each([&](JsonElement*item) {
-            
                 m_logger->debug("\tgot json command");
-                JsonObject*obj = item->asObject();
-                
-                if (obj) {
-                    const char * type = obj->get("type","unknown");
-                    m_logger->debug("\t\ttype: %s",type);
-                    ScriptCommandBase* cmd = NULL;
-                    
-                    if (matchName(S_RGB,type)) {
-                        cmd= jsonToRGBCommand(obj);
-                    } else if (matchName(S_HSL,type)) {
-                        cmd=jsonToHSLCommand(obj);
-                    } else if (matchName(S_XHSL,type)) {
-                        cmd=jsonToXHSLCommand(obj);
-                    }  else if (matchName(S_VALUES,type)) {
-                        m_logger->debug("read Values command");
-                        cmd=jsonToValueCommand(obj);
-                    } else if (matchName(S_POSITION,type)) {
-                       cmd=jsonToPositionCommand(obj);
-                    
-                    } else if (matchName(S_SEGMENT,type)){
-                        cmd=jsonToSegment(obj);
-                    } else if (matchName(S_CREATE,type)){
-                        cmd=jsonToCreate(obj);
-                    } else {
-                        m_logger->error("unknown ScriptCommand type %s",type);
-                        m_logger->info(obj->toJsonString().text());
-                    } 
-                    
-                    if (cmd != NULL) {
-
-                        m_logger->debug("add command %s",cmd->getType());
-                        ScriptPosition*pos = jsonToPosition(obj);
-                        if (pos != NULL) {
-                            m_logger->debug("got position object");
-                            cmd->setScriptPosition(pos);
-                        }
+                jsonToCommand(item->asObject(),parent);
+            });
+        }
 
-                        JsonObject*valJson = obj->getChild("values");
-                        
-                        if (valJson != NULL) {
-                            m_logger->debug("\tgot values json");
-                            jsonGetValues(valJson,cmd);
-                        }
-                        m_logger->debug("\tadd child to script");
-                        parent->add(cmd);
-                        m_logger->debug("\tadded");
-                        
-                    }
-                    
-                } else {
-                    m_logger->error("\t\tcommand is not an object");
+        void jsonToCommand(JsonObject* obj, ICommandContainer* parent) {
+            if (obj == NULL) {
+                m_logger->error("\t\tcommand is not an object");
+                return;
+            }
+            const char * type = obj->get("type","unknown");
+            m_logger->debug("\t\ttype: %s",type);
+            ScriptCommandBase* cmd = NULL;
+            
+            if (matchName(S_RGB,type)) {
+                cmd= jsonToRGBCommand(obj);
+            } else if (matchName(S_HSL,type)) {
+                cmd=jsonToHSLCommand(obj);
+            } else if (matchName(S_XHSL,type)) {
+                cmd=jsonToXHSLCommand(obj);
+            }  else if (matchName(S_VALUES,type)) {
+                m_logger->debug("read Values command");
+                cmd=jsonToValueCommand(obj);
+            } else if (matchName(S_POSITION,type)) {
+               cmd=jsonToPositionCommand(obj);
+            
+            } else if (matchName(S_SEGMENT,type)){
+                cmd=jsonToSegment(obj);
+            } else if (matchName(S_CREATE,type)){
+                cmd=jsonToCreate(obj);
+            } else {
+                m_logger->error("unknown ScriptCommand type %s",type);
+                m_logger->info("%s",obj->toJsonString().text());
+            } 
+            
+            if (cmd != NULL) {
+
+                m_logger->debug("add command %s",cmd->getType());
+                ScriptPosition*pos = jsonToPosition(obj);
+                if (pos != NULL) {
+                    m_logger->debug("got position object");
+                    cmd->setScriptPosition(pos);
                 }
+
+                JsonObject*valJson = obj->getChild("values");
                 
-                
-            });
+                if (valJson != NULL) {
+                    m_logger->debug("\tgot values json");
+                    jsonGetValues(valJson,cmd);
+                }
+                m_logger->debug("\tadd child to script");
+                parent->add(cmd);
+                m_logger->debug("\tadded");
+            }
         }
 
         const char * jsonString(JsonObject* obj,const char * name, const char * defaultValue) {
@@ -240,10 +345,12 @@ class ScriptDataLoader : public DataLoader {
             templateContainer->setMaxCount(jsonToValue(json,"max-count"));
             templateContainer->setStartChance(jsonToValue(json,"start-chance"));
             templateContainer->setEndChance(jsonToValue(json,"end-chance"));
+            templateContainer->setPoolSize(jsonInt(json,"pool-size",TEMPLATE_POOL_SIZE));
             JsonArray* arr = templ->getArray("commands");
             jsonToCommands(arr,templateContainer);
 
-            JsonObject* values = templ->getPropertyValue("values")->asObject();
+            JsonElement* valuesJson = templ->getPropertyValue("values");
+            JsonObject* values = valuesJson ? valuesJson->asObject() : NULL;
             if (values) {
                 values->eachProperty([&](const char* name, JsonElement*value){
                     if (!Util::equal("type",name)) {
@@ -252,7 +359,7 @@ class ScriptDataLoader : public DataLoader {
                             m_logger->error("unable to get ScriptValue from %s",value->toJsonString().text());
                         } else {
                             m_logger->debug("\tadd ScriptValue for %s",name);
-                            templateContainer->addValue(name,scriptValue);
+                            addLoadedValue(templateContainer,name,scriptValue);
                         }
                     }
                 });
@@ -336,7 +443,7 @@ class ScriptDataLoader : public DataLoader {
                         m_logger->error("unable to get ScriptValue from %s",value->toJsonString().text());
                     } else {
                         m_logger->debug("\tadd ScriptValue for %s",name);
-                        cmd->addValue(name,scriptValue);
+                        addLoadedValue(cmd,name,scriptValue);
                     }
                 }
             });
@@ -475,7 +582,19 @@ class ScriptDataLoader : public DataLoader {
                 return NULL;
             }
             FunctionArgs* args = getFunctionArgs(arr,1);
-            return new ScriptFunction(name,args);
+            return createFunction(name,args);
+        }
+
+        // resolve the function once here so evaluation does not look up the name
+        IScriptValue* createFunction(const char * name, FunctionArgs* args) {
+            const ScriptFunctionDef* function = ScriptFunctions.findFunction(name);
+            if (function == NULL) {
+                m_logger->error("unknown function: %s",name);
+            } else if (ScriptFunctions.checkArgs(function,args ? args->length() : 0)) {
+                return foldFunction(new ScriptFunction(function,args));
+            }
+            delete args;
+            return NULL;
         }
 
         IScriptValue* jsonToPattern(JsonObject*obj) {
@@ -548,7 +667,7 @@ class ScriptDataLoader : public DataLoader {
             IScriptValue* scriptValue = NULL;
             if (funcName) {
                 FunctionArgs* args = jsonObjectToFunctionArgs(obj);
-                scriptValue = new ScriptFunction(funcName->getString(),args);
+                scriptValue = createFunction(funcName->getString(),args);
             } else {
                 IScriptValue* pattern = jsonToPattern(valueObject);
                 if (pattern == NULL) {
@@ -586,6 +705,60 @@ class ScriptDataLoader : public DataLoader {
             return args;
         }
 /**/
+        // arguments are built first so nested constant expressions fold from the inside out
+        IScriptValue* foldFunction(ScriptFunction* function) {
+            if (!function->isFoldable()) {
+                return function;
+            }
+            IScriptValue* folded = new ScriptNumberValue(function->getFloatValue(NULL,0));
+            m_logger->debug("folded %s",function->toString().text());
+            function->destroy();
+            m_foldCount++;
+            return folded;
+        }
+
+        void beginLoad(Script* script) {
+            m_symbols = script->getSymbols();
+            m_foldCount = 0;
+            m_dropCount = 0;
+        }
+
+        void endLoad(Script* script) {
+            addLoadedValues();
+            script->compile();
+            m_logger->info("loaded script %s.  %d names, %d values folded, %d unused values dropped",script->getName(),m_symbols->getCount(),m_foldCount,m_dropCount);
+            m_logger->info("\tarena %d bytes used, %d wasted in %d blocks",(int)script->getArena()->getUsed(),(int)script->getArena()->getWasted(),script->getArena()->getBlockCount());
+            m_symbols = NULL;
+        }
+
+        void addLoadedValue(ScriptCommandBase* cmd, const char * name, IScriptValue* value) {
+            if (m_symbols == NULL) {
+                cmd->addValue(name,value);
+                return;
+            }
+            m_loadedValues.add(new ScriptLoaderValue(cmd,name,value,internName(name)));
+        }
+
+        // add the values held while loading.  values with no var() reference are never read
+        void addLoadedValues() {
+            m_loadedValues.each([&](ScriptLoaderValue* loaded){
+                if (m_dropUnusedValues && !m_symbols->isReferenced(loaded->m_symbol)) {
+                    m_logger->debug("drop unused value %s",loaded->m_name.text());
+                    loaded->m_value->destroy();
+                    m_dropCount++;
+                } else {
+                    loaded->m_command->addValue(loaded->m_name.text(),loaded->m_value,loaded->m_symbol);
+                }
+            });
+            m_loadedValues.clear();
+        }
+
+        // symbols belong to the script being loaded.  values built outside
+        // jsonToScript fall back to name lookups
+        int internName(const char * name) {
+            return m_symbols == NULL ? NO_SCRIPT_SYMBOL : m_symbols->intern(name);
+        }
+
         ScriptVariableValue* parseVarName(const char * val) {
             if (val == NULL) { return NULL;}
             const char * lparen = strchr(val,'(');
@@ -599,6 +772,7 @@ class ScriptDataLoader : public DataLoader {
             double defaultValue = 0;
             const char * def = strchr(val,'|');
             auto varValue = new ScriptVariableValue(result.text());
+            varValue->setSymbol(m_symbols == NULL ? NO_SCRIPT_SYMBOL : m_symbols->reference(result.text()));
             if (def != NULL) {
                 m_logger->debug("found default value %s",def);
                 const char * digit = def;
@@ -637,6 +811,9 @@ class ScriptDataLoader : public DataLoader {
             auto result = DRString(lparen+1,(rparen-lparen)-1);
             m_logger->debug("got system variable name %s",result.text());
             auto varValue = new ScriptSystemValue(result.text());
+            if (!varValue->isKnown()) {
+                m_logger->error("unknown system value: %s",result.text());
+            }
 
             return varValue;
         }
@@ -646,7 +823,262 @@ class ScriptDataLoader : public DataLoader {
         void setDefaults() {
             
         }
+
+        void writeCache(const char * name, ScriptCacheWriter& cache) {
+            if (SCRIPT_CACHE != 1 || !cache.finish()) {
+                return;
+            }
+            if (!m_fileSystem.writeBinary(getCachePath(name),cache.getData(),cache.getLength())) {
+                m_logger->warn("cannot write compiled script %s",name);
+            }
+        }
+
+        // a script built from the events read() gives a ScriptEventHandler
+        Script* eventsToScript(auto&& read);
+    private:
+        ScriptSymbolTable* m_symbols;
+        PtrSmallList<ScriptLoaderValue*> m_loadedValues;
+        bool m_dropUnusedValues;
+        int m_foldCount;
+        int m_dropCount;
+        bool m_loadedFromCache;
+};
+
+/* ScriptEventHandler reads the top of a script ("name", "frequency" and the
+ * "commands" array) from parser events.  each command object is collected
+ * with a JsonTreeBuilder into a JsonRoot of its own and given to
+ * jsonToCommand() when it ends, so the most JSON held at once is one
+ * command and its children.  other properties are skipped.
+ */
+class ScriptEventHandler : public IJsonEventHandler {
+    public:
+        ScriptEventHandler(ScriptDataLoader* loader, Script* script) {
+            m_loader = loader;
+            m_script = script;
+            m_logger = &ScriptLoaderLogger;
+            m_depth = 0;
+            m_started = false;
+            m_inCommands = false;
+            m_key = NULL;
+            m_keyLength = 0;
+            m_command = NULL;
+            m_builder = NULL;
+        }
+
+        ~ScriptEventHandler() {
+            endCommand();
+        }
+
+        // the top object has ended
+        bool isComplete() { return m_started && m_depth == 0;}
+
+        bool startObject() override {
+            if (m_builder != NULL) {
+                m_depth++;
+                return m_builder->startObject();
+            }
+            if (m_depth == 0) {
+                if (m_started) {
+                    return false;
+                }
+                m_started = true;
+            } else if (m_inCommands && m_depth == 2) {
+                m_command = new JsonRoot();
+                m_builder = new JsonTreeBuilder(m_command);
+                m_depth++;
+                return m_builder->startObject();
+            }
+            m_depth++;
+            return true;
+        }
+
+        bool endObject() override {
+            m_depth--;
+            if (m_builder != NULL) {
+                if (!m_builder->endObject()) {
+                    return false;
+                }
+                if (m_depth == 2) {
+                    JsonElement* json = m_command->getTopElement();
+                    m_loader->jsonToCommand(json ? json->asObject() : NULL,m_script->getContainer());
+                    endCommand();
+                }
+            }
+            return true;
+        }
+
+        bool startArray() override {
+            if (m_builder != NULL) {
+                m_depth++;
+                return m_builder->startArray();
+            }
+            if (m_depth == 0) {
+                m_logger->error("script JSON is not an object");
+                return false;
+            }
+            if (m_depth == 1 && isKey("commands")) {
+                m_inCommands = true;
+            }
+            m_key = NULL;
+            m_depth++;
+            return true;
+        }
+
+        bool endArray() override {
+            m_depth--;
+            if (m_builder != NULL) {
+                return m_builder->endArray();
+            }
+            if (m_depth == 1) {
+                m_inCommands = false;
+            }
+            return true;
+        }
+
+        bool key(const char * name, size_t length) override {
+            if (m_builder != NULL) {
+                return m_builder->key(name,length);
+            }
+            if (m_depth == 1) {
+                m_key = name;
+                m_keyLength = length;
+            }
+            return true;
+        }
+
+        bool stringValue(const char * value, size_t length) override {
+            if (m_builder != NULL) {
+                return m_builder->stringValue(value,length);
+            }
+            if (m_depth == 1 && isKey(S_NAME)) {
+                m_script->setName(DRString(value,length).text());
+            } else if (m_depth == 1 && isKey(S_FREQUENCY)) {
+                m_script->setFrequencyMSec(atoi(DRString(value,length).text()));
+            }
+            return topValue();
+        }
+
+        bool intValue(int value) override {
+            if (m_builder != NULL) {
+                return m_builder->intValue(value);
+            }
+            if (m_depth == 1 && isKey(S_FREQUENCY)) {
+                m_script->setFrequencyMSec(value);
+            }
+            return topValue();
+        }
+
+        bool floatValue(double value) override {
+            if (m_builder != NULL) {
+                return m_builder->floatValue(value);
+            }
+            if (m_depth == 1 && isKey(S_FREQUENCY)) {
+                m_script->setFrequencyMSec((int)value);
+            }
+            return topValue();
+        }
+
+        bool boolValue(bool value) override {
+            return m_builder != NULL ? m_builder->boolValue(value) : topValue();
+        }
+
+        bool nullValue() override {
+            return m_builder != NULL ? m_builder->nullValue() : topValue();
+        }
+
     private:
+        bool isKey(const char * name) {
+            return m_key != NULL && strncmp(m_key,name,m_keyLength) == 0 && name[m_keyLength] == 0;
+        }
+
+        // a value outside of a command
+        bool topValue() {
+            if (m_depth == 0) {
+                m_logger->error("script JSON is not an object");
+                return false;
+            }
+            if (m_inCommands && m_depth == 2) {
+                m_logger->error("\t\tcommand is not an object");
+            }
+            m_key = NULL;
+            return true;
+        }
+
+        void endCommand() {
+            delete m_builder;
+            delete m_command;
+            m_builder = NULL;
+            m_command = NULL;
+        }
+
+        ScriptDataLoader* m_loader;
+        Script* m_script;
+        Logger* m_logger;
+        int m_depth;            // objects and arrays open in the document
+        bool m_started;
+        bool m_inCommands;
+        const char * m_key;     // the last property name in the top object
+        size_t m_keyLength;
+        JsonRoot* m_command;    // the command being collected
+        JsonTreeBuilder* m_builder;
 };
+
+Script* ScriptDataLoader::eventsToScript(auto&& read) {
+    Script* script = new Script();
+    ArenaScope arena(script->getArena());
+    beginLoad(script);
+    script->setName("unnamed");
+    script->setFrequencyMSec(0);
+
+    ScriptEventHandler handler(this,script);
+    if (!read(&handler)) {
+        // values already loaded belong to commands in the script
+        addLoadedValues();
+        m_symbols = NULL;
+        script->destroy();
+        return NULL;
+    }
+    endLoad(script);
+    return script;
+}
+
+Script* ScriptDataLoader::streamToScript(const char * text) {
+    return streamToScript(text,NULL);
+}
+
+Script* ScriptDataLoader::streamToScript(const char * text, ScriptCacheWriter* cache) {
+    m_logger->debug("streamToScript");
+    if (text == NULL) {
+        return NULL;
+    }
+    return eventsToScript([&](ScriptEventHandler* handler) {
+        JsonEventParser parser;
+        bool parsed;
+        if (cache != NULL) {
+            cache->setTarget(handler);
+            parsed = parser.read(text,cache);
+            cache->setTarget(NULL);
+        } else {
+            parsed = parser.read(text,handler);
+        }
+        if (!parsed || !handler->isComplete()) {
+            m_logger->error("script parse failed at line %d, character %d",parser.errorLineNumber(),parser.errorCharacter());
+            return false;
+        }
+        return true;
+    });
+}
+
+Script* ScriptDataLoader::cacheToScript(ScriptCacheReader& reader) {
+    m_logger->debug("cacheToScript");
+    return eventsToScript([&](ScriptEventHandler* handler) {
+        if (!reader.read(handler) || !handler->isComplete()) {
+            m_logger->error("compiled script is not valid");
+            return false;
+        }
+        return true;
+    });
+}
+
 };
 #endif
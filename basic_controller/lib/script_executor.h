@@ -2,12 +2,12 @@
 #define DRSCRIPTEXECUTOR_H
 
 
-#include "./parse_gen.h";
-#include "./logger.h";
-#include "./led_strip.h";
-#include "./config.h";
-#include "./standard.h";
-#include "./script/script.h";
+#include "./parse_gen.h"
+#include "./logger.h"
+#include "./led_strip.h"
+#include "./config.h"
+#include "./standard.h"
+#include "./script/script.h"
 namespace DevRelief {
 
     Logger ScriptExecutorLogger("ScriptExecutor",SCRIPT_EXECUTOR_LOGGER_LEVEL);
@@ -96,6 +96,7 @@ namespace DevRelief {
                 m_script->step();
 
             }
+            Script* getScript() { return m_script;}
         private:
 
             void setupLeds(Config& config) {
@@ -0,0 +1,103 @@
+#ifndef COLOR_TEST_H
+#define COLOR_TEST_H
+
+#include "./test_suite.h"
+#include "../color.h"
+#include "../led_strip.h"
+#include "./led_strip_suite.h"
+
+#if RUN_TESTS==1
+namespace DevRelief {
+
+class ColorTestSuite : public TestSuite{
+    public:
+
+        static bool Run(Logger* logger) {
+            ColorTestSuite test(logger);
+            test.run();
+            return test.isSuccess();
+        }
+
+        void run() {
+            runTest("testHSLToRGBFixedError",[&](TestResult&r){testHSLToRGBFixedError(r);});
+            runTest("testHSLStripShow",[&](TestResult&r){testHSLStripShow(r);});
+        }
+
+        ColorTestSuite(Logger* logger) : TestSuite("Color Tests",logger){
+        }
+
+    protected:
+
+    void testHSLToRGBFixedError(TestResult& result);
+    void testHSLStripShow(TestResult& result);
+
+    // HueToRGB() and HSLToRGB() in double precision
+    static double referenceHue(double v1, double v2, double vH) {
+        if (vH < 0) { vH += 1;}
+        if (vH > 1) { vH -= 1;}
+        if ((6 * vH) < 1) { return v1 + (v2 - v1) * 6 * vH;}
+        if ((2 * vH) < 1) { return v2;}
+        if ((3 * vH) < 2) { return v1 + (v2 - v1) * ((2.0 / 3) - vH) * 6;}
+        return v1;
+    }
+
+    static CRGB referenceRGB(int hue, int saturation, int lightness) {
+        double h = hue/360.0;
+        double s = saturation/100.0;
+        double l = lightness/100.0;
+        double v2 = (l < 0.5) ? (l * (1 + s)) : ((l + s) - (l * s));
+        double v1 = 2 * l - v2;
+        return CRGB((uint8_t)(255 * referenceHue(v1,v2,h + 1.0/3)),(uint8_t)(255 * referenceHue(v1,v2,h)),(uint8_t)(255 * referenceHue(v1,v2,h - 1.0/3)));
+    }
+
+    static int channelError(const CRGB& a, const CRGB& b) {
+        int error = abs(a.red-b.red);
+        error = max(error,abs(a.green-b.green));
+        return max(error,abs(a.blue-b.blue));
+    }
+};
+
+void ColorTestSuite::testHSLToRGBFixedError(TestResult& result) {
+    int doubleError = 0;
+    int floatError = 0;
+    for(int hue=0;hue<=360;hue++) {
+        // saturation and lightness every 5% keeps the test short on the device
+        for(int saturation=0;saturation<=100;saturation+=5) {
+            for(int lightness=0;lightness<=100;lightness+=5) {
+                CRGB fixed = HSLToRGBFixed(hue,saturation,lightness);
+                doubleError = max(doubleError,channelError(fixed,referenceRGB(hue,saturation,lightness)));
+                floatError = max(floatError,channelError(fixed,HSLToRGB(CHSL(hue,saturation,lightness))));
+            }
+        }
+        yield();
+    }
+    result.assertBetween(doubleError,0,1,"fixed-point error vs double");
+    result.assertBetween(floatError,0,1,"fixed-point error vs HSLToRGB");
+
+    CRGB white = HSLToRGBFixed(0,0,100);
+    result.assertEqual(white.red+white.green+white.blue,3*255,"white");
+    CRGB red = HSLToRGBFixed(360,100,50);
+    result.assertEqual(red.red,255,"hue 360 is red");
+    result.assertEqual(red.blue,0,"hue 360 has no blue");
+}
+
+void ColorTestSuite::testHSLStripShow(TestResult& result) {
+    TestLedStrip* base = new TestLedStrip(4);
+    HSLStrip* strip = new HSLStrip(base);
+    strip->clear();
+    strip->setHue(0,HUE::BLUE);
+    strip->setHue(1,HUE::GREEN);
+    strip->setLightness(1,25);
+    strip->setHue(2,HUE::RED);
+    strip->setSaturation(2,0);
+    strip->show();
+    for(int i=0;i<3;i++) {
+        result.assertBetween(channelError(base->getPixel(i),referenceRGB(i==0?240:i==1?90:0,i==2?0:100,i==1?25:50)),0,1,"show() pixel");
+    }
+    result.assertEqual(channelError(base->getPixel(3),CRGB(0,0,0)),0,"unset pixel is black");
+    delete strip;  // deletes base
+}
+
+}
+#endif
+#endif
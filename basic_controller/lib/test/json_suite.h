@@ -200,6 +200,8 @@ namespace DevRelief
         m_logger->info("Parse values JSON Script");
         m_logger->debug(VALUES_SCRIPT);
         ScriptDataLoader loader;
+        // TestValuesCommand reads the values by name so they are not dropped
+        loader.setDropUnusedValues(false);
         JsonParser parser;
         m_logger->info("\tParse JSON");
         SharedPtr<JsonRoot> root = parser.read(VALUES_SCRIPT);
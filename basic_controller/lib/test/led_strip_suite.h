@@ -0,0 +1,221 @@
+#ifndef LED_STRIP_TEST_H
+#define LED_STRIP_TEST_H
+
+#include "./test_suite.h"
+#include "../led_strip.h"
+
+#if RUN_TESTS==1
+namespace DevRelief {
+
+// strip that keeps the last colors it was sent
+class TestLedStrip : public DRLedStrip {
+    public:
+        TestLedStrip(int count) {
+            m_count = count;
+            m_pixels = new CRGB[count > 0 ? count : 0];
+            m_shows = 0;
+        }
+        ~TestLedStrip() { delete[] m_pixels;}
+
+        virtual void clear() {}
+        virtual void setBrightness(uint16_t brightness) {}
+        virtual void setColor(uint16_t index,const CRGB& color) { m_pixels[index] = color;}
+        virtual int getCount() { return m_count;}
+        virtual void show() { m_shows++;}
+        virtual CompoundLedStrip* getCompoundLedStrip() { return NULL;}
+        const CRGB& getPixel(int index) { return m_pixels[index];}
+        int getShowCount() { return m_shows;}
+    private:
+        int m_count;
+        CRGB* m_pixels;
+        int m_shows;
+};
+
+class LedStripTestSuite : public TestSuite{
+    public:
+
+        static bool Run(Logger* logger) {
+            LedStripTestSuite test(logger);
+            test.run();
+            return test.isSuccess();
+        }
+
+        void run() {
+            runTest("testWritePixels",[&](TestResult&r){testWritePixels(r);});
+            runTest("testCompoundSegments",[&](TestResult&r){testCompoundSegments(r);});
+            runTest("testHSLStripLayouts",[&](TestResult&r){testHSLStripLayouts(r);});
+            runTest("testHSLStripUnchangedFrames",[&](TestResult&r){testHSLStripUnchangedFrames(r);});
+        }
+
+        LedStripTestSuite(Logger* logger) : TestSuite("LedStrip Tests",logger){
+        }
+
+    protected:
+
+    void testWritePixels(TestResult& result);
+    void testCompoundSegments(TestResult& result);
+    void testHSLStripLayouts(TestResult& result);
+    void testHSLStripUnchangedFrames(TestResult& result);
+
+    static void drawSolid(HSLStrip* strip, int count, int hue) {
+        strip->clear();
+        for(int i=0;i<count;i++) {
+            strip->setHue(i,hue);
+        }
+        strip->show();
+    }
+
+    // two frames.  the second sets fewer pixels and uses operations on them
+    static void drawFrames(HSLStrip* strip) {
+        strip->clear();
+        for(int i=0;i<40;i++) {
+            strip->setHue(i,i*9);
+            strip->setLightness(i,i+10);
+        }
+        strip->show();
+        strip->clear();
+        for(int i=5;i<35;i+=2) {
+            strip->setHue(i,i*7);
+            strip->setHue(i,20,ADD);
+            strip->setSaturation(i,i*2,MAX);
+        }
+        strip->setLightness(36,80);
+        strip->show();
+    }
+};
+
+void LedStripTestSuite::testWritePixels(TestResult& result) {
+    // the same strips written with setColor() and writePixels().  the reversed
+    // strip is longer than REVERSE_STRIP_BLOCK_SIZE
+    TestLedStrip* expected[3];
+    TestLedStrip* actual[3];
+    CompoundLedStrip* setColorStrip = new CompoundLedStrip();
+    CompoundLedStrip* writeStrip = new CompoundLedStrip();
+    int counts[3] = {5,70,3};
+    for(int i=0;i<3;i++) {
+        expected[i] = new TestLedStrip(counts[i]);
+        actual[i] = new TestLedStrip(counts[i]);
+        setColorStrip->add(i == 1 ? new ReverseStrip(expected[i]) : (DRLedStrip*)expected[i]);
+        writeStrip->add(i == 1 ? new ReverseStrip(actual[i]) : (DRLedStrip*)actual[i]);
+    }
+    CRGB* pixels = new CRGB[78];
+    for(int i=0;i<78;i++) {
+        pixels[i] = CRGB(i,255-i,i*3);
+    }
+    // one run that starts inside the first strip and ends inside the last
+    for(int i=0;i<74;i++) {
+        setColorStrip->setColor(2+i,pixels[i]);
+    }
+    writeStrip->writePixels(2,pixels,74);
+
+    int differences = 0;
+    for(int s=0;s<3;s++) {
+        for(int i=0;i<counts[s];i++) {
+            const CRGB& a = expected[s]->getPixel(i);
+            const CRGB& b = actual[s]->getPixel(i);
+            if (a.red != b.red || a.green != b.green || a.blue != b.blue) {
+                differences++;
+            }
+        }
+    }
+    result.assertEqual(differences,0,"writePixels matches setColor");
+    result.assertEqual(actual[1]->getPixel(69).red,3,"first pixel of reversed strip is at its end");
+    delete[] pixels;
+    delete setColorStrip;
+    delete writeStrip;
+}
+
+void LedStripTestSuite::testCompoundSegments(TestResult& result) {
+    // more strips than the old fixed table held, including an empty one
+    CompoundLedStrip* compound = new CompoundLedStrip();
+    TestLedStrip* strips[7];
+    int counts[7] = {3,1,10,0,7,2,5};
+    for(int i=0;i<7;i++) {
+        strips[i] = new TestLedStrip(counts[i]);
+        compound->add(strips[i]);
+    }
+    result.assertEqual(compound->getSegmentCount(),7,"segment count");
+    result.assertEqual(compound->getCount(),28,"led count");
+
+    // set every LED last to first so lookups do not just follow the last segment
+    for(int i=27;i>=0;i--) {
+        compound->setColor(i,CRGB(i,0,0));
+    }
+    int wrong = 0;
+    int index = 0;
+    for(int s=0;s<7;s++) {
+        for(int i=0;i<counts[s];i++) {
+            if (strips[s]->getPixel(i).red != index) {
+                wrong++;
+            }
+            index++;
+        }
+    }
+    result.assertEqual(wrong,0,"setColor finds the right strip");
+    delete compound;
+}
+
+void LedStripTestSuite::testHSLStripLayouts(TestResult& result) {
+    TestLedStrip* interleaved = new TestLedStrip(40);
+    TestLedStrip* soa = new TestLedStrip(40);
+    HSLStrip* interleavedStrip = new HSLStrip(interleaved,HSL_LAYOUT_INTERLEAVED);
+    HSLStrip* soaStrip = new HSLStrip(soa,HSL_LAYOUT_SOA);
+    drawFrames(interleavedStrip);
+    drawFrames(soaStrip);
+
+    int differences = 0;
+    int lit = 0;
+    for(int i=0;i<40;i++) {
+        const CRGB& a = interleaved->getPixel(i);
+        const CRGB& b = soa->getPixel(i);
+        if (a.red != b.red || a.green != b.green || a.blue != b.blue) {
+            differences++;
+        }
+        if (a.red+a.green+a.blue > 0) {
+            lit++;
+        }
+    }
+    result.assertEqual(differences,0,"layouts draw the same frame");
+    // 15 pixels with a hue.  pixel 36 only has lightness so it is black like the rest
+    result.assertEqual(lit,15,"pixels not set since clear() are black");
+    CRGB expected = UnsetHSLToRGB(5*7+20,5*2,-1);
+    result.assertEqual(interleaved->getPixel(5).green,expected.green,"operation starts from unset");
+    delete interleavedStrip;
+    delete soaStrip;
+}
+
+void LedStripTestSuite::testHSLStripUnchangedFrames(TestResult& result) {
+    TestLedStrip* base = new TestLedStrip(40);
+    HSLStrip* strip = new HSLStrip(base);
+    drawSolid(strip,30,HUE::BLUE);
+    result.assertEqual(base->getShowCount(),1,"first frame shown");
+    result.assertEqual(strip->getConvertedPixels(),30,"first frame converted");
+
+    drawSolid(strip,30,HUE::BLUE);
+    result.assertEqual(base->getShowCount(),1,"same frame not shown");
+    result.assertEqual(strip->getUnchangedFrames(),1,"unchanged frames");
+    result.assertEqual(strip->getConvertedPixels(),30,"same frame not converted");
+
+    // one pixel changes and the rest of the lit pixels are unset
+    strip->clear();
+    strip->setHue(0,HUE::BLUE);
+    strip->setHue(1,HUE::RED);
+    strip->show();
+    result.assertEqual(base->getShowCount(),2,"changed frame shown");
+    result.assertEqual(strip->getConvertedPixels(),31,"only the changed pixel converted");
+    result.assertEqual(base->getPixel(1).red,255,"changed pixel");
+    result.assertEqual(base->getPixel(2).blue,0,"unset pixel is black");
+    result.assertEqual(base->getPixel(0).blue,255,"unchanged pixel is kept");
+
+    strip->setBrightness(20);
+    strip->clear();
+    strip->setHue(0,HUE::BLUE);
+    strip->setHue(1,HUE::RED);
+    strip->show();
+    result.assertEqual(base->getShowCount(),3,"brightness change is shown");
+    delete strip;
+}
+
+}
+#endif
+#endif
@@ -0,0 +1,118 @@
+#ifndef LIST_TEST_H
+#define LIST_TEST_H
+
+#include "./test_suite.h"
+#include "../list.h"
+
+#if RUN_TESTS==1
+namespace DevRelief {
+
+// counts destroy() calls so PtrSmallList ownership can be checked
+class ListTestItem {
+    public:
+        ListTestItem(int value, int* destroyed) { m_value = value; m_destroyed = destroyed;}
+        void destroy() { (*m_destroyed)++; delete this;}
+        int m_value;
+        int* m_destroyed;
+};
+
+class ListTestSuite : public TestSuite{
+    public:
+
+        static bool Run(Logger* logger) {
+            ListTestSuite test(logger);
+            test.run();
+            return test.isSuccess();
+        }
+
+        void run() {
+            runTest("testSmallList",[&](TestResult&r){testSmallList(r);});
+            runTest("testPtrSmallList",[&](TestResult&r){testPtrSmallList(r);});
+            runTest("testSmallListRemoveInEach",[&](TestResult&r){testSmallListRemoveInEach(r);});
+        }
+
+        ListTestSuite(Logger* logger) : TestSuite("List Tests",logger){
+        }
+
+    protected:
+
+    void testSmallList(TestResult& result);
+    void testPtrSmallList(TestResult& result);
+    void testSmallListRemoveInEach(TestResult& result);
+};
+
+void ListTestSuite::testSmallList(TestResult& result) {
+    SmallList<int,2> list;
+    list.add(1);
+    list.add(3);
+    list.insertAt(1,2);
+    list.add(4);
+    result.assertEqual(list.size(),4,"size past the inline items");
+    result.assertEqual(list.get(0),1,"get(0)");
+    result.assertEqual(list[1],2,"[1]");
+    result.assertEqual(list.get(2),3,"get(2)");
+    result.assertEqual(list.last(),4,"last()");
+    result.assertEqual(list.get(4),0,"past the end");
+    result.assertEqual(list.get(-1),0,"negative index");
+
+    list.removeAt(1);
+    result.assertEqual(list.get(1),3,"removeAt");
+    list.add(5);
+    list.add(5);
+    list.insertAt(0,5);
+    list.insertAt(20,5);
+    result.assertEqual(list.size(),7,"size with 5s");
+    result.assertEqual(list.firstIndexOf(5),0,"firstIndexOf");
+    result.assertEqual(list.firstIndexOf(5,1),4,"firstIndexOf with start");
+    list.removeAll(5);
+    result.assertEqual(list.size(),3,"removeAll");
+    int total = 0;
+    list.each([&](int& value) { total = total*10+value;});
+    result.assertEqual(total,134,"each in order");
+    int* found = list.first([&](int& value) { return value > 2;});
+    result.assertTrue(found != NULL && *found == 3,"first");
+    list.clear();
+    result.assertEqual(list.size(),0,"clear");
+}
+
+void ListTestSuite::testPtrSmallList(TestResult& result) {
+    int destroyed = 0;
+    PtrSmallList<ListTestItem*>* list = new PtrSmallList<ListTestItem*>();
+    for(int i=0;i<10;i++) {
+        list->add(new ListTestItem(i,&destroyed));
+    }
+    result.assertEqual(list->get(9)->m_value,9,"get");
+    list->removeAt(0);
+    result.assertEqual(destroyed,1,"removeAt destroys");
+    list->removeFirst(list->get(3));
+    result.assertEqual(destroyed,2,"removeFirst destroys");
+    result.assertEqual(list->get(3)->m_value,5,"items move down");
+    delete list;
+    result.assertEqual(destroyed,10,"delete destroys the rest");
+}
+
+void ListTestSuite::testSmallListRemoveInEach(TestResult& result) {
+    int destroyed = 0;
+    PtrSmallList<ListTestItem*> list;
+    for(int i=0;i<6;i++) {
+        list.add(new ListTestItem(i,&destroyed));
+    }
+    // remove the current item and one before it
+    int seen = 0;
+    list.each([&](ListTestItem* item) {
+        seen++;
+        if (item->m_value == 2) {
+            list.removeFirst(item);
+        } else if (item->m_value == 4) {
+            list.removeAt(0);
+        }
+    });
+    result.assertEqual(seen,6,"every item seen once");
+    result.assertEqual(list.size(),4,"two removed");
+    result.assertEqual(list.get(0)->m_value,1,"first left");
+    result.assertEqual(list.last()->m_value,5,"last left");
+}
+
+}
+#endif
+#endif
@@ -0,0 +1,123 @@
+#ifndef LOGGER_TEST_H
+#define LOGGER_TEST_H
+
+#include "./test_suite.h"
+#include "../logger.h"
+
+#if RUN_TESTS==1 && LOGGING_ON==1
+namespace DevRelief {
+
+class LoggerTestSuite : public TestSuite{
+    public:
+
+        static bool Run(Logger* logger) {
+            LoggerTestSuite test(logger);
+            test.run();
+            return test.isSuccess();
+        }
+
+        void run() {
+            runTest("testLogRingFormat",[&](TestResult&r){testLogRingFormat(r);});
+            runTest("testLogRingStrings",[&](TestResult&r){testLogRingStrings(r);});
+            runTest("testLogRingOverflow",[&](TestResult&r){testLogRingOverflow(r);});
+        }
+
+        LoggerTestSuite(Logger* logger) : TestSuite("Logger Tests",logger){
+        }
+
+    protected:
+
+    void testLogRingFormat(TestResult& result);
+    void testLogRingStrings(TestResult& result);
+    void testLogRingOverflow(TestResult& result);
+
+    static void add(LogRing* ring, const char * format,...) {
+        va_list args;
+        va_start(args,format);
+        ring->add(ERROR_LEVEL,ERROR_LEVEL,"LogTest",0,format,args);
+        va_end(args);
+    }
+
+    // the message of the newest entry
+    static const char * newest(LogRing* ring, char * buffer, size_t size) {
+        LogRing::formatMessage(ring->getRecent(ring->getRecentCount()-1),buffer,size);
+        return buffer;
+    }
+};
+
+void LoggerTestSuite::testLogRingFormat(TestResult& result) {
+    LogRing* ring = new LogRing(8);
+    result.assertTrue(ring->start(),"start");
+    char message[100];
+    char expected[100];
+
+    add(ring,"%d %5.2f 0x%04X %ld%%",-12,3.14159,0xbeef,123456L);
+    snprintf(expected,sizeof(expected),"%d %5.2f 0x%04X %ld%%",-12,3.14159,0xbeef,123456L);
+    result.assertEqual(newest(ring,message,sizeof(message)),expected,"numbers");
+
+    add(ring,"%c-%zu-%lld",'x',(size_t)42,12345678901LL);
+    result.assertEqual(newest(ring,message,sizeof(message)),"x-42-12345678901","char, size_t and long long");
+
+    // more arguments than an entry holds are formatted when they are added
+    add(ring,"%d %d %d %d %d",1,2,3,4,5);
+    result.assertEqual(newest(ring,message,sizeof(message)),"1 2 3 4 5","formatted when added");
+
+    add(ring,"%*d",4,7);
+    result.assertEqual(newest(ring,message,sizeof(message)),"   7","'*' width");
+
+    // the output buffer is smaller than the message
+    add(ring,"value=%d",123456);
+    result.assertEqual(newest(ring,message,8),"value=1","truncated output");
+    delete ring;
+}
+
+void LoggerTestSuite::testLogRingStrings(TestResult& result) {
+    LogRing* ring = new LogRing(4);
+    ring->start();
+    char message[100];
+
+    char name[10];
+    strcpy(name,"first");
+    add(ring,"[%s] [%-6s] [%s]",name,"b",(const char*)NULL);
+    strcpy(name,"changed");
+    result.assertEqual(newest(ring,message,sizeof(message)),"[first] [b     ] [(null)]","strings are copied");
+
+    // the strings share LOG_ENTRY_TEXT_SIZE bytes
+    add(ring,"%s|%s","abcdefghijklmnopqrstuvwxyz","0123456789");
+    result.assertEqual(newest(ring,message,sizeof(message)),"abcdefghijklmnopqrstuvwxyz|0123","long strings are truncated");
+
+    // a format that changes after it is added cannot read past the stored arguments
+    char format[30];
+    strcpy(format,"%d");
+    add(ring,format,5);
+    strcpy(format,"%d,%d,%d,%d,%d,%s");
+    result.assertEqual(newest(ring,message,sizeof(message)),"5,","stops at the stored argument count");
+    delete ring;
+}
+
+void LoggerTestSuite::testLogRingOverflow(TestResult& result) {
+    LogRing* ring = new LogRing(4);
+    ring->start();
+    char message[100];
+    for(int i=0;i<6;i++) {
+        add(ring,"message %d",i);
+    }
+    result.assertEqual(ring->getPending(),4,"pending");
+    result.assertEqual(ring->getDropped(),2,"dropped when full");
+    result.assertEqual(ring->drain(3,0),3,"drain limit");
+    result.assertEqual(ring->drain(10,0),1,"drain rest");
+
+    // drained entries are kept until they are overwritten
+    add(ring,"message %d",6);
+    result.assertEqual(ring->getRecentCount(),4,"recent count");
+    result.assertTrue(ring->formatRecent(0,message,sizeof(message)),"formatRecent");
+    result.assertTrue(strstr(message,"LogTest: message 1") != NULL,"oldest recent message");
+    LogRing::formatMessage(ring->getRecent(3),message,sizeof(message));
+    result.assertEqual(message,"message 6","newest recent message");
+    result.assertEqual(ring->getWritten(),5,"written");
+    delete ring;
+}
+
+}
+#endif
+#endif
@@ -6,6 +6,9 @@
 #include "../script/script_command.h"
 #include "../script/script_value.h"
 #include "../script/animation.h"
+#include "../script/script_profile.h"
+#include "../script/frame_scheduler.h"
+#include "./led_strip_suite.h"
 
 #if RUN_TESTS==1
 namespace DevRelief {
@@ -28,6 +31,71 @@ const char *LOAD_SIMPLE_SCRIPT = R"script(
         }        
     )script";    
 
+const char *LOAD_TEMPLATE_SCRIPT = R"script(
+        {
+            "type": "create",
+            "count": 4,
+            "pool-size": 2,
+            "template": {
+                "commands": [
+                    {"type": "rgb", "red": 250}
+                ]
+            }
+        }
+    )script";
+
+// top-level properties the loader skips are around and between the commands
+const char *LOAD_STREAM_SCRIPT = R"script(
+        {
+            "notes": {"author": "test", "tags": ["a", {"b": [1, 2]}]},
+            "commands": [
+                {"type": "values", "hue": 120, "unused": 5},
+                {"type": "segment", "start": 2, "count": 6, "commands": [
+                    {"type": "hsl", "hue": "var(hue)", "lightness": {"start": 20, "end": 60}, "saturation": 100},
+                    {"type": "rgb", "red": ["add", 50, 100], "op": "add"}
+                ]},
+                17,
+                {"type": "rgb", "green": 30, "position": {"start": 0, "count": 2}}
+            ],
+            "frequency": 40,
+            "name": "stream"
+        }
+    )script";
+
+// keeps what JsonGenerator writes and the lowest free heap while it writes
+class TestJsonSink : public IJsonSink {
+    public:
+        TestJsonSink(bool keep) {
+            m_keep = keep;
+            m_writes = 0;
+            m_largest = 0;
+            m_ended = false;
+            m_lowestHeap = ESP.getFreeHeap();
+        }
+
+        bool write(const char * text, size_t length) override {
+            m_writes++;
+            m_largest = length > m_largest ? length : m_largest;
+            if (m_keep) {
+                memcpy(m_text.increaseLength(length),text,length);
+            } else if ((int)ESP.getFreeHeap() < m_lowestHeap) {
+                m_lowestHeap = ESP.getFreeHeap();
+            }
+            return true;
+        }
+
+        bool end() override {
+            m_ended = true;
+            return true;
+        }
+
+        bool m_keep;
+        DRString m_text;
+        int m_writes;
+        size_t m_largest;
+        bool m_ended;
+        int m_lowestHeap;
+};
 
 class ScriptLoaderTestSuite : public TestSuite{
     public:
@@ -41,6 +109,20 @@ class ScriptLoaderTestSuite : public TestSuite{
         void run() {
             runTest("testScriptCommandMemLeak",[&](TestResult&r){memLeakScriptCommand(r);});
             runTest("testScriptLoaderMemLeak",[&](TestResult&r){memLeak(r);});
+            runTest("testFrameScheduler",[&](TestResult&r){testFrameScheduler(r);});
+            runTest("testTimeHistogram",[&](TestResult&r){testTimeHistogram(r);});
+            runTest("testArena",[&](TestResult&r){testArena(r);});
+            runTest("testScriptArena",[&](TestResult&r){testScriptArena(r);});
+            runTest("testTemplatePool",[&](TestResult&r){testTemplatePool(r);});
+            runTest("testPatternLookup",[&](TestResult&r){testPatternLookup(r);});
+            runTest("testStreamLoad",[&](TestResult&r){testStreamLoad(r);});
+            runTest("testJsonInPlace",[&](TestResult&r){testJsonInPlace(r);});
+            runTest("testJsonIndex",[&](TestResult&r){testJsonIndex(r);});
+            runTest("testScriptCache",[&](TestResult&r){testScriptCache(r);});
+            runTest("testJsonChunks",[&](TestResult&r){testJsonChunks(r);});
+            #if SCRIPT_PROFILE==1
+            runTest("testScriptProfile",[&](TestResult&r){testScriptProfile(r);});
+            #endif
         }
 
         ScriptLoaderTestSuite(Logger* logger) : TestSuite("ScriptLoader Tests",logger){
@@ -51,6 +133,75 @@ class ScriptLoaderTestSuite : public TestSuite{
 
     void memLeakScriptCommand(TestResult& result);
     void memLeak(TestResult& result);
+    void testFrameScheduler(TestResult& result);
+    void testTimeHistogram(TestResult& result);
+    void testScriptProfile(TestResult& result);
+    void testArena(TestResult& result);
+    void testScriptArena(TestResult& result);
+    void testTemplatePool(TestResult& result);
+    void testPatternLookup(TestResult& result);
+    void testStreamLoad(TestResult& result);
+    void testJsonInPlace(TestResult& result);
+    void testJsonIndex(TestResult& result);
+    void testScriptCache(TestResult& result);
+    void testJsonChunks(TestResult& result);
+
+    // pixels that differ in 3 steps of the scripts
+    static int differentPixels(Script* a, Script* b) {
+        TestLedStrip* aLeds = new TestLedStrip(10);
+        TestLedStrip* bLeds = new TestLedStrip(10);
+        HSLStrip* aStrip = new HSLStrip(aLeds);
+        HSLStrip* bStrip = new HSLStrip(bLeds);
+        a->begin(aStrip,NULL);
+        b->begin(bStrip,NULL);
+        int different = 0;
+        for(int i=0;i<3;i++) {
+            delay(a->getFrequencyMSec());
+            a->step();
+            b->step();
+            for(int led=0;led<10;led++) {
+                const CRGB& aPixel = aLeds->getPixel(led);
+                const CRGB& bPixel = bLeds->getPixel(led);
+                if (aPixel.red != bPixel.red || aPixel.green != bPixel.green || aPixel.blue != bPixel.blue) {
+                    different++;
+                }
+            }
+        }
+        a->destroy();
+        b->destroy();
+        delete aStrip;
+        delete bStrip;
+        ScriptProfile.reset();
+        return different;
+    }
+
+    // a pattern of element values 0,10,20... with repeat counts from counts.  a negative value is null
+    static PatternValue* createPattern(const int* counts, int elementCount, int scale, int nullElement=-1) {
+        PatternValue* pattern = new PatternValue();
+        for(int i=0;i<elementCount;i++) {
+            IScriptValue* value = i == nullElement ? (IScriptValue*)new ScriptNullValue() : (IScriptValue*)new ScriptNumberValue(i*10);
+            pattern->addElement(new ScriptPatternElement(counts[i]*scale,value));
+        }
+        return pattern;
+    }
+
+    // the element an index falls in, counted the way getValueAt() used to
+    static int expectedValue(const int* counts, int elementCount, int scale, int nullElement, int index) {
+        int element = 0;
+        while(element < elementCount && index >= counts[element]*scale) {
+            index -= counts[element]*scale;
+            element++;
+        }
+        return element == nullElement ? -1 : element*10;
+    }
+};
+
+// 40 bytes with the vtable pointer on the host
+class ArenaTestObject : public ArenaObject {
+    public:
+        ArenaTestObject() { memset(m_data,0,sizeof(m_data));}
+        virtual ~ArenaTestObject() {}
+        char m_data[32];
 };
 
 void ScriptLoaderTestSuite::memLeakScriptCommand(TestResult& result) {
@@ -82,6 +233,472 @@ void ScriptLoaderTestSuite::memLeak(TestResult& result) {
 
 }
 
+void ScriptLoaderTestSuite::testFrameScheduler(TestResult& result) {
+    FrameScheduler scheduler;
+    // 50ms frames starting at 1000 with loop() waking at uneven times
+    unsigned long now = 1000;
+    result.assertTrue(scheduler.isDue(now,50),"first frame");
+    scheduler.beginFrame(now,50);
+    scheduler.endFrame(now+5,50);
+    result.assertFalse(scheduler.isDue(1049,50),"not due yet");
+    now = 1057;
+    result.assertTrue(scheduler.isDue(now,50),"due");
+    scheduler.beginFrame(now,50);
+    scheduler.endFrame(now+5,50);
+    // the next deadline stays on the grid instead of 1057+50
+    result.assertEqual(scheduler.getNextDeadline(),1100,"no drift");
+    result.assertEqual(scheduler.getOnTime(),2,"on time");
+
+    // 30ms late and then 120ms late
+    scheduler.beginFrame(1130,50);
+    scheduler.endFrame(1135,50);
+    result.assertEqual(scheduler.getLate(),1,"late");
+    scheduler.beginFrame(1270,50);
+    scheduler.endFrame(1275,50);
+    result.assertEqual(scheduler.getDropped(),2,"dropped deadlines");
+    result.assertEqual(scheduler.getNextDeadline(),1300,"back on the grid");
+
+    // frames that cost more than the frequency halve the frame rate
+    now = 1300;
+    for(int i=0;i<FRAME_SCHEDULER_SLOW_FRAMES;i++) {
+        scheduler.beginFrame(now,50);
+        now = scheduler.getNextDeadline();
+        scheduler.endFrame(scheduler.getNextDeadline()-scheduler.getPeriod(50)+70,50);
+    }
+    result.assertEqual(scheduler.getDivisor(),2,"slowed down");
+    result.assertEqual(scheduler.getPeriod(50),100,"period");
+    // 70ms frames fit in the 100ms period so the rate stays there
+    int steadyFrames = 2*FRAME_SCHEDULER_SLOW_FRAMES;
+    for(int i=0;i<steadyFrames;i++) {
+        now = scheduler.getNextDeadline();
+        scheduler.beginFrame(now,50);
+        scheduler.endFrame(now+70,50);
+    }
+    result.assertEqual(scheduler.getDivisor(),2,"steady at the slower rate");
+    for(int i=0;i<FRAME_SCHEDULER_FAST_FRAMES;i++) {
+        now = scheduler.getNextDeadline();
+        scheduler.beginFrame(now,50);
+        scheduler.endFrame(now+10,50);
+    }
+    result.assertEqual(scheduler.getDivisor(),1,"back to full rate");
+    result.assertEqual(scheduler.getSkipped(),steadyFrames+FRAME_SCHEDULER_FAST_FRAMES,"skipped frames");
+}
+
+void ScriptLoaderTestSuite::testTimeHistogram(TestResult& result) {
+    TimeHistogram histogram;
+    result.assertEqual(histogram.getPercentile(50),0,"empty");
+    // 90 fast samples and 10 slow ones
+    for(int i=0;i<90;i++) {
+        histogram.add(100+i);
+    }
+    for(int i=0;i<10;i++) {
+        histogram.add(5000+i*100);
+    }
+    // the 50th sample is 149.  buckets are at most 50% wide
+    result.assertBetween(histogram.getPercentile(50),149,224,"p50");
+    result.assertBetween(histogram.getPercentile(95),5000,5900,"p95");
+    result.assertEqual(histogram.getMax(),5900,"max");
+    result.assertEqual(histogram.getSamples(),100,"samples");
+
+    // old samples fade out
+    for(int i=0;i<PROFILE_DECAY_COUNT*4;i++) {
+        histogram.add(10);
+    }
+    result.assertBetween(histogram.getPercentile(95),10,15,"p95 after decay");
+    result.assertEqual(histogram.getMax(),5900,"max is kept");
+
+    for(uint32_t micros=1;micros<1000000;micros=micros*3/2+1) {
+        int bucket = TimeHistogram::bucketOf(micros);
+        if (micros > TimeHistogram::bucketTop(bucket) || (bucket > 0 && micros <= TimeHistogram::bucketTop(bucket-1))) {
+            result.fail("bucket range");
+        }
+    }
+}
+
+void ScriptLoaderTestSuite::testScriptProfile(TestResult& result) {
+    ScriptDataLoader loader;
+    JsonRoot* root = loader.parse(LOAD_SIMPLE_SCRIPT);
+    Script* script = loader.jsonToScript(root);
+    HSLStrip* strip = new HSLStrip(new TestLedStrip(10));
+    script->begin(strip,NULL);
+    for(int i=0;i<3;i++) {
+        delay(script->getFrequencyMSec());
+        script->step();
+    }
+    result.assertEqual(ScriptProfile.getSteps(),3,"steps");
+    // the root container and 3 commands
+    result.assertEqual(ScriptProfile.getCommandCount(),4,"commands");
+    result.assertEqual(ScriptProfile.getCommandType(0),"RootContainer","first command");
+    result.assertEqual(ScriptProfile.getCommandTime(1)->getSamples(),3,"command samples");
+    result.assertTrue(ScriptProfile.getCommandTime(0)->getMax() >= ScriptProfile.getCommandTime(1)->getMax(),"container includes its commands");
+
+    JsonRoot json;
+    ScriptProfile.toJson(json.createObject());
+    result.assertEqual(json.getTopObject()->get("steps",0),3,"json steps");
+    result.assertEqual(json.getTopObject()->getArray("commands")->getCount(),4,"json commands");
+
+    script->destroy();
+    delete strip;
+    delete root;
+    // the profile's command table is allocated by the test
+    ScriptProfile.reset();
+
+    ScriptProfile.addStep(1000,1000,1000,0);
+    result.assertEqual((int)ScriptProfile.getMissed(),0,"frequency 0 has no deadline");
+    ScriptProfile.addStep(1000,1000,1000,2);
+    result.assertEqual((int)ScriptProfile.getMissed(),1,"missed deadline");
+    ScriptProfile.reset();
+}
+
+void ScriptLoaderTestSuite::testArena(TestResult& result) {
+    ArenaTestObject* heapObject = new ArenaTestObject();
+    result.assertNull(Arena::getOwner(heapObject),"heap without a scope");
+
+    Arena* arena = new Arena();
+    ArenaTestObject* objects[100];
+    {
+        ArenaScope scope(arena);
+        for(int i=0;i<100;i++) {
+            objects[i] = new ArenaTestObject();
+        }
+    }
+    ArenaTestObject* afterScope = new ArenaTestObject();
+    result.assertNull(Arena::getOwner(afterScope),"heap after the scope");
+    result.assertTrue(Arena::getOwner(objects[0]) == arena,"first object in the arena");
+    result.assertTrue(Arena::getOwner(objects[99]) == arena,"last object in the arena");
+    size_t size = ARENA_HEADER_SIZE+((sizeof(ArenaTestObject)+ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1));
+    result.assertEqual((int)arena->getUsed(),(int)(100*size),"used");
+    result.assertTrue(arena->getBlockCount() > 1,"more than one block");
+    result.assertEqual((int)ArenaMemory.capacity,(int)arena->getCapacity(),"totals");
+
+    size_t wasted = arena->getWasted();
+    delete objects[10];
+    result.assertEqual((int)arena->getWasted(),(int)(wasted+size),"deleted object is wasted");
+    for(int i=0;i<100;i++) {
+        if (i != 10) {
+            delete objects[i];
+        }
+    }
+    delete afterScope;
+    delete heapObject;
+    delete arena;
+    result.assertEqual((int)ArenaMemory.capacity,0,"released");
+}
+
+void ScriptLoaderTestSuite::testScriptArena(TestResult& result) {
+    ScriptDataLoader loader;
+    JsonRoot* root = loader.parse(LOAD_SIMPLE_SCRIPT);
+    Script* script = loader.jsonToScript(root);
+    Arena* arena = script->getArena();
+    // 3 commands with a value, list nodes and strings
+    result.assertTrue(arena->getUsed() > 3*sizeof(RGBCommand),"script is in its arena");
+    result.assertEqual(arena->getBlockCount(),1,"one block");
+    // the parsed JSON is in the root's arena
+    result.assertTrue(root->getArena()->getBlockCount() > 0,"JSON is in its arena");
+    result.assertEqual((int)ArenaMemory.allocated,(int)(arena->getUsed()+root->getArena()->getUsed()+ArenaMemory.dead),"totals");
+    script->destroy();
+    delete root;
+    result.assertEqual((int)ArenaMemory.capacity,0,"released with the script");
+}
+
+void ScriptLoaderTestSuite::testPatternLookup(TestResult& result) {
+    // includes an empty element.  scale 20 is past the value cache and 30 is past the byte table
+    int counts[] = {2,0,3,1,4};
+    int scales[] = {1,20,30};
+    for(int scale : scales) {
+        PatternValue* pattern = createPattern(counts,5,scale,3);
+        int total = 10*scale;
+        int wrong = 0;
+        for(int index=0;index<total*2;index++) {
+            int value = pattern->getValueAt(NULL,NULL,index,-1);
+            if (value != expectedValue(counts,5,scale,3,index%total)) {
+                wrong++;
+            }
+        }
+        char message[40];
+        snprintf(message,sizeof(message),"values with scale %d",scale);
+        result.assertEqual(wrong,0,message);
+        pattern->destroy();
+    }
+}
+
+void ScriptLoaderTestSuite::testTemplatePool(TestResult& result) {
+    ScriptDataLoader loader;
+    JsonRoot* root = loader.parse(LOAD_TEMPLATE_SCRIPT);
+    ScriptTemplate* templ = loader.jsonToCreate(root->getTopObject());
+    Script* script = new Script();
+    script->getContainer()->add(templ);
+    HSLStrip* strip = new HSLStrip(new TestLedStrip(10));
+    script->begin(strip,NULL);
+    script->step();
+    ObjectPool<TemplateInstance>* pool = templ->getInstancePool();
+    result.assertEqual(pool->getCapacity(),2,"pool-size");
+    result.assertEqual(templ->getInstanceCount(),4,"instances past the pool use the heap");
+    result.assertEqual(pool->getInUse(),2,"pool full");
+    result.assertEqual((int)pool->getExhausted(),2,"exhausted");
+
+    for(int i=0;i<3;i++) {
+        delay(script->getFrequencyMSec());
+        script->step();
+    }
+    result.assertEqual(templ->getInstanceCount(),4,"instances kept");
+    result.assertEqual((int)pool->getAllocated(),2,"no new instances");
+    result.assertEqual((int)pool->getExhausted(),2,"count is met");
+
+    // released instances are reused
+    templ->setCount(new ScriptNumberValue(0));
+    delay(script->getFrequencyMSec());
+    script->step();
+    result.assertEqual(pool->getInUse(),0,"released");
+    templ->setCount(new ScriptNumberValue(1));
+    delay(script->getFrequencyMSec());
+    script->step();
+    result.assertEqual(pool->getInUse(),1,"reused");
+    result.assertEqual(pool->getPeak(),2,"peak");
+    script->destroy();
+    delete strip;
+    delete root;
+    ScriptProfile.reset();
+}
+
+void ScriptLoaderTestSuite::testStreamLoad(TestResult& result) {
+    ScriptDataLoader loader;
+    JsonRoot* root = loader.parse(LOAD_STREAM_SCRIPT);
+    Script* domScript = loader.jsonToScript(root);
+    int domFolds = loader.getFoldCount();
+    int domDrops = loader.getDropCount();
+    delete root;
+    Script* streamScript = loader.streamToScript(LOAD_STREAM_SCRIPT);
+    result.assertNotNull(streamScript,"stream load");
+    if (streamScript == NULL) {
+        domScript->destroy();
+        return;
+    }
+    result.assertEqual(streamScript->getName(),"stream","name after the commands");
+    result.assertEqual(streamScript->getFrequencyMSec(),40,"frequency");
+    result.assertEqual(loader.getFoldCount(),domFolds,"same folds");
+    result.assertEqual(loader.getDropCount(),domDrops,"same drops");
+
+    TestLedStrip* domLeds = new TestLedStrip(10);
+    TestLedStrip* streamLeds = new TestLedStrip(10);
+    HSLStrip* domStrip = new HSLStrip(domLeds);
+    HSLStrip* streamStrip = new HSLStrip(streamLeds);
+    domScript->begin(domStrip,NULL);
+    streamScript->begin(streamStrip,NULL);
+    int different = 0;
+    for(int i=0;i<3;i++) {
+        delay(streamScript->getFrequencyMSec());
+        domScript->step();
+        streamScript->step();
+        for(int led=0;led<10;led++) {
+            const CRGB& dom = domLeds->getPixel(led);
+            const CRGB& stream = streamLeds->getPixel(led);
+            if (dom.red != stream.red || dom.green != stream.green || dom.blue != stream.blue) {
+                different++;
+            }
+        }
+    }
+    result.assertEqual(different,0,"same pixels from both loads");
+    domScript->destroy();
+    streamScript->destroy();
+    delete domStrip;
+    delete streamStrip;
+    ScriptProfile.reset();
+
+    const char * noFrequency = "{\"name\": \"x\", \"commands\": [{\"type\": \"rgb\", \"red\": 10}]}";
+    root = loader.parse(noFrequency);
+    domScript = loader.jsonToScript(root);
+    delete root;
+    streamScript = loader.streamToScript(noFrequency);
+    result.assertNotNull(streamScript,"stream load without frequency");
+    if (streamScript != NULL) {
+        result.assertEqual(streamScript->getFrequencyMSec(),domScript->getFrequencyMSec(),"same default frequency");
+        result.assertEqual(streamScript->getFrequencyMSec(),0,"step every loop");
+        streamScript->destroy();
+    }
+    domScript->destroy();
+
+    result.assertNull(loader.streamToScript("{\"commands\": [{\"type\": \"rgb\"}"),"unterminated JSON");
+    result.assertNull(loader.streamToScript("[1,2]"),"not an object");
+}
+void ScriptLoaderTestSuite::testJsonInPlace(TestResult& result) {
+    const char * json = R"json({"name": "a\"b", "path": "c:\\led\u00e9", "tab": "x\ty"})json";
+    char * text = strdup(json);
+    JsonParser parser;
+    JsonRoot* copied = parser.read(json);
+    JsonRoot* root = parser.readInPlace(text);
+    JsonObject* obj = root->getTopObject();
+    const char * name = obj->get("name","");
+    result.assertTrue(name >= text && name < text+strlen(json),"string is in the buffer");
+    result.assertEqual(name,"a\"b","quote unescaped");
+    result.assertEqual(obj->get("path",""),"c:\\led\xc3\xa9","backslash and \\u unescaped");
+    result.assertEqual(obj->get("tab",""),"x\ty","tab unescaped");
+    result.assertEqual(copied->getTopObject()->get("path",""),obj->get("path",""),"copy is unescaped the same way");
+
+    DRString generated = obj->toJsonString();
+    JsonRoot* reparsed = parser.read(generated.text());
+    result.assertEqual(reparsed->getTopObject()->get("name",""),"a\"b","generated JSON escapes the quote");
+    result.assertEqual(reparsed->getTopObject()->get("path",""),"c:\\led\xc3\xa9","generated JSON escapes the backslash");
+    delete reparsed;
+    delete root;
+    delete copied;
+    free(text);
+}
+
+
+void ScriptLoaderTestSuite::testJsonIndex(TestResult& result) {
+    JsonParser parser;
+    JsonRoot* root = parser.read(R"json({"a":1,"b":2,"c":3,"d":4,"e":5,"f":6,"g":7,"h":8,"i":9,"j":10,"a":11,"":12,
+        "list":[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19]})json");
+    JsonObject* obj = root->getTopObject();
+    // every object has a jsonId property
+    result.assertEqual(obj->getCount(),14,"property count");
+    result.assertEqual(obj->get("j",0),10,"indexed property");
+    result.assertEqual(obj->get("a",0),1,"first duplicate wins");
+    result.assertEqual(obj->get("",0),12,"empty name");
+    result.assertNull(obj->getProperty("k"),"missing property");
+    for(int i=0;i<40;i++) {
+        obj->set(DRFormattedString("added%d",i).text(),i);
+    }
+    result.assertEqual(obj->getCount(),54,"count after the index grows");
+    result.assertEqual(obj->get("added33",0),33,"property added after parsing");
+    result.assertEqual(obj->get("i",0),9,"parsed property after the index grows");
+    obj->set("added5",500);
+    result.assertEqual(obj->getCount(),54,"set replaces");
+    result.assertEqual(obj->get("added5",0),500,"replaced value");
+
+    JsonArray* list = obj->getArray("list");
+    result.assertEqual(list->getCount(),20,"item count");
+    result.assertEqual(list->getAt(17)->getInt(),17,"getAt");
+    result.assertNull(list->getAt(20),"getAt past the end");
+    list->add(20);
+    result.assertEqual(list->getCount(),21,"count after add");
+    result.assertEqual(list->getAt(20)->getInt(),20,"getAt added item");
+    int expected = 0;
+    bool inOrder = true;
+    for(JsonArrayItem* item=list->getFirstItem();item != NULL;item=item->getNext()) {
+        inOrder = inOrder && item->getValue()->getInt() == expected++;
+    }
+    result.assertTrue(inOrder && expected == 21,"items in order");
+
+    obj->clear();
+    result.assertEqual(obj->getCount(),0,"clear");
+    result.assertNull(obj->getProperty("j"),"clear removes the index");
+    obj->set("j",1);
+    result.assertEqual(obj->get("j",0),1,"set after clear");
+    delete root;
+
+    // a root built outside a parse keeps its tables on the heap
+    JsonRoot built;
+    JsonArray* items = built.createArray();
+    for(int i=0;i<40;i++) {
+        items->add(i);
+    }
+    result.assertEqual(items->getAt(39)->getInt(),39,"built array");
+    result.assertEqual(built.getArena()->getBlockCount(),0,"no arena outside a parse");
+}
+
+
+void ScriptLoaderTestSuite::testScriptCache(TestResult& result) {
+    ScriptDataLoader loader;
+    const char * name = "cache-test";
+    Script* written = loader.writeScript(name,LOAD_STREAM_SCRIPT);
+    result.assertNotNull(written,"write script");
+    if (written == NULL) {
+        return;
+    }
+    written->destroy();
+
+    Script* cached = loader.loadScript(name);
+    result.assertTrue(loader.wasLoadedFromCache(),"writeScript() compiles the script");
+    result.assertNotNull(cached,"load compiled script");
+    if (cached == NULL) {
+        loader.deleteScript(name);
+        return;
+    }
+    result.assertEqual(cached->getName(),"stream","name");
+    result.assertEqual(cached->getFrequencyMSec(),40,"frequency");
+    result.assertEqual(differentPixels(loader.streamToScript(LOAD_STREAM_SCRIPT),cached),0,"same pixels as the JSON");
+
+    // a changed file is read from JSON once and compiled again
+    const char * changed = R"script({"name": "changed", "commands": [{"type": "rgb", "red": 10}]})script";
+    Script* unused = new Script();
+    loader.updateScript(name,*unused,changed);
+    unused->destroy();
+    Script* reloaded = loader.loadScript(name);
+    result.assertFalse(loader.wasLoadedFromCache(),"changed JSON is not read from the old cache");
+    result.assertEqual(reloaded ? reloaded->getName() : "","changed","changed script");
+    if (reloaded) { reloaded->destroy();}
+    reloaded = loader.loadScript(name);
+    result.assertTrue(loader.wasLoadedFromCache(),"compiled again");
+    if (reloaded) { reloaded->destroy();}
+    result.assertTrue(loader.deleteScript(name),"delete script");
+    result.assertNull(loader.loadScript(name),"deleted");
+
+    // a damaged cache is not used
+    size_t length = strlen(LOAD_STREAM_SCRIPT);
+    uint32_t hash = DRStringTable::hash(LOAD_STREAM_SCRIPT,length);
+    ScriptCacheWriter writer(hash,length);
+    Script* script = loader.streamToScript(LOAD_STREAM_SCRIPT,&writer);
+    if (script) { script->destroy();}
+    result.assertTrue(writer.finish(),"finish");
+    uint8_t* data = (uint8_t*)malloc(writer.getLength());
+    memcpy(data,writer.getData(),writer.getLength());
+    result.assertTrue(ScriptCacheReader(data,writer.getLength()).isValid(hash,length),"valid cache");
+    result.assertFalse(ScriptCacheReader(data,writer.getLength()).isValid(hash+1,length),"other JSON");
+    result.assertFalse(ScriptCacheReader(data,writer.getLength()-1).isValid(hash,length),"truncated");
+    data[sizeof(ScriptCacheHeader)] = 99;
+    ScriptCacheReader damaged(data,writer.getLength());
+    result.assertNull(loader.cacheToScript(damaged),"unknown event");
+    free(data);
+}
+
+
+void ScriptLoaderTestSuite::testJsonChunks(TestResult& result) {
+    JsonRoot* root = new JsonRoot();
+    JsonObject* obj = root->createObject();
+    obj->set("name","chunks \"quoted\"");
+    JsonArray* items = obj->createArray("items");
+    for(int i=0;i<100;i++) {
+        items->add("an item long enough to fill several chunks");
+        items->add(i);
+    }
+    DRString whole = obj->toJsonString();
+
+    TestJsonSink kept(true);
+    JsonGenerator gen(kept);
+    result.assertTrue(gen.generate(obj),"generate to a sink");
+    result.assertTrue(kept.m_writes > 1,"written in chunks");
+    result.assertTrue(kept.m_largest <= JSON_CHUNK_SIZE,"chunks fit the buffer");
+    result.assertTrue(kept.m_ended,"sink ended");
+    result.assertEqual((int)gen.getWritten(),(int)whole.getLength(),"bytes written");
+    result.assertTrue(strcmp(kept.m_text.text(),whole.text())==0,"same JSON as a DRString");
+
+    int startHeap = ESP.getFreeHeap();
+    TestJsonSink counted(false);
+    JsonGenerator countGen(counted);
+    countGen.generate(obj);
+    result.assertEqual(counted.m_lowestHeap,startHeap,"no heap used while generating");
+
+    {
+        // the result refers to obj so it goes first
+        ESP8266WebServer server;
+        ApiResult api(obj);
+        DRString apiText;
+        api.toText(apiText);
+        result.assertTrue(api.write(&server),"write response");
+        result.assertEqual(server.getCode(),200,"response code");
+        result.assertTrue(strcmp(server.getContent(),apiText.text())==0,"response is the JSON");
+    }
+
+    ScriptDataLoader loader;
+    result.assertTrue(loader.writeJsonFile(loader.getPath("chunk-test"),obj),"write file");
+    LoadResult load;
+    result.assertTrue(loader.loadScriptText("chunk-test",load),"read file");
+    result.assertTrue(strcmp(load.getText(),whole.text())==0,"file is the JSON");
+    loader.deleteScript("chunk-test");
+    delete root;
+}
 
 
 
@@ -2,6 +2,7 @@
 #define STRING_TEST_H
 
 #include "./test_suite.h"
+#include "../drstring.h"
 
 #if RUN_TESTS==1
 namespace DevRelief {
@@ -22,9 +23,14 @@ class StringTestSuite : public TestSuite{
 
         void run() {
             runTest("testReturnDRStringValue",[&](TestResult&r){testReturnDRStringValue(r);});
+            runTest("testInlineString",[&](TestResult&r){testInlineString(r);});
+            runTest("testCopyOnWrite",[&](TestResult&r){testCopyOnWrite(r);});
+            runTest("testMoveString",[&](TestResult&r){testMoveString(r);});
+            runTest("testInternString",[&](TestResult&r){testInternString(r);});
+            runTest("testSharedShortReserve",[&](TestResult&r){testSharedShortReserve(r);});
         }
 
-        StringTestSuite(Logger* logger) : TestSuite("JSON Tests",logger){
+        StringTestSuite(Logger* logger) : TestSuite("String Tests",logger){
 
         }
 
@@ -32,12 +38,99 @@ class StringTestSuite : public TestSuite{
 
 
     void testReturnDRStringValue(TestResult& result);
+    void testInlineString(TestResult& result);
+    void testCopyOnWrite(TestResult& result);
+    void testMoveString(TestResult& result);
+    void testInternString(TestResult& result);
+    void testSharedShortReserve(TestResult& result);
 };
 
 void StringTestSuite::testReturnDRStringValue(TestResult& result) {
     m_logger->debug("Running JSON Value tests");
 }
 
+void StringTestSuite::testInlineString(TestResult& result) {
+    int heap = ESP.getFreeHeap();
+    DRString hue("hue");
+    DRString count("count");
+    DRString copy(count);
+    copy.append("er");
+    DRFormattedString formatted("%s-%d",hue.text(),12);
+    result.assertEqual((int)ESP.getFreeHeap(),heap,"short strings are not allocated");
+    result.assertEqual(copy.text(),"counter","append");
+    result.assertEqual(count.text(),"count","original unchanged");
+    result.assertEqual(formatted.text(),"hue-12","formatted");
+    result.assertEqual((int)formatted.getLength(),6,"formatted length");
+
+    DRString length;
+    strcpy(length.increaseLength(4),"abcd");
+    strcpy(length.increaseLength(20),"additional text");
+    strcpy(length.increaseLength(5),"XYZ");
+    result.assertEqual(length.text(),"abcdadditional textXYZ","increaseLength past the inline buffer");
+    length.append(length.text()+4);
+    result.assertEqual(length.text(),"abcdadditional textXYZadditional textXYZ","append part of itself");
+}
+
+void StringTestSuite::testCopyOnWrite(TestResult& result) {
+    DRString original("a string longer than the inline buffer");
+    DRString copy(original);
+    result.assertTrue(copy.text() == original.text(),"copy shares text");
+    copy.append("!");
+    result.assertTrue(copy.text() != original.text(),"change copies text");
+    result.assertEqual(original.text(),"a string longer than the inline buffer","original unchanged");
+    result.assertEqual(copy.text(),"a string longer than the inline buffer!","copy changed");
+    DRString assigned;
+    assigned = original;
+    assigned.clear();
+    result.assertEqual(assigned.text(),"","clear");
+    result.assertEqual(original.text(),"a string longer than the inline buffer","clear does not change a copy");
+}
+
+void StringTestSuite::testMoveString(TestResult& result) {
+    DRString original("a string longer than the inline buffer");
+    const char * text = original.text();
+    DRString moved(static_cast<DRString&&>(original));
+    result.assertTrue(moved.text() == text,"move keeps text");
+    result.assertEqual(original.text(),"","moved from is empty");
+    DRString assigned("short");
+    assigned = static_cast<DRString&&>(moved);
+    result.assertTrue(assigned.text() == text,"move assign keeps text");
+}
+
+void StringTestSuite::testInternString(TestResult& result) {
+    // other code may have interned strings already.  these names are only used here
+    int startCount = InternedStrings.getCount();
+    DRString first = DRString::intern("test-hue");
+    DRString second = DRString::intern("test-hue");
+    DRString other = DRString::intern("test-saturation");
+    result.assertTrue(first.text() == second.text(),"same text is shared");
+    result.assertTrue(first.equals(second),"interned equal");
+    result.assertFalse(first.equals(other),"interned not equal");
+    result.assertTrue(first.equals(DRString("test-hue")),"equal to a string that is not interned");
+    result.assertEqual(InternedStrings.getCount(),startCount+2,"table count");
+
+    DRString changed(first);
+    changed.append("s");
+    result.assertEqual(changed.text(),"test-hues","interned copy changed");
+    result.assertEqual(first.text(),"test-hue","interned text unchanged");
+
+    first.clear();
+    second.clear();
+    result.assertEqual(InternedStrings.getCount(),startCount+1,"last reference removes the entry");
+    result.assertTrue(DRString::intern("test-saturation").text() == other.text(),"entry still interned");
+}
+
+void StringTestSuite::testSharedShortReserve(TestResult& result) {
+    DRString original("twenty characters...");
+    char * data = original.increaseLength(40);
+    data[0] = 'x';
+    // shared text with m_length above the written length
+    DRString copy(original);
+    copy.append("y");
+    result.assertEqual(copy.text(),"twenty characters...xy","append to shared text");
+    result.assertEqual(original.text(),"twenty characters...x","original unchanged");
+}
+
 
 }
 #endif 
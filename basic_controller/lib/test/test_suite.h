@@ -1,13 +1,13 @@
 #ifndef TEST_SUITE_H
 #define TEST_SUITE_H
 
-#include "../../env.h";
-#include "../parse_gen.h";
-#include "../logger.h";
-#include "../config.h";
-#include "../data.h";
-#include "../data_loader.h";
-#include "../list.h";
+#include "../../env.h"
+#include "../parse_gen.h"
+#include "../logger.h"
+#include "../config.h"
+#include "../data.h"
+#include "../data_loader.h"
+#include "../list.h"
 
 namespace DevRelief {
 
@@ -162,6 +162,7 @@ namespace DevRelief {
                 m_logTestMessages = logTestMessages;
                 m_name = name;
                 m_logger = logger;
+                success = true;
             }
             virtual ~TestSuite(){
              
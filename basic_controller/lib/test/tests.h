@@ -2,18 +2,22 @@
 #define TESTS_H
 
 
-#include "../parse_gen.h";
-#include "../logger.h";
-#include "../config.h";
-#include "../data.h";
-#include "../data_loader.h";
-#include "../list.h";
-
-#include "./test_suite.h";
-#include "./json_suite.h";
-#include "./string_suite.h";
-#include "./animation_suite.h";
+#include "../parse_gen.h"
+#include "../logger.h"
+#include "../config.h"
+#include "../data.h"
+#include "../data_loader.h"
+#include "../list.h"
+
+#include "./test_suite.h"
+#include "./json_suite.h"
+#include "./string_suite.h"
+#include "./animation_suite.h"
 #include "./script_loader_suite.h"
+#include "./led_strip_suite.h"
+#include "./color_suite.h"
+#include "./logger_suite.h"
+#include "./list_suite.h"
 
 namespace DevRelief {
 
@@ -54,6 +58,18 @@ namespace DevRelief {
             #if RUN_ANIMATION_TESTS==1
             success = AnimationTestSuite::Run(m_logger) && success;
             #endif
+            #if RUN_LOGGER_TESTS==1 && LOGGING_ON==1
+            success = LoggerTestSuite::Run(m_logger) && success;
+            #endif
+            #if RUN_LIST_TESTS==1
+            success = ListTestSuite::Run(m_logger) && success;
+            #endif
+            #if RUN_LED_STRIP_TESTS==1
+            success = LedStripTestSuite::Run(m_logger) && success;
+            #endif
+            #if RUN_COLOR_TESTS==1
+            success = ColorTestSuite::Run(m_logger) && success;
+            #endif
             #if SCRIPT_LOADER_TESTS==1
             success = ScriptLoaderTestSuite::Run(m_logger) && success;
             #endif
@@ -248,7 +264,7 @@ namespace DevRelief {
             JsonGenerator gen(buf);
             gen.generate(&api);
             m_logger->always("JSON:");
-            m_logger->always(buf.text());
+            m_logger->always("%s",buf.text());
             
         }   
 
@@ -2,7 +2,7 @@
 #define DRWIFIF_H
 #include "./logger.h"
 #include <ESP8266WiFi.h>
-#include "./config.h";
+#include "./config.h"
 
 namespace DevRelief {
     const char* ssid = "c22-2.4"; //replace this with your WiFi network name